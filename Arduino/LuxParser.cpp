@@ -20,17 +20,8 @@ const char* STATUS_TEXTS[] = {
   "Temperature Over Range",      // 17
   "", "",                        // 18-19
   "Solar + Battery Discharging > LOAD - Surplus > Grid", // 20
-  "", "", "", "", "", "", "",    // 21-27
-  "AC Battery Charging",         // 32
-  "", "", "", "",                // 33-36
-  "Solar + Grid > Battery Charging", // 40
-  "", "", "", "", "", "", "", "", // 41-48
-  "No Grid : Battery > EPS",     // 64
-  "", "", "", "", "", "", "", "", // 65-72
-  "No Grid : Solar > EPS - Surplus > Battery Charging", // 136
-  "", "", "", "",                // 137-140
-  "No Grid : Solar + Battery Discharging > EPS" // 192
 };
+// Codes above 20 are sparse; generateStatusText() has their texts inline
 
 // Battery status text mapping (from Python)
 const char* BATTERY_STATUS_TEXTS[] = {
@@ -79,7 +70,7 @@ bool LuxData::decode(const uint8_t *buffer, uint16_t length) {
   }
 
   const uint16_t RESPONSE_HEADER_SIZE = sizeof(Header) + sizeof(TranslatedData);
-  if (length < RESPONSE_HEADER_SIZE) {
+  if (length < RESPONSE_HEADER_SIZE + 2) {  // + CRC, else the payload length wraps
     return false;
   }
 
@@ -90,42 +81,48 @@ bool LuxData::decode(const uint8_t *buffer, uint16_t length) {
   uint16_t data_offset = RESPONSE_HEADER_SIZE;
   uint16_t data_payload_length = length - data_offset - 2;
 
-  // Handle different register banks
-  if (trans.registerStart == 0 && data_payload_length >= sizeof(LogDataRawSection1)) {
-    memcpy(&raw, buffer + data_offset, sizeof(LogDataRawSection1));
-    section1.loaded = true;
-    scaleSection1();
+  // Handle different register banks. Minimum sizes are what the old raw
+  // section structs needed.
+  static const struct { uint16_t start, min_bytes; } BANKS[] = {
+    {0, 80}, {40, 62}, {80, 80}, {120, 72}, {160, 80},
+  };
+  int bank = -1;
+  for (int i = 0; i < 5; i++) {
+    if (trans.registerStart == BANKS[i].start && data_payload_length >= BANKS[i].min_bytes) {
+      bank = i;
+      break;
+    }
   }
-  else if (trans.registerStart == 40 && data_payload_length >= sizeof(LogDataRawSection2)) {
-    memcpy(&raw2, buffer + data_offset, sizeof(LogDataRawSection2));
-    section2.loaded = true;
-    scaleSection2();
+  if (bank < 0) {
+    return false;
   }
-  else if (trans.registerStart == 80 && data_payload_length >= sizeof(LogDataRawSection3)) {
-    memcpy(&raw3, buffer + data_offset, sizeof(LogDataRawSection3));
-    section3.loaded = true;
-    scaleSection3();
 
-    // Try to detect model if we have register values
-    if (section3.loaded) {
-      detectInverterModel();
-    }
-  }
-  else if (trans.registerStart == 120 && data_payload_length >= sizeof(LogDataRawSection4)) {
-    memcpy(&raw4, buffer + data_offset, sizeof(LogDataRawSection4));
-    section4.loaded = true;
-    scaleSection4();
+  uint16_t words = data_payload_length / 2;
+  if (trans.registerStart + words > LUX_INPUT_REGS_CACHED) {
+    words = LUX_INPUT_REGS_CACHED - trans.registerStart;
   }
-  else if (trans.registerStart == 160 && data_payload_length >= sizeof(LogDataRawSection5)) {
-    memcpy(&raw5, buffer + data_offset, sizeof(LogDataRawSection5));
-    section5.loaded = true;
-    scaleSection5();
+  const uint8_t *p = buffer + data_offset;
+  for (uint16_t i = 0; i < words; i++) {
+    regs[trans.registerStart + i] = p[i * 2] | (p[i * 2 + 1] << 8);
   }
-  else {
-    return false;
+
+  switch (bank) {
+    case 0: section1.loaded = true; scaleSection1(); break;
+    case 1: section2.loaded = true; scaleSection2(); break;
+    case 2:
+      section3.loaded = true;
+      scaleSection3();
+      // Try to detect model if we have register values
+      detectInverterModel();
+      break;
+    case 3: section4.loaded = true; scaleSection4(); break;
+    case 4: section5.loaded = true; scaleSection5(); break;
   }
 
-  serialString = String(trans.serialNumber);
+  char serial[sizeof(trans.serialNumber) + 1];  // not NUL-terminated on the wire
+  memcpy(serial, trans.serialNumber, sizeof(trans.serialNumber));
+  serial[sizeof(trans.serialNumber)] = 0;
+  serialString = String(serial);
   // Renamed from 'system.last_data_received' to 'system.lux_data_last_received_time' for full match
   system.lux_data_last_received_time = millis();
   return true;
@@ -145,69 +142,75 @@ void LuxData::detectInverterModel() {
 
 void LuxData::scaleSection1() {
   // Basic scaling
-  section1.lux_status = raw.status; // Matches LXPPacket.py raw name
-  section1.lux_current_solar_voltage_1 = raw.v_pv_1 / 10.0f; // Renamed from pv1_voltage
-  section1.lux_current_solar_voltage_2 = raw.v_pv_2 / 10.0f; // Renamed from pv2_voltage
-  section1.lux_current_solar_voltage_3 = raw.v_pv_3 / 10.0f; // Renamed from pv3_voltage
-  section1.lux_battery_voltage = raw.v_bat / 10.0f; // Renamed from battery_voltage
-  section1.lux_battery_percent = raw.soc; // Matches LXPPacket.py raw name
-  section1.soh = raw.soh;
-  section1.lux_internal_fault = raw.internal_fault; // Matches LXPPacket.py raw name
-  section1.lux_current_solar_output_1 = raw.p_pv_1; // Renamed from pv1_power
-  section1.lux_current_solar_output_2 = raw.p_pv_2; // Renamed from pv2_power
-  section1.lux_current_solar_output_3 = raw.p_pv_3; // Renamed from pv3_power
-  section1.lux_battery_charge = raw.p_charge; // Renamed from charge_power
-  section1.lux_battery_discharge = raw.p_discharge; // Renamed from discharge_power
-  section1.grid_voltage_r = raw.v_ac_r / 10.0f; // Renamed from voltage_ac_r
-  section1.grid_voltage_s = raw.v_ac_s / 10.0f; // Renamed from voltage_ac_s
-  section1.grid_voltage_t = raw.v_ac_t / 10.0f; // Renamed from voltage_ac_t
-  section1.lux_grid_frequency_live = raw.f_ac / 100.0f; // Renamed from frequency_grid
+  section1.lux_status = LUX_INPUT_RAW(regs, STATUS);
+  section1.lux_current_solar_voltage_1 = LUX_INPUT_VALUE(regs, V_PV1);
+  section1.lux_current_solar_voltage_2 = LUX_INPUT_VALUE(regs, V_PV2);
+  section1.lux_current_solar_voltage_3 = LUX_INPUT_VALUE(regs, V_PV3);
+  section1.lux_battery_voltage = LUX_INPUT_VALUE(regs, V_BAT);
+  section1.lux_battery_percent = LUX_INPUT_RAW(regs, SOC);
+  section1.soh = LUX_INPUT_RAW(regs, SOH);
+  section1.lux_internal_fault = LUX_INPUT_RAW(regs, INTERNAL_FAULT);
+  section1.lux_current_solar_output_1 = LUX_INPUT_RAW(regs, P_PV1);
+  section1.lux_current_solar_output_2 = LUX_INPUT_RAW(regs, P_PV2);
+  section1.lux_current_solar_output_3 = LUX_INPUT_RAW(regs, P_PV3);
+  section1.lux_battery_charge = LUX_INPUT_RAW(regs, P_CHARGE);
+  section1.lux_battery_discharge = LUX_INPUT_RAW(regs, P_DISCHARGE);
+  section1.grid_voltage_r = LUX_INPUT_VALUE(regs, V_AC_R);
+  section1.grid_voltage_s = LUX_INPUT_VALUE(regs, V_AC_S);
+  section1.grid_voltage_t = LUX_INPUT_VALUE(regs, V_AC_T);
+  section1.lux_grid_frequency_live = LUX_INPUT_VALUE(regs, F_AC);
 
   // +++ SENSOR 28: ADDED GRID VOLTAGE AVERAGE CALCULATION +++
   section1.lux_grid_voltage_live = (section1.grid_voltage_r +
                               section1.grid_voltage_s +
                               section1.grid_voltage_t) / 3.0f;
 
-  section1.lux_power_from_inverter_live = raw.p_inv; // Renamed from activeInverter_power
-  section1.lux_power_to_inverter_live = raw.p_rec; // Renamed from activeCharge_power
-  section1.lux_power_current_clamp = raw.rms_current / 100.0f; // Renamed from ct_clamp_live
-  section1.grid_power_factor = raw.pf / 1000.0f; // Renamed from grid_power_factor
-  section1.eps_voltage_r = raw.v_eps_r / 10.0f; // Renamed from voltage_eps_r
-  section1.eps_voltage_s = raw.v_eps_s / 10.0f; // Renamed from voltage_eps_s
-  section1.eps_voltage_t = raw.v_eps_t / 10.0f; // Renamed from voltage_eps_t
-  section1.eps_frequency = raw.f_eps / 100.0f; // Renamed from frequency_eps
-  section1.lux_power_to_eps = raw.p_to_eps; // Renamed from active_eps_power
-  section1.apparent_eps_power = raw.apparent_eps_power;
-  int16_t lux_power_to_grid_live = raw.p_to_grid; // Matches LXPPacket.py raw name
-  section1.lux_power_from_grid_live = raw.p_to_user; // Renamed from power_from_grid
-  section1.lux_daily_solar_array_1 = raw.e_pv_1_day / 10.0f; // Renamed from pv1_energy_today
-  section1.lux_daily_solar_array_2 = raw.e_pv_2_day / 10.0f; // Renamed from pv2_energy_today
-  section1.lux_daily_solar_array_3 = raw.e_pv_3_day / 10.0f; // Renamed from pv3_energy_today
-  section1.lux_power_from_inverter_daily = raw.e_inv_day / 10.0f; // Renamed from activeInverter_energy_today
-  section1.lux_power_to_inverter_daily = raw.e_rec_day / 10.0f; // Renamed from ac_charging_today
-  section1.lux_daily_battery_charge = raw.e_chg_day / 10.0f; // Renamed from charging_today
-  section1.lux_daily_battery_discharge = raw.e_dischg_day / 10.0f; // Renamed from discharging_today
-  section1.lux_power_to_eps_daily = raw.e_eps_day / 10.0f; // Renamed from eps_today
-  section1.lux_power_to_grid_daily = raw.e_to_grid_day / 10.0f; // Renamed from exported_today
-  section1.lux_power_from_grid_daily = raw.e_to_user_day / 10.0f; // Renamed from grid_today
-  float bus1_voltage = raw.v_bus_1 / 10.0f; // Renamed from bus1_voltage
-  float bus2_voltage = raw.v_bus_2 / 10.0f; // Renamed from bus2_voltage
+  section1.lux_power_from_inverter_live = LUX_INPUT_RAW(regs, P_INV);
+  section1.lux_power_to_inverter_live = LUX_INPUT_RAW(regs, P_REC);
+  section1.lux_power_current_clamp = LUX_INPUT_VALUE(regs, RMS_CURRENT);
+  section1.grid_power_factor = LUX_INPUT_VALUE(regs, PF);
+  section1.eps_voltage_r = LUX_INPUT_VALUE(regs, V_EPS_R);
+  section1.eps_voltage_s = LUX_INPUT_VALUE(regs, V_EPS_S);
+  section1.eps_voltage_t = LUX_INPUT_VALUE(regs, V_EPS_T);
+  section1.eps_frequency = LUX_INPUT_VALUE(regs, F_EPS);
+  section1.lux_power_to_eps = LUX_INPUT_RAW(regs, P_TO_EPS);
+  section1.apparent_eps_power = LUX_INPUT_RAW(regs, S_EPS);
+  int16_t lux_power_to_grid_live = LUX_INPUT_RAW(regs, P_TO_GRID);
+  section1.lux_power_from_grid_live = LUX_INPUT_RAW(regs, P_TO_USER);
+  section1.lux_daily_solar_array_1 = LUX_INPUT_VALUE(regs, E_PV1_DAY);
+  section1.lux_daily_solar_array_2 = LUX_INPUT_VALUE(regs, E_PV2_DAY);
+  section1.lux_daily_solar_array_3 = LUX_INPUT_VALUE(regs, E_PV3_DAY);
+  section1.lux_power_from_inverter_daily = LUX_INPUT_VALUE(regs, E_INV_DAY);
+  section1.lux_power_to_inverter_daily = LUX_INPUT_VALUE(regs, E_REC_DAY);
+  section1.lux_daily_battery_charge = LUX_INPUT_VALUE(regs, E_CHG_DAY);
+  section1.lux_daily_battery_discharge = LUX_INPUT_VALUE(regs, E_DISCHG_DAY);
+  section1.lux_power_to_eps_daily = LUX_INPUT_VALUE(regs, E_EPS_DAY);
+  section1.lux_power_to_grid_daily = LUX_INPUT_VALUE(regs, E_TO_GRID_DAY);
+  section1.lux_power_from_grid_daily = LUX_INPUT_VALUE(regs, E_TO_USER_DAY);
+  section1.bus1_voltage = LUX_INPUT_VALUE(regs, V_BUS1);
+  section1.bus2_voltage = LUX_INPUT_VALUE(regs, V_BUS2);
 
   // Calculated fields
-  section1.lux_current_solar_output = raw.p_pv_1 + raw.p_pv_2 + raw.p_pv_3; // Uses LXPPacket.py raw names
+  int16_t p_charge = section1.lux_battery_charge;
+  int16_t p_discharge = section1.lux_battery_discharge;
+  int16_t p_to_user = section1.lux_power_from_grid_live;
+  int16_t p_rec = section1.lux_power_to_inverter_live;
+  section1.lux_current_solar_output = section1.lux_current_solar_output_1 +
+                                      section1.lux_current_solar_output_2 +
+                                      section1.lux_current_solar_output_3;
   section1.lux_daily_solar = section1.lux_daily_solar_array_1 +
                              section1.lux_daily_solar_array_2 +
                              section1.lux_daily_solar_array_3;
-  section1.lux_power_to_home = raw.p_to_user - raw.p_rec; // Uses LXPPacket.py raw names
-  section1.lux_battery_flow = (raw.p_discharge > 0) ?
-      -static_cast<float>(raw.p_discharge) : static_cast<float>(raw.p_charge); // Uses LXPPacket.py raw names
-  section1.lux_grid_flow = (raw.p_to_user > 0) ?
-      -static_cast<float>(raw.p_to_user) : static_cast<float>(lux_power_to_grid_live); // Uses LXPPacket.py raw names
+  section1.lux_power_to_home = p_to_user - p_rec;
+  section1.lux_battery_flow = (p_discharge > 0) ?
+      -static_cast<float>(p_discharge) : static_cast<float>(p_charge);
+  section1.lux_grid_flow = (p_to_user > 0) ?
+      -static_cast<float>(p_to_user) : static_cast<float>(lux_power_to_grid_live);
   section1.lux_home_consumption_live =
-      static_cast<float>(raw.p_to_user) -
-      static_cast<float>(raw.p_rec) +
-      static_cast<float>(raw.p_inv) -
-      static_cast<float>(lux_power_to_grid_live); // Uses LXPPacket.py raw names
+      static_cast<float>(p_to_user) -
+      static_cast<float>(p_rec) +
+      static_cast<float>(section1.lux_power_from_inverter_live) -
+      static_cast<float>(lux_power_to_grid_live);
   section1.lux_home_consumption =
       section1.lux_power_from_grid_daily -
       section1.lux_power_to_inverter_daily +
@@ -219,23 +222,23 @@ void LuxData::scaleSection1() {
 }
 
 void LuxData::scaleSection2() {
-  section2.lux_total_solar_array_1 = raw2.e_pv_1_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_total_solar_array_2 = raw2.e_pv_2_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_total_solar_array_3 = raw2.e_pv_3_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_power_from_inverter_total = raw2.e_inv_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_power_to_inverter_total = raw2.e_rec_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_total_battery_charge = raw2.e_chg_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_total_battery_discharge = raw2.e_dischg_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_power_to_eps_total = raw2.e_eps_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_power_to_grid_total = raw2.e_to_grid_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_power_from_grid_total = raw2.e_to_user_all / 10.0f; // Matches LXPPacket.py raw name
-  section2.lux_fault_code = raw2.fault_code; // Matches LXPPacket.py raw name
-  section2.lux_warning_code = raw2.warning_code; // Matches LXPPacket.py raw name
-  section2.lux_internal_temp = raw2.t_inner; // Matches LXPPacket.py raw name
-  section2.lux_radiator1_temp = raw2.t_rad_1; // Matches LXPPacket.py raw name
-  section2.lux_radiator2_temp = raw2.t_rad_2; // Matches LXPPacket.py raw name
-  section2.lux_battery_temperature_live = raw2.t_bat; // Matches LXPPacket.py raw name
-  section2.lux_uptime = raw2.uptime; // Matches LXPPacket.py raw name
+  section2.lux_total_solar_array_1 = LUX_INPUT_VALUE(regs, E_PV1_ALL);
+  section2.lux_total_solar_array_2 = LUX_INPUT_VALUE(regs, E_PV2_ALL);
+  section2.lux_total_solar_array_3 = LUX_INPUT_VALUE(regs, E_PV3_ALL);
+  section2.lux_power_from_inverter_total = LUX_INPUT_VALUE(regs, E_INV_ALL);
+  section2.lux_power_to_inverter_total = LUX_INPUT_VALUE(regs, E_REC_ALL);
+  section2.lux_total_battery_charge = LUX_INPUT_VALUE(regs, E_CHG_ALL);
+  section2.lux_total_battery_discharge = LUX_INPUT_VALUE(regs, E_DISCHG_ALL);
+  section2.lux_power_to_eps_total = LUX_INPUT_VALUE(regs, E_EPS_ALL);
+  section2.lux_power_to_grid_total = LUX_INPUT_VALUE(regs, E_TO_GRID_ALL);
+  section2.lux_power_from_grid_total = LUX_INPUT_VALUE(regs, E_TO_USER_ALL);
+  section2.lux_fault_code = (uint32_t)LUX_INPUT_RAW(regs, FAULT_CODE);
+  section2.lux_warning_code = (uint32_t)LUX_INPUT_RAW(regs, WARNING_CODE);
+  section2.lux_internal_temp = LUX_INPUT_RAW(regs, T_INNER);
+  section2.lux_radiator1_temp = LUX_INPUT_RAW(regs, T_RAD1);
+  section2.lux_radiator2_temp = LUX_INPUT_RAW(regs, T_RAD2);
+  section2.lux_battery_temperature_live = LUX_INPUT_RAW(regs, T_BAT);
+  section2.lux_uptime = (uint32_t)LUX_INPUT_RAW(regs, UPTIME);
 
   // Calculated fields
   section2.lux_total_solar = section2.lux_total_solar_array_1 +
@@ -252,63 +255,51 @@ void LuxData::scaleSection3() {
   // Use model-based scaling if available, otherwise default to 10
   float current_scale = system.current_scaling_factor;
 
-  section3.lux_bms_limit_charge = raw3.max_chg_curr / current_scale; // Matches LXPPacket.py raw name
-  section3.lux_bms_limit_discharge = raw3.max_dischg_curr / current_scale; // Matches LXPPacket.py raw name
-  section3.charge_voltage_ref = raw3.charge_volt_ref / 10.0f; // Matches LXPPacket.py raw name
-  section3.discharge_cutoff_voltage = raw3.dischg_cut_volt / 10.0f; // Matches LXPPacket.py raw name
-  section3.battery_status_inv = raw3.bat_status_inv; // Matches LXPPacket.py raw name
-  section3.lux_battery_count = raw3.bat_count; // Matches LXPPacket.py raw name
-  section3.lux_battery_capacity_ah = raw3.bat_capacity; // Matches LXPPacket.py raw name
-
-  // Handle signed battery current
-  int16_t raw_current = raw3.bat_current;
-  if (raw_current & 0x8000) {
-    raw_current = raw_current - 0x10000;
-  }
-  section3.lux_battery_current = raw_current / 10.0f; // Matches LXPPacket.py raw name
-
-  section3.max_cell_volt = raw3.max_cell_volt / 1000.0f; // Matches LXPPacket.py raw name
-  section3.min_cell_volt = raw3.min_cell_volt / 1000.0f; // Matches LXPPacket.py raw name
-
-  // Handle signed temperatures
-  int16_t raw_max_temp = raw3.max_cell_temp;
-  int16_t raw_min_temp = raw3.min_cell_temp;
-
-  if (raw_max_temp & 0x8000) raw_max_temp -= 0x10000;
-  if (raw_min_temp & 0x8000) raw_min_temp -= 0x10000;
+  section3.lux_bms_limit_charge = LUX_INPUT_RAW(regs, MAX_CHG_CURR) / current_scale;
+  section3.lux_bms_limit_discharge = LUX_INPUT_RAW(regs, MAX_DISCHG_CURR) / current_scale;
+  section3.charge_voltage_ref = LUX_INPUT_VALUE(regs, CHG_VOLT_REF);
+  section3.discharge_cutoff_voltage = LUX_INPUT_VALUE(regs, DISCHG_CUT_VOLT);
+  section3.battery_status_inv = LUX_INPUT_RAW(regs, BAT_STATUS_INV);
+  section3.lux_battery_count = LUX_INPUT_RAW(regs, BAT_COUNT);
+  section3.lux_battery_capacity_ah = LUX_INPUT_RAW(regs, BAT_CAPACITY);
 
-  section3.max_cell_temp = raw_max_temp / 10.0f; // Matches LXPPacket.py raw name
-  section3.min_cell_temp = raw_min_temp / 10.0f; // Matches LXPPacket.py raw name
+  // Signed battery current and cell temperatures: the descriptors are S16
+  section3.lux_battery_current = LUX_INPUT_VALUE(regs, BAT_CURRENT);
+  section3.max_cell_volt = LUX_INPUT_VALUE(regs, MAX_CELL_VOLT);
+  section3.min_cell_volt = LUX_INPUT_VALUE(regs, MIN_CELL_VOLT);
+  section3.max_cell_temp = LUX_INPUT_VALUE(regs, MAX_CELL_TEMP);
+  section3.min_cell_temp = LUX_INPUT_VALUE(regs, MIN_CELL_TEMP);
 
-  section3.lux_battery_cycle_count = raw3.bat_cycle_count; // Matches LXPPacket.py raw name
+  section3.lux_battery_cycle_count = LUX_INPUT_RAW(regs, BAT_CYCLES);
 
   // Calculated fields
-  section3.lux_home_consumption_2_live = raw3.p_load2; // Matches LXPPacket.py raw name
-  section3.lux_home_consumption_2_live_alias = static_cast<float>(raw3.p_load2); // Uses LXPPacket.py raw name
+  section3.lux_home_consumption_2_live = LUX_INPUT_RAW(regs, P_LOAD2);
+  section3.lux_home_consumption_2_live_alias = static_cast<float>(section3.lux_home_consumption_2_live);
 
   // Generate battery status text
   generateBatteryStatusText();
 }
 
 void LuxData::scaleSection4() {
-  section4.lux_current_generator_voltage = raw4.gen_input_volt / 10.0f; // Matches LXPPacket.py raw name
-  section4.lux_current_generator_frequency = raw4.gen_input_freq / 100.0f; // Matches LXPPacket.py raw name
+  section4.lux_current_generator_voltage = LUX_INPUT_VALUE(regs, GEN_VOLT);
+  section4.lux_current_generator_frequency = LUX_INPUT_VALUE(regs, GEN_FREQ);
 
   // Apply threshold from Python implementation
-  section4.lux_current_generator_power = (raw4.gen_power_watt < 125) ? 0 : raw4.gen_power_watt; // Matches LXPPacket.py raw name
-
-  section4.lux_current_generator_power_daily = raw4.gen_power_day / 10.0f; // Matches LXPPacket.py raw name
-  section4.lux_current_generator_power_all = raw4.gen_power_all / 10.0f; // Matches LXPPacket.py raw name
-  section4.lux_current_eps_L1_voltage = raw4.eps_L1_volt / 10.0f; // Matches LXPPacket.py raw name
-  section4.lux_current_eps_L2_voltage = raw4.eps_L2_volt / 10.0f; // Matches LXPPacket.py raw name
-  section4.lux_current_eps_L1_watt = raw4.eps_L1_watt; // Matches LXPPacket.py raw name
-  section4.lux_current_eps_L2_watt = raw4.eps_L2_watt; // Matches LXPPacket.py raw name
+  int16_t gen_power = LUX_INPUT_RAW(regs, GEN_POWER);
+  section4.lux_current_generator_power = (gen_power < 125) ? 0 : gen_power;
+
+  section4.lux_current_generator_power_daily = LUX_INPUT_VALUE(regs, GEN_E_DAY);
+  section4.lux_current_generator_power_all = LUX_INPUT_VALUE(regs, GEN_E_ALL);
+  section4.lux_current_eps_L1_voltage = LUX_INPUT_VALUE(regs, EPS_L1_VOLT);
+  section4.lux_current_eps_L2_voltage = LUX_INPUT_VALUE(regs, EPS_L2_VOLT);
+  section4.lux_current_eps_L1_watt = LUX_INPUT_RAW(regs, EPS_L1_WATT);
+  section4.lux_current_eps_L2_watt = LUX_INPUT_RAW(regs, EPS_L2_WATT);
 }
 
 void LuxData::scaleSection5() {
-  section5.p_load_ongrid = raw5.p_load_ongrid; // Matches LXPPacket.py raw name
-  section5.e_load_day = raw5.e_load_day / 10.0f; // Matches LXPPacket.py raw name
-  section5.e_load_all_l = raw5.e_load_all_l / 10.0f; // Matches LXPPacket.py raw name
+  section5.p_load_ongrid = LUX_INPUT_RAW(regs, P_LOAD);
+  section5.e_load_day = LUX_INPUT_VALUE(regs, E_LOAD_DAY);
+  section5.e_load_all_l = LUX_INPUT_VALUE(regs, E_LOAD_ALL);
 }
 
 void LuxData::generateStatusText() {
@@ -328,11 +319,11 @@ void LuxData::generateStatusText() {
       case 16: system.lux_status_text = STATUS_TEXTS[16]; break;
       case 17: system.lux_status_text = STATUS_TEXTS[17]; break;
       case 20: system.lux_status_text = STATUS_TEXTS[20]; break;
-      case 32: system.lux_status_text = STATUS_TEXTS[32]; break;
-      case 40: system.lux_status_text = STATUS_TEXTS[40]; break;
-      case 64: system.lux_status_text = STATUS_TEXTS[64]; break;
-      case 136: system.lux_status_text = STATUS_TEXTS[136]; break;
-      case 192: system.lux_status_text = STATUS_TEXTS[192]; break;
+      case 32: system.lux_status_text = "AC Battery Charging"; break;
+      case 40: system.lux_status_text = "Solar + Grid > Battery Charging"; break;
+      case 64: system.lux_status_text = "No Grid : Battery > EPS"; break;
+      case 136: system.lux_status_text = "No Grid : Solar > EPS - Surplus > Battery Charging"; break;
+      case 192: system.lux_status_text = "No Grid : Solar + Battery Discharging > EPS"; break;
       default: system.lux_status_text = "Unknown (" + String(section1.lux_status) + ")";
     }
   } else {
@@ -1,5 +1,6 @@
 #pragma once
 #include <Arduino.h>
+#include "lux_regdecode.h"
 
 struct Header {
   uint16_t prefix;
@@ -19,118 +20,10 @@ struct TranslatedData {
   uint8_t  dataFieldLength;
 } __attribute__((packed));
 
-// --- RAW Data Structs ---
-struct LogDataRawSection1 { // Registers 0-39
-  uint16_t status; // Matches LXPPacket.py
-  int16_t  v_pv_1; // Renamed from pv1_voltage to match LXPPacket.py
-  int16_t  v_pv_2; // Renamed from pv2_voltage to match LXPPacket.py
-  int16_t  v_pv_3; // Renamed from pv3_voltage to match LXPPacket.py
-  int16_t  v_bat; // Renamed from battery_voltage to match LXPPacket.py
-  uint8_t  soc; // Matches LXPPacket.py
-  uint8_t  soh; // No direct LXPPacket.py key, kept as-is
-  uint16_t internal_fault; // Matches LXPPacket.py
-  int16_t  p_pv_1; // Renamed from pv1_power to match LXPPacket.py
-  int16_t  p_pv_2; // Renamed from pv2_power to match LXPPacket.py
-  int16_t  p_pv_3; // Renamed from pv3_power to match LXPPacket.py
-  int16_t  p_charge; // Renamed from charge_power to match LXPPacket.py
-  int16_t  p_discharge; // Renamed from discharge_power to match LXPPacket.py
-  int16_t  v_ac_r; // Renamed from voltage_ac_r to match LXPPacket.py
-  int16_t  v_ac_s; // Renamed from voltage_ac_s to match LXPPacket.py
-  int16_t  v_ac_t; // Renamed from voltage_ac_t to match LXPPacket.py
-  int16_t  f_ac; // Renamed from frequency_grid to match LXPPacket.py
-  int16_t  p_inv; // Renamed from activeInverter_power to match LXPPacket.py
-  int16_t  p_rec; // Renamed from activeCharge_power to match LXPPacket.py
-  int16_t  rms_current; // Renamed from ct_clamp_live to match LXPPacket.py
-  int16_t  pf; // Renamed from grid_power_factor to match LXPPacket.py
-  int16_t  v_eps_r; // Renamed from voltage_eps_r to match LXPPacket.py
-  int16_t  v_eps_s; // Renamed from voltage_eps_s to match LXPPacket.py
-  int16_t  v_eps_t; // Renamed from voltage_eps_t to match LXPPacket.py
-  int16_t  f_eps; // Renamed from frequency_eps to match LXPPacket.py
-  int16_t  p_to_eps; // Renamed from active_eps_power to match LXPPacket.py
-  int16_t  apparent_eps_power; // No LXPPacket.py key provided, kept as-is
-  int16_t  p_to_grid; // Matches LXPPacket.py
-  int16_t  p_to_user; // Renamed from power_from_grid to match LXPPacket.py
-  int16_t  e_pv_1_day; // Renamed from pv1_energy_today to match LXPPacket.py
-  int16_t  e_pv_2_day; // Renamed from pv2_energy_today to match LXPPacket.py
-  int16_t  e_pv_3_day; // Renamed from pv3_energy_today to match LXPPacket.py
-  int16_t  e_inv_day; // Renamed from activeInverter_energy_today to match LXPPacket.py
-  int16_t  e_rec_day; // Renamed from ac_charging_today to match LXPPacket.py
-  int16_t  e_chg_day; // Renamed from charging_today to match LXPPacket.py
-  int16_t  e_dischg_day; // Renamed from discharging_today to match LXPPacket.py
-  int16_t  e_eps_day; // Renamed from eps_today to match LXPPacket.py
-  int16_t  e_to_grid_day; // Renamed from exported_today to match LXPPacket.py
-  int16_t  e_to_user_day; // Renamed from grid_today to match LXPPacket.py
-  int16_t  v_bus_1; // Renamed from bus1_voltage to match LXPPacket.py
-  int16_t  v_bus_2; // Renamed from bus2_voltage to match LXPPacket.py
-} __attribute__((packed));
-
-struct LogDataRawSection2 { // Registers 40-79
-  int32_t  e_pv_1_all; // Matches LXPPacket.py
-  int32_t  e_pv_2_all; // Matches LXPPacket.py
-  int32_t  e_pv_3_all; // Matches LXPPacket.py
-  int32_t  e_inv_all; // Matches LXPPacket.py
-  int32_t  e_rec_all; // Matches LXPPacket.py
-  int32_t  e_chg_all; // Matches LXPPacket.py
-  int32_t  e_dischg_all; // Matches LXPPacket.py
-  int32_t  e_eps_all; // Matches LXPPacket.py
-  int32_t  e_to_grid_all; // Matches LXPPacket.py
-  int32_t  e_to_user_all; // Matches LXPPacket.py
-  uint32_t fault_code; // Matches LXPPacket.py
-  uint32_t warning_code; // Matches LXPPacket.py
-  int16_t  t_inner; // Matches LXPPacket.py
-  int16_t  t_rad_1; // Matches LXPPacket.py
-  int16_t  t_rad_2; // Matches LXPPacket.py
-  int16_t  t_bat; // Matches LXPPacket.py
-  uint16_t _reserved2;
-  uint32_t uptime; // Matches LXPPacket.py
-} __attribute__((packed));
-
-struct LogDataRawSection3 { // Registers 80-119
-  uint16_t _reserved3;
-  int16_t  max_chg_curr; // Matches LXPPacket.py
-  int16_t  max_dischg_curr; // Matches LXPPacket.py
-  int16_t  charge_volt_ref; // Matches LXPPacket.py
-  int16_t  dischg_cut_volt; // Matches LXPPacket.py
-  uint8_t  placeholder[20];
-  int16_t  bat_status_inv; // Matches LXPPacket.py
-  int16_t  bat_count; // Matches LXPPacket.py
-  int16_t  bat_capacity; // Matches LXPPacket.py
-  int16_t  bat_current; // Matches LXPPacket.py
-  int16_t  reg99;
-  int16_t  reg100;
-  int16_t  max_cell_volt; // Matches LXPPacket.py
-  int16_t  min_cell_volt; // Matches LXPPacket.py
-  int16_t  max_cell_temp; // Matches LXPPacket.py
-  int16_t  min_cell_temp; // Matches LXPPacket.py
-  uint16_t _reserved4;
-  int16_t  bat_cycle_count; // Matches LXPPacket.py
-  uint8_t  _reserved5[14];
-  int16_t  p_load2; // Matches LXPPacket.py
-  uint8_t  _reserved6[10];
-} __attribute__((packed));
-
-struct LogDataRawSection4 {  // Registers 120-159
-  uint16_t reg120;
-  int16_t  gen_input_volt; // Matches LXPPacket.py
-  int16_t  gen_input_freq; // Matches LXPPacket.py
-  int16_t  gen_power_watt; // Matches LXPPacket.py
-  int16_t  gen_power_day; // Matches LXPPacket.py
-  int16_t  gen_power_all; // Matches LXPPacket.py
-  uint16_t reg126;
-  int16_t  eps_L1_volt; // Matches LXPPacket.py
-  int16_t  eps_L2_volt; // Matches LXPPacket.py
-  int16_t  eps_L1_watt; // Matches LXPPacket.py
-  int16_t  eps_L2_watt; // Matches LXPPacket.py
-  uint8_t  placeholder[50];
-} __attribute__((packed));
-
-struct LogDataRawSection5 {  // Registers 160-199
-  uint8_t  _reserved7[20];
-  int16_t  p_load_ongrid; // Matches LXPPacket.py
-  int16_t  e_load_day; // Matches LXPPacket.py
-  int16_t  e_load_all_l; // Matches LXPPacket.py
-  uint8_t  _reserved8[54];
-} __attribute__((packed));
+// --- RAW register values ---
+// Input registers 0-199, indexed by address. Decoded through the shared
+// descriptor table in lux_regdecode.h (copy of components/luxpower_sna).
+static const uint16_t LUX_INPUT_REGS_CACHED = 200;
 
 // --- SCALED Data Structs ---
 struct Section1 {
@@ -291,11 +184,7 @@ public:
 
   Header header;
   TranslatedData trans;
-  LogDataRawSection1 raw;
-  LogDataRawSection2 raw2;
-  LogDataRawSection3 raw3;
-  LogDataRawSection4 raw4;
-  LogDataRawSection5 raw5;
+  uint16_t regs[LUX_INPUT_REGS_CACHED];
 
   Section1 section1;
   Section2 section2;
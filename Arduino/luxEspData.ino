@@ -3,6 +3,7 @@
 #include <ArduinoOTA.h>
 #include <EEPROM.h>
 #include "LuxParser.h"
+#include "lux_crc.h"     // copy of components/luxpower_sna/lux_crc.h
 
 // ───────────────────────────────── Wi‑Fi / OTA ─────────────────────────────────
 const char* ssid      = "WIFI";
@@ -77,17 +78,6 @@ uint32_t lastPollMs    = 0;
 const    uint32_t POLL = 20000;       // 20 s
 const    uint32_t TCP_TIMEOUT = 15000;// 15 s
 
-// CRC‑16 (Modbus) helper
-uint16_t calcCRC(const uint8_t* data, size_t len) {
-  uint16_t crc = 0xFFFF;
-  while (len--) {
-    crc ^= *data++;
-    for (uint8_t i = 0; i < 8; ++i)
-      crc = (crc >> 1) ^ (crc & 1 ? 0xA001 : 0);
-  }
-  return crc;
-}
-
 // HTML helpers
 String row(const String& k, const String& v, bool isCalculated = false) {
   String cls = isCalculated ? " class='calculated'" : "";
@@ -324,7 +314,7 @@ bool sendRequest(uint8_t bank) {
   };
 
   // Calculate CRC for data frame portion only
-  uint16_t crc = calcCRC(pkt + 20, 16);
+  uint16_t crc = lux_crc16(pkt + 20, 16);
   pkt[36] = crc & 0xFF;
   pkt[37] = crc >> 8;
 
@@ -0,0 +1,216 @@
+// Generated copy of components/luxpower_sna/lux_regdecode.h - do not edit here.
+// Edit the original and run tools/sync_shared_headers.py.
+#pragma once
+// ---------------------------------------------------------------------------
+// Input register decoding engine
+//
+// One descriptor per value: address, width, signedness, bitfield and divisor
+// (addresses from tools/registermap.h, scaling as LXPPacket.py / the HA
+// integration publish it). Every front end decodes through this table:
+//   - ESPHome hub   (luxpower_sna.cpp, INPUT_BINDINGS)
+//   - ESP32 dongle  (lux_mqtt.c, SENSORS[])
+//   - Arduino       (LuxParser.cpp, scaleSectionN)
+//
+// `regs` is always the register space indexed by absolute address. The
+// divisor is applied as `raw / (float)div` - the same operation the old
+// struct decoders did - so values are bit-identical to what they published
+// (tools/bench/bench_decode.cpp checks this and times both paths).
+// Descriptors are static const, so with a constant field id the compiler
+// folds the table load and the type switch away (LUX_INPUT_VALUE below).
+// lux_input_decode_all() is the snapshot path; lux_fields_decode() is the
+// generic loop for runtime descriptor lists.
+//
+// Header-only and valid C and C++.
+// ---------------------------------------------------------------------------
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    LUX_VT_U16 = 0,
+    LUX_VT_S16,
+    LUX_VT_U32,     // low word at addr, high word at addr + 1
+    LUX_VT_S32,
+    LUX_VT_BITS,    // (raw >> shift) & mask
+} lux_val_type_t;
+
+typedef struct {
+    uint16_t addr;
+    uint8_t  type;   // lux_val_type_t
+    uint8_t  shift;  // LUX_VT_BITS only
+    uint16_t mask;   // LUX_VT_BITS only
+    uint16_t div;    // 1 = publish raw
+} lux_field_t;
+
+// Descriptor initializer: LUX_FIELD(105, U16, 0, 0, 1)
+#define LUX_FIELD(addr, type, shift, mask, div) {addr, LUX_VT_##type, shift, mask, div}
+
+// ---- Input register fields ------------------------------------------------
+//   X(id, addr, type, shift, mask, div)
+#define LUX_INPUT_FIELD_LIST(X) \
+    /* 0-39: live values and today's energy */ \
+    X(STATUS,          0, U16,  0, 0,    1) \
+    X(V_PV1,           1, S16,  0, 0,   10) \
+    X(V_PV2,           2, S16,  0, 0,   10) \
+    X(V_PV3,           3, S16,  0, 0,   10) \
+    X(V_BAT,           4, S16,  0, 0,   10) \
+    X(SOC,             5, BITS, 0, 0xFF, 1) \
+    X(SOH,             5, BITS, 8, 0xFF, 1) \
+    X(INTERNAL_FAULT,  6, U16,  0, 0,    1) \
+    X(P_PV1,           7, S16,  0, 0,    1) \
+    X(P_PV2,           8, S16,  0, 0,    1) \
+    X(P_PV3,           9, S16,  0, 0,    1) \
+    X(P_CHARGE,       10, S16,  0, 0,    1) \
+    X(P_DISCHARGE,    11, S16,  0, 0,    1) \
+    X(V_AC_R,         12, S16,  0, 0,   10) \
+    X(V_AC_S,         13, S16,  0, 0,   10) \
+    X(V_AC_T,         14, S16,  0, 0,   10) \
+    X(F_AC,           15, S16,  0, 0,  100) \
+    X(P_INV,          16, S16,  0, 0,    1) \
+    X(P_REC,          17, S16,  0, 0,    1) \
+    X(RMS_CURRENT,    18, S16,  0, 0,  100) \
+    X(PF,             19, S16,  0, 0, 1000) \
+    X(V_EPS_R,        20, S16,  0, 0,   10) \
+    X(V_EPS_S,        21, S16,  0, 0,   10) \
+    X(V_EPS_T,        22, S16,  0, 0,   10) \
+    X(F_EPS,          23, S16,  0, 0,  100) \
+    X(P_TO_EPS,       24, S16,  0, 0,    1) \
+    X(S_EPS,          25, S16,  0, 0,    1) \
+    X(P_TO_GRID,      26, S16,  0, 0,    1) \
+    X(P_TO_USER,      27, S16,  0, 0,    1) \
+    X(E_PV1_DAY,      28, S16,  0, 0,   10) \
+    X(E_PV2_DAY,      29, S16,  0, 0,   10) \
+    X(E_PV3_DAY,      30, S16,  0, 0,   10) \
+    X(E_INV_DAY,      31, S16,  0, 0,   10) \
+    X(E_REC_DAY,      32, S16,  0, 0,   10) \
+    X(E_CHG_DAY,      33, S16,  0, 0,   10) \
+    X(E_DISCHG_DAY,   34, S16,  0, 0,   10) \
+    X(E_EPS_DAY,      35, S16,  0, 0,   10) \
+    X(E_TO_GRID_DAY,  36, S16,  0, 0,   10) \
+    X(E_TO_USER_DAY,  37, S16,  0, 0,   10) \
+    X(V_BUS1,         38, S16,  0, 0,   10) \
+    X(V_BUS2,         39, S16,  0, 0,   10) \
+    /* 40-79: lifetime energy, faults, temperatures */ \
+    X(E_PV1_ALL,      40, S32,  0, 0,   10) \
+    X(E_PV2_ALL,      42, S32,  0, 0,   10) \
+    X(E_PV3_ALL,      44, S32,  0, 0,   10) \
+    X(E_INV_ALL,      46, S32,  0, 0,   10) \
+    X(E_REC_ALL,      48, S32,  0, 0,   10) \
+    X(E_CHG_ALL,      50, S32,  0, 0,   10) \
+    X(E_DISCHG_ALL,   52, S32,  0, 0,   10) \
+    X(E_EPS_ALL,      54, S32,  0, 0,   10) \
+    X(E_TO_GRID_ALL,  56, S32,  0, 0,   10) \
+    X(E_TO_USER_ALL,  58, S32,  0, 0,   10) \
+    X(FAULT_CODE,     60, U32,  0, 0,    1) \
+    X(WARNING_CODE,   62, U32,  0, 0,    1) \
+    X(T_INNER,        64, S16,  0, 0,    1) \
+    X(T_RAD1,         65, S16,  0, 0,    1) \
+    X(T_RAD2,         66, S16,  0, 0,    1) \
+    X(T_BAT,          67, S16,  0, 0,    1) \
+    X(UPTIME,         69, U32,  0, 0,    1) \
+    /* 80-119: BMS */ \
+    X(MAX_CHG_CURR,   81, S16,  0, 0,   10) \
+    X(MAX_DISCHG_CURR,82, S16,  0, 0,   10) \
+    X(CHG_VOLT_REF,   83, S16,  0, 0,   10) \
+    X(DISCHG_CUT_VOLT,84, S16,  0, 0,   10) \
+    X(BAT_STATUS_INV, 95, S16,  0, 0,    1) \
+    X(BAT_COUNT,      96, S16,  0, 0,    1) \
+    X(BAT_CAPACITY,   97, S16,  0, 0,    1) \
+    X(BAT_CURRENT,    98, S16,  0, 0,   10) \
+    X(MAX_CELL_VOLT, 101, S16,  0, 0, 1000) \
+    X(MIN_CELL_VOLT, 102, S16,  0, 0, 1000) \
+    X(MAX_CELL_TEMP, 103, S16,  0, 0,   10) \
+    X(MIN_CELL_TEMP, 104, S16,  0, 0,   10) \
+    X(BAT_CYCLES,    106, S16,  0, 0,    1) \
+    X(P_LOAD2,       114, S16,  0, 0,    1) \
+    /* 120-159: generator, EPS split phase */ \
+    X(GEN_VOLT,      121, S16,  0, 0,   10) \
+    X(GEN_FREQ,      122, S16,  0, 0,  100) \
+    X(GEN_POWER,     123, S16,  0, 0,    1) \
+    X(GEN_E_DAY,     124, S16,  0, 0,   10) \
+    X(GEN_E_ALL,     125, S16,  0, 0,   10) \
+    X(EPS_L1_VOLT,   127, S16,  0, 0,   10) \
+    X(EPS_L2_VOLT,   128, S16,  0, 0,   10) \
+    X(EPS_L1_WATT,   129, S16,  0, 0,    1) \
+    X(EPS_L2_WATT,   130, S16,  0, 0,    1) \
+    /* 160-199: load */ \
+    X(P_LOAD,        170, S16,  0, 0,    1) \
+    X(E_LOAD_DAY,    171, S16,  0, 0,   10) \
+    X(E_LOAD_ALL,    172, S16,  0, 0,   10)
+
+#define LUX_IN_ENUM_(id, addr, type, shift, mask, div) LUX_IN_##id,
+typedef enum {
+    LUX_INPUT_FIELD_LIST(LUX_IN_ENUM_)
+    LUX_IN_COUNT,
+    LUX_IN_NONE = 0xFF,   // derived value, no single field
+} lux_input_field_t;
+#undef LUX_IN_ENUM_
+
+#define LUX_IN_DESC_(id, addr, type, shift, mask, div) LUX_FIELD(addr, type, shift, mask, div),
+static const lux_field_t LUX_INPUT_FIELD[LUX_IN_COUNT] = {
+    LUX_INPUT_FIELD_LIST(LUX_IN_DESC_)
+};
+#undef LUX_IN_DESC_
+
+// ---- Decoding -------------------------------------------------------------
+static inline uint8_t lux_field_width(const lux_field_t *f) {
+    return (f->type == LUX_VT_U32 || f->type == LUX_VT_S32) ? 2 : 1;
+}
+
+// Unscaled value from the field's word(s); `hi` is ignored for 16-bit types.
+// U32 is returned as its two's-complement int32; use lux_field_value for it.
+static inline int32_t lux_field_raw_words(const lux_field_t *f, uint16_t lo, uint16_t hi) {
+    switch (f->type) {
+        case LUX_VT_S16:  return (int16_t)lo;
+        case LUX_VT_U32:
+        case LUX_VT_S32:  return (int32_t)((uint32_t)hi << 16 | lo);
+        case LUX_VT_BITS: return (lo >> f->shift) & f->mask;
+        default:          return lo;
+    }
+}
+
+static inline float lux_field_value_words(const lux_field_t *f, uint16_t lo, uint16_t hi) {
+    float v = f->type == LUX_VT_U32 ? (float)((uint32_t)hi << 16 | lo)
+                                    : (float)lux_field_raw_words(f, lo, hi);
+    return f->div > 1 ? v / (float)f->div : v;
+}
+
+static inline int32_t lux_field_raw(const lux_field_t *f, const uint16_t *regs) {
+    return lux_field_raw_words(f, regs[f->addr],
+                               lux_field_width(f) == 2 ? regs[f->addr + 1] : 0);
+}
+
+static inline float lux_field_value(const lux_field_t *f, const uint16_t *regs) {
+    return lux_field_value_words(f, regs[f->addr],
+                                 lux_field_width(f) == 2 ? regs[f->addr + 1] : 0);
+}
+
+// Decode `n` fields into out[] in one pass.
+static inline void lux_fields_decode(const lux_field_t *f, size_t n,
+                                     const uint16_t *regs, float *out) {
+    for (size_t i = 0; i < n; i++) out[i] = lux_field_value(&f[i], regs);
+}
+
+// Every input field into out[LUX_IN_COUNT]. The list is expanded per type
+// with literal addresses and divisors, so each value compiles to a plain
+// load/convert/divide - the same code the old bank structs produced.
+#define LUX_RAW_U16_(r, a, sh, m)  (float)(r)[a]
+#define LUX_RAW_S16_(r, a, sh, m)  (float)(int16_t)(r)[a]
+#define LUX_RAW_U32_(r, a, sh, m)  (float)((uint32_t)(r)[(a) + 1] << 16 | (r)[a])
+#define LUX_RAW_S32_(r, a, sh, m)  (float)(int32_t)((uint32_t)(r)[(a) + 1] << 16 | (r)[a])
+#define LUX_RAW_BITS_(r, a, sh, m) (float)(((r)[a] >> (sh)) & (m))
+#define LUX_IN_DECODE_(id, addr, type, shift, mask, div) \
+    out[LUX_IN_##id] = (div) > 1 ? LUX_RAW_##type##_(regs, addr, shift, mask) / (float)(div) \
+                                 : LUX_RAW_##type##_(regs, addr, shift, mask);
+static inline void lux_input_decode_all(const uint16_t *regs, float *out) {
+    LUX_INPUT_FIELD_LIST(LUX_IN_DECODE_)
+}
+#undef LUX_IN_DECODE_
+#undef LUX_RAW_U16_
+#undef LUX_RAW_S16_
+#undef LUX_RAW_U32_
+#undef LUX_RAW_S32_
+#undef LUX_RAW_BITS_
+
+// Shorthand for a compile-time field id: LUX_INPUT_VALUE(regs, V_PV1)
+#define LUX_INPUT_VALUE(regs, id) lux_field_value(&LUX_INPUT_FIELD[LUX_IN_##id], (regs))
+#define LUX_INPUT_RAW(regs, id)   lux_field_raw(&LUX_INPUT_FIELD[LUX_IN_##id], (regs))
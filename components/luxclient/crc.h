@@ -2,16 +2,18 @@
 
 #include <cstdint>
 
+#include "lux_crc.h"  // copy of components/luxpower_sna/lux_crc.h
+
 namespace esphome {
 namespace luxclient {
 
 /**
- * @brief Calculate the CRC-16 for the given data.
+ * @brief Calculate the CRC-16/Modbus for the given data.
  * @param data Pointer to the data array.
  * @param len The length of the data.
  * @return The calculated 16-bit CRC.
  */
-uint16_t crc16(const uint8_t *data, uint16_t len);
+inline uint16_t crc16(const uint8_t *data, uint16_t len) { return lux_crc16(data, len); }
 
 }  // namespace luxclient
 }  // namespace esphome
@@ -9,6 +9,14 @@ CONF_PORT                 = "port"
 CONF_DONGLE_SERIAL        = "dongle_serial"
 CONF_INVERTER_SERIAL      = "inverter_serial"
 CONF_HOLD_UPDATE_INTERVAL = "hold_update_interval"
+CONF_SLOW_UPDATE_INTERVAL = "slow_update_interval"  # energy counters, temps, BMS
+CONF_POLL_WINDOW          = "poll_window"    # requests in flight at once (1 = stop-and-wait)
+CONF_MAX_READ_REGISTERS   = "max_read_registers"  # largest single read (dongle limit 127)
+CONF_PUBLISH_DEADBAND     = "publish_deadband"      # absolute, in sensor units
+CONF_PUBLISH_DEADBAND_PCT = "publish_deadband_pct"  # relative to the last value
+CONF_PUBLISH_MAX_AGE      = "publish_max_age"       # forced republish (0s = always)
+CONF_PUBLISH_PER_TICK     = "publish_per_tick"      # sensor updates per loop() tick
+CONF_PUBLISH_BUDGET       = "publish_budget"        # loop() time before updates wait
 CONF_LUXPOWER_SNA_ID      = "luxpower_sna_id"
 CONF_HOST_TEXT_ID         = "host_text_id"   # ← optional: wire scan result → text entity
 
@@ -31,7 +39,15 @@ CONFIG_SCHEMA = cv.Schema({
     cv.Optional(CONF_DONGLE_SERIAL,   default=""): cv.string,
     cv.Optional(CONF_INVERTER_SERIAL, default=""): cv.string,
     cv.Optional(CONF_UPDATE_INTERVAL,      default="20s"): cv.update_interval,
+    cv.Optional(CONF_SLOW_UPDATE_INTERVAL, default="60s"): cv.update_interval,
     cv.Optional(CONF_HOLD_UPDATE_INTERVAL, default="60s"): cv.update_interval,
+    cv.Optional(CONF_POLL_WINDOW,          default=1): cv.int_range(min=1, max=6),
+    cv.Optional(CONF_MAX_READ_REGISTERS,   default=40): cv.int_range(min=1, max=127),
+    cv.Optional(CONF_PUBLISH_DEADBAND,     default=0.0): cv.positive_float,
+    cv.Optional(CONF_PUBLISH_DEADBAND_PCT, default=0.0): cv.percentage,
+    cv.Optional(CONF_PUBLISH_MAX_AGE,      default="300s"): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_PUBLISH_PER_TICK,     default=8): cv.int_range(min=1, max=255),
+    cv.Optional(CONF_PUBLISH_BUDGET,       default="4ms"): cv.positive_time_period_microseconds,
     cv.Optional(CONF_HOST_TEXT_ID): cv.use_id(text.Text),  # ← new
 }).extend(cv.COMPONENT_SCHEMA)
 
@@ -54,7 +70,15 @@ async def to_code(config):
     cg.add(var.set_inverter_serial(inverter))
 
     cg.add(var.set_update_interval(config[CONF_UPDATE_INTERVAL]))
+    cg.add(var.set_slow_update_interval(config[CONF_SLOW_UPDATE_INTERVAL]))
     cg.add(var.set_hold_update_interval(config[CONF_HOLD_UPDATE_INTERVAL]))
+    cg.add(var.set_poll_window(config[CONF_POLL_WINDOW]))
+    cg.add(var.set_max_read_registers(config[CONF_MAX_READ_REGISTERS]))
+    cg.add(var.set_publish_deadband(config[CONF_PUBLISH_DEADBAND],
+                                    config[CONF_PUBLISH_DEADBAND_PCT]))
+    cg.add(var.set_publish_max_age(config[CONF_PUBLISH_MAX_AGE]))
+    cg.add(var.set_publish_budget(config[CONF_PUBLISH_PER_TICK],
+                                  config[CONF_PUBLISH_BUDGET]))
 
     # Wire up host text entity so scan result writes back to lux_config_host
     if CONF_HOST_TEXT_ID in config:
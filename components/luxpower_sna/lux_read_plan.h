@@ -0,0 +1,101 @@
+#pragma once
+// ---------------------------------------------------------------------------
+// Register read planner
+//
+// Callers mark the registers their entities actually use in a lux_reg_set_t
+// and lux_plan_reads() turns that into the fewest, largest reads the
+// transport allows:
+//   - adjacent needed registers are merged into one request
+//   - a run of unused registers up to `max_gap` long is read through (cheaper
+//     than the framing of another request); longer gaps split the request
+//   - no request exceeds `max_count` registers
+//
+// Header-only and valid C and C++: used by the ESPHome hub and the ESP32
+// dongle (cloud client, RS485 master).
+// ---------------------------------------------------------------------------
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define LUX_PLAN_MAX_REG   256                    // sets cover registers 0..255
+#define LUX_PLAN_WORDS     (LUX_PLAN_MAX_REG / 32)
+
+// ---- Per-transport request limits -----------------------------------------
+// A translated-data reply carries a one-byte value_length, so at most 127
+// registers fit. 120 keeps requests aligned to the 40-register banks.
+#define LUX_READ_MAX_TCP   120
+// Modbus RTU FC 0x03/0x04 limit.
+#define LUX_READ_MAX_RTU   125
+
+// Longest unused run still worth reading through. TCP: request + reply
+// framing is ~75 bytes (~37 registers). RTU: 8-byte request, 5-byte reply
+// overhead plus the inverter's turnaround, so keep gaps short.
+#define LUX_READ_GAP_TCP   32
+#define LUX_READ_GAP_RTU   8
+
+typedef struct {
+    uint16_t start;
+    uint16_t count;
+} lux_read_span_t;
+
+typedef struct {
+    uint32_t w[LUX_PLAN_WORDS];
+} lux_reg_set_t;
+
+static inline void lux_regset_clear(lux_reg_set_t *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+static inline void lux_regset_add(lux_reg_set_t *s, uint16_t reg, uint16_t n) {
+    for (; n > 0 && reg < LUX_PLAN_MAX_REG; reg++, n--)
+        s->w[reg >> 5] |= (uint32_t)1 << (reg & 31);
+}
+
+static inline bool lux_regset_has(const lux_reg_set_t *s, uint16_t reg) {
+    return reg < LUX_PLAN_MAX_REG && (s->w[reg >> 5] >> (reg & 31)) & 1;
+}
+
+static inline uint16_t lux_regset_count(const lux_reg_set_t *s) {
+    uint16_t n = 0;
+    for (int i = 0; i < LUX_PLAN_WORDS; i++)
+        n += (uint16_t)__builtin_popcount(s->w[i]);
+    return n;
+}
+
+// Fill `out` with at most `out_cap` reads covering every register in `need`.
+// Returns the number of reads written. If `out_cap` is too small the plan is
+// truncated (callers size it for the worst case, LUX_PLAN_MAX_REG / 2).
+static inline size_t lux_plan_reads(const lux_reg_set_t *need, uint16_t max_count,
+                                    uint16_t max_gap, lux_read_span_t *out,
+                                    size_t out_cap) {
+    size_t n = 0;
+    int start = -1, last = -1;
+    if (max_count == 0) return 0;
+
+    for (int reg = 0; reg < LUX_PLAN_MAX_REG; reg++) {
+        if ((reg & 31) == 0 && need->w[reg >> 5] == 0) {
+            reg += 31;
+            continue;
+        }
+        if (!lux_regset_has(need, (uint16_t)reg)) continue;
+
+        if (start >= 0 && reg - last - 1 <= (int)max_gap && reg - start < (int)max_count) {
+            last = reg;
+            continue;
+        }
+        if (start >= 0) {
+            if (n == out_cap) return n;
+            out[n].start = (uint16_t)start;
+            out[n].count = (uint16_t)(last - start + 1);
+            n++;
+        }
+        start = last = reg;
+    }
+    if (start >= 0 && n < out_cap) {
+        out[n].start = (uint16_t)start;
+        out[n].count = (uint16_t)(last - start + 1);
+        n++;
+    }
+    return n;
+}
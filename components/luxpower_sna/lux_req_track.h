@@ -0,0 +1,271 @@
+#pragma once
+// ---------------------------------------------------------------------------
+// Request tracker: sequence numbers, reply correlation, latency histograms
+//
+// One tracker per upstream link. The sender takes a sequence number for
+// each request (A1 1A header byte 6), registers it with lux_trk_sent() and
+// hands every reply to lux_trk_match(), which classifies it:
+//   LUX_TRK_OK           answers an outstanding request (returned in *req)
+//   LUX_TRK_STALE        answers a request that already timed out
+//   LUX_TRK_DUPLICATE    answers a request that was already answered
+//   LUX_TRK_UNSOLICITED  nobody asked (another client's traffic, or a
+//                        reply older than the recent-history window)
+//
+// Replies are matched on (function, reg_start) - the only fields every
+// firmware is known to echo. The sequence number is used on top of that
+// once the peer has proven it echoes it (LUX_TRK_ECHO_TRUST consecutive
+// replies carrying the request's seq); any reply that doesn't drops trust
+// again. With trust, two requests for the same block can be told apart and
+// a late reply is never taken for the answer to its successor. Without
+// it the oldest matching request wins, as before, and a reply is only
+// called stale / duplicate when no request for its block is outstanding.
+//
+// Latency goes into one log-linear histogram per request kind (input read,
+// hold read, write), in ms. The histogram is unit-agnostic (the hub also
+// keeps µs ones): exact below 8, then 4 bins per power of two up to 2^22
+// (<=25 % bin width). lux_lat_percentile() reads p50/p95/p99 off it.
+//
+// Header-only and valid C and C++: used by the ESPHome hub and the ESP32
+// dongle (:8000 fan-out). Not thread-safe; one task owns a tracker.
+// ---------------------------------------------------------------------------
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define LUX_TRK_MAX         8      // outstanding requests per link
+#define LUX_TRK_RECENT      8      // answered / timed-out requests remembered
+#define LUX_TRK_ECHO_TRUST  3      // seq echoes needed before seq is trusted
+
+#define LUX_LAT_LINEAR      8      // 0..7: one bin per unit
+#define LUX_LAT_SUB         4      // bins per power of two above that
+#define LUX_LAT_MAX         ((1u << 22) - 1)   // larger samples are clamped
+#define LUX_LAT_BINS        (LUX_LAT_LINEAR + (22 - 3) * LUX_LAT_SUB)
+
+typedef enum {
+    LUX_TRK_KIND_INPUT = 0,        // fn 0x04
+    LUX_TRK_KIND_HOLD,             // fn 0x03
+    LUX_TRK_KIND_WRITE,            // fn 0x06 / 0x10
+    LUX_TRK_KINDS,
+} lux_trk_kind_t;
+
+typedef enum {
+    LUX_TRK_OK = 0,
+    LUX_TRK_STALE,
+    LUX_TRK_DUPLICATE,
+    LUX_TRK_UNSOLICITED,
+} lux_trk_result_t;
+
+typedef struct {
+    uint32_t bins[LUX_LAT_BINS];
+    uint32_t count;
+    uint32_t max;
+} lux_lat_hist_t;
+
+typedef struct {
+    uint8_t  seq;
+    uint8_t  fn;
+    uint16_t start;
+    uint16_t count;                // registers (reads) / value (writes)
+    uint32_t sent_ms;
+} lux_trk_req_t;
+
+typedef struct {
+    uint8_t  seq;
+    uint8_t  fn;
+    uint16_t start;
+    bool     expired;              // timed out rather than answered
+} lux_trk_done_t;
+
+typedef struct {
+    uint32_t sent, answered, timeouts;
+    uint32_t stale, duplicates, unsolicited;
+} lux_trk_stats_t;
+
+typedef struct {
+    lux_trk_req_t   req[LUX_TRK_MAX];    // oldest first
+    uint8_t         n;
+    uint8_t         next_seq;
+    uint8_t         echo;                // consecutive replies that echoed seq
+    lux_trk_done_t  recent[LUX_TRK_RECENT];
+    uint8_t         recent_n, recent_pos;
+    uint32_t        timeout_ms;
+    lux_trk_stats_t stats;
+    lux_lat_hist_t  lat[LUX_TRK_KINDS];
+} lux_req_tracker_t;
+
+// ---- Latency histogram -----------------------------------------------------
+static inline unsigned lux_lat_bin(uint32_t v) {
+    if (v > LUX_LAT_MAX) v = LUX_LAT_MAX;
+    if (v < LUX_LAT_LINEAR) return v;
+    unsigned oct = 31u - (unsigned)__builtin_clz(v);           // 3..21
+    return LUX_LAT_LINEAR + (oct - 3) * LUX_LAT_SUB +
+           ((v >> (oct - 2)) & (LUX_LAT_SUB - 1));
+}
+
+// Smallest and largest value a bin holds
+static inline uint32_t lux_lat_bin_lo(unsigned bin) {
+    if (bin < LUX_LAT_LINEAR) return bin;
+    unsigned oct = 3 + (bin - LUX_LAT_LINEAR) / LUX_LAT_SUB;
+    unsigned sub = (bin - LUX_LAT_LINEAR) % LUX_LAT_SUB;
+    return ((uint32_t)(LUX_LAT_SUB + sub)) << (oct - 2);
+}
+
+static inline uint32_t lux_lat_bin_hi(unsigned bin) {
+    return bin + 1 < LUX_LAT_BINS ? lux_lat_bin_lo(bin + 1) - 1 : LUX_LAT_MAX;
+}
+
+static inline void lux_lat_add(lux_lat_hist_t *h, uint32_t v) {
+    h->bins[lux_lat_bin(v)]++;
+    h->count++;
+    if (v > h->max) h->max = v;
+}
+
+static inline void lux_lat_merge(lux_lat_hist_t *dst, const lux_lat_hist_t *src) {
+    for (unsigned i = 0; i < LUX_LAT_BINS; i++) dst->bins[i] += src->bins[i];
+    dst->count += src->count;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+// Value at percentile `pct` (0..100): the bin's midpoint, never above the
+// largest sample seen. 0 when the histogram is empty.
+static inline uint32_t lux_lat_percentile(const lux_lat_hist_t *h, unsigned pct) {
+    if (h->count == 0) return 0;
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * pct + 99) / 100);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (unsigned i = 0; i < LUX_LAT_BINS; i++) {
+        seen += h->bins[i];
+        if (seen < rank) continue;
+        uint32_t mid = (lux_lat_bin_lo(i) + lux_lat_bin_hi(i)) / 2;
+        return mid < h->max ? mid : h->max;
+    }
+    return h->max;
+}
+
+// ---- Tracker ---------------------------------------------------------------
+static inline lux_trk_kind_t lux_trk_kind(uint8_t fn) {
+    return fn == 0x04 ? LUX_TRK_KIND_INPUT
+         : fn == 0x03 ? LUX_TRK_KIND_HOLD
+         :              LUX_TRK_KIND_WRITE;
+}
+
+static inline void lux_trk_init(lux_req_tracker_t *t, uint32_t timeout_ms) {
+    memset(t, 0, sizeof(*t));
+    t->next_seq   = 1;
+    t->timeout_ms = timeout_ms;
+}
+
+// Forget outstanding requests and seq trust (link closed); keeps statistics
+static inline void lux_trk_reset(lux_req_tracker_t *t) {
+    t->n = 0;
+    t->recent_n = t->recent_pos = 0;
+    t->echo = 0;
+}
+
+static inline bool lux_trk_full(const lux_req_tracker_t *t) {
+    return t->n >= LUX_TRK_MAX;
+}
+
+// Sequence number for the next request; 1..255, 0 is never used
+static inline uint8_t lux_trk_next_seq(lux_req_tracker_t *t) {
+    uint8_t s = t->next_seq;
+    t->next_seq = (uint8_t)(s == 255 ? 1 : s + 1);
+    return s;
+}
+
+// Record a request that has just gone out. False if LUX_TRK_MAX are
+// already outstanding (the caller should not have sent it).
+static inline bool lux_trk_sent(lux_req_tracker_t *t, uint8_t seq, uint8_t fn,
+                                uint16_t start, uint16_t count, uint32_t now_ms) {
+    if (t->n >= LUX_TRK_MAX) return false;
+    lux_trk_req_t *r = &t->req[t->n++];
+    r->seq     = seq;
+    r->fn      = fn;
+    r->start   = start;
+    r->count   = count;
+    r->sent_ms = now_ms;
+    t->stats.sent++;
+    return true;
+}
+
+static inline bool lux_trk_seq_trusted(const lux_req_tracker_t *t) {
+    return t->echo >= LUX_TRK_ECHO_TRUST;
+}
+
+static inline void lux_trk_remember_(lux_req_tracker_t *t, const lux_trk_req_t *r,
+                                     bool expired) {
+    lux_trk_done_t *d = &t->recent[t->recent_pos];
+    d->seq     = r->seq;
+    d->fn      = r->fn;
+    d->start   = r->start;
+    d->expired = expired;
+    t->recent_pos = (uint8_t)((t->recent_pos + 1) % LUX_TRK_RECENT);
+    if (t->recent_n < LUX_TRK_RECENT) t->recent_n++;
+}
+
+static inline void lux_trk_remove_(lux_req_tracker_t *t, uint8_t i) {
+    memmove(&t->req[i], &t->req[i + 1], (size_t)(t->n - i - 1) * sizeof(t->req[0]));
+    t->n--;
+}
+
+// Classify a reply. On LUX_TRK_OK the request it answers is removed, its
+// latency recorded and, if `req` is non-NULL, copied there.
+static inline lux_trk_result_t lux_trk_match(lux_req_tracker_t *t, uint8_t seq,
+                                             uint8_t fn, uint16_t start,
+                                             uint32_t now_ms, lux_trk_req_t *req) {
+    int hit = -1, oldest = -1;
+    for (uint8_t i = 0; i < t->n; i++) {
+        if (t->req[i].fn != fn || t->req[i].start != start) continue;
+        if (oldest < 0) oldest = i;
+        if (t->req[i].seq == seq) { hit = i; break; }
+    }
+
+    // Without an exact seq match, look back first (newest first): with trust
+    // a seq we answered or gave up on is a late / repeated reply
+    if (hit < 0) {
+        bool trusted = lux_trk_seq_trusted(t);
+        for (uint8_t k = 0; k < t->recent_n; k++) {
+            const lux_trk_done_t *d =
+                &t->recent[(t->recent_pos + LUX_TRK_RECENT - 1 - k) % LUX_TRK_RECENT];
+            if (d->fn != fn || d->start != start) continue;
+            if (trusted ? d->seq != seq : oldest >= 0) continue;
+            if (d->expired) { t->stats.stale++;      return LUX_TRK_STALE; }
+            else            { t->stats.duplicates++; return LUX_TRK_DUPLICATE; }
+        }
+        // Peer doesn't echo our seq (or stopped): oldest request for the block
+        hit = oldest;
+    }
+    if (hit < 0) {
+        t->stats.unsolicited++;
+        return LUX_TRK_UNSOLICITED;
+    }
+
+    lux_trk_req_t r = t->req[hit];
+    if (r.seq == seq) {
+        if (t->echo < 255) t->echo++;
+    } else {
+        t->echo = 0;
+    }
+    lux_trk_remove_(t, (uint8_t)hit);
+    lux_trk_remember_(t, &r, false);
+    lux_lat_add(&t->lat[lux_trk_kind(fn)], now_ms - r.sent_ms);
+    t->stats.answered++;
+    if (req) *req = r;
+    return LUX_TRK_OK;
+}
+
+// Pop one request older than timeout_ms into *req. Call until false.
+static inline bool lux_trk_expire(lux_req_tracker_t *t, uint32_t now_ms,
+                                  lux_trk_req_t *req) {
+    for (uint8_t i = 0; i < t->n; i++) {
+        if (now_ms - t->req[i].sent_ms <= t->timeout_ms) continue;
+        lux_trk_req_t r = t->req[i];
+        lux_trk_remove_(t, i);
+        lux_trk_remember_(t, &r, true);
+        t->stats.timeouts++;
+        if (req) *req = r;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+// ---------------------------------------------------------------------------
+// Fixed-capacity byte ring for the TCP receive path
+//
+// recv() writes straight into the free span (write_span/commit), frames are
+// inspected in place with peek()/read_span() and released with consume().
+// Nothing is ever moved: consume() only advances the read index, and an
+// emptied ring rewinds to offset 0 so the next frame lands contiguous.
+// N must be a power of two; indices are free-running and masked on access.
+// ---------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace luxpower_sna {
+
+template<size_t N> class LuxRingBuffer {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "LuxRingBuffer size must be a power of two");
+
+  public:
+    static constexpr size_t capacity() { return N; }
+    size_t size() const  { return (size_t)(head_ - tail_); }
+    size_t space() const { return N - size(); }
+    bool   empty() const { return head_ == tail_; }
+    void   clear()       { head_ = tail_ = 0; }
+
+    // Byte at offset `off` from the read position (off < size()).
+    uint8_t peek(size_t off) const { return buf_[(tail_ + off) & (N - 1)]; }
+
+    // Little-endian u16 at `off`, may straddle the wrap point.
+    uint16_t peek_u16(size_t off) const { return (uint16_t)(peek(off) | (peek(off + 1) << 8)); }
+
+    // Contiguous readable bytes starting at `off`; *p points into the ring.
+    size_t read_span(size_t off, const uint8_t **p) const {
+        size_t pos = (tail_ + off) & (N - 1);
+        size_t avail = size() - off;
+        size_t run = N - pos;
+        *p = buf_ + pos;
+        return avail < run ? avail : run;
+    }
+
+    // Contiguous free bytes at the write position, for recv() to fill.
+    size_t write_span(uint8_t **p) {
+        size_t pos = head_ & (N - 1);
+        size_t free_n = space();
+        size_t run = N - pos;
+        *p = buf_ + pos;
+        return free_n < run ? free_n : run;
+    }
+
+    void commit(size_t n) { head_ += (uint32_t)n; }
+
+    void consume(size_t n) {
+        if (n >= size()) {
+            clear();
+            return;
+        }
+        tail_ += (uint32_t)n;
+    }
+
+    // Copy `len` bytes starting at `off` into dst, handling the wrap.
+    void copy_out(size_t off, uint8_t *dst, size_t len) const {
+        const uint8_t *p;
+        size_t first = read_span(off, &p);
+        if (first > len) first = len;
+        memcpy(dst, p, first);
+        if (len > first) memcpy(dst + first, buf_, len - first);
+    }
+
+    // Offset of the first b0,b1 pair at or after `from`, or size() - 1 when
+    // absent (the last byte may still be the start of a split pair).
+    size_t find_pair(uint8_t b0, uint8_t b1, size_t from) const {
+        size_t n = size();
+        for (size_t i = from; i + 1 < n; i++)
+            if (peek(i) == b0 && peek(i + 1) == b1) return i;
+        return n ? n - 1 : 0;
+    }
+
+  private:
+    uint8_t  buf_[N];
+    uint32_t head_ = 0;  // write index (free-running)
+    uint32_t tail_ = 0;  // read index (free-running)
+};
+
+// ---------------------------------------------------------------------------
+// A1 1A framing over the ring: one step of the hub's receive loop, shared
+// with tools/bench/bench_parsers.cpp so the benchmark runs this exact code.
+//
+//   NEED_MORE  fewer than 6 bytes, or the frame is not complete yet
+//   RESYNC     no magic at the read position; *len bytes were skipped
+//   OVERSIZE   length field above max_frame (*len); the magic was dropped
+//   FRAME      *frame / *len is a whole frame - in place when contiguous,
+//              else linearised into `scratch` (max_frame bytes). The caller
+//              consumes *len when done with it.
+// ---------------------------------------------------------------------------
+enum class LuxFrameStep { NEED_MORE, RESYNC, OVERSIZE, FRAME };
+
+template<size_t N>
+LuxFrameStep lux_next_frame(LuxRingBuffer<N> &rx, uint8_t *scratch, size_t max_frame,
+                            const uint8_t **frame, size_t *len) {
+    if (rx.size() < 6) return LuxFrameStep::NEED_MORE;
+
+    if (rx.peek(0) != 0xA1 || rx.peek(1) != 0x1A) {
+        *len = rx.find_pair(0xA1, 0x1A, 1);
+        rx.consume(*len);
+        return LuxFrameStep::RESYNC;
+    }
+
+    size_t total = (size_t)rx.peek_u16(4) + 6;
+    *len = total;
+    if (total > max_frame) {
+        rx.consume(2);  // drop this magic, look for the next one
+        return LuxFrameStep::OVERSIZE;
+    }
+    if (rx.size() < total) return LuxFrameStep::NEED_MORE;
+
+    if (rx.read_span(0, frame) < total) {
+        rx.copy_out(0, scratch, total);
+        *frame = scratch;
+    }
+    return LuxFrameStep::FRAME;
+}
+
+}  // namespace luxpower_sna
+}  // namespace esphome
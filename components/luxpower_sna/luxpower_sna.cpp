@@ -1,10 +1,11 @@
 #include "luxpower_sna.h"
+#include "lux_crc.h"
 #include "esphome/core/log.h"
 #include "esphome/core/helpers.h"
 
 #include <errno.h>
 #include <cstring>
-#include <algorithm>  // std::min, std::max
+#include <algorithm>  // std::min, std::max, std::lower_bound, std::sort
 
 namespace esphome {
 namespace luxpower_sna {
@@ -42,27 +43,90 @@ const char *LuxpowerSNAComponent::BAT_STATUS_TEXTS[17] = {
 };
 
 // ---------------------------------------------------------------------------
-// CRC-16/Modbus
+// Sensor → input register map
 // ---------------------------------------------------------------------------
-uint16_t LuxpowerSNAComponent::crc16_(const uint8_t *data, size_t len) {
-    uint16_t crc = 0xFFFF;
-    while (len--) {
-        crc ^= *data++;
-        for (int i = 0; i < 8; i++)
-            crc = (crc >> 1) ^ (crc & 1 ? 0xA001 : 0);
-    }
-    return crc;
-}
+// F() rows publish one field of lux_regdecode.h straight to the sensor;
+// D() rows are derived sensors, computed in process_derived_(), and list
+// every register they are built from so the planner never skips one. X()
+// rows are F() rows for codes, bitfields and counts, which the publish
+// deadband must never swallow (fault 1 -> 2 is not "close enough"). Text
+// sensors are added separately in build_read_plans_(). The tier follows
+// LuxPollGroup in tools/registermap.h (FAST = live power/voltage, SLOW =
+// energy counters, temperatures, BMS).
+#define F(member, field, tier) {&LuxpowerSNAComponent::member, \
+    LUX_INPUT_FIELD[LUX_IN_##field].addr, lux_field_width(&LUX_INPUT_FIELD[LUX_IN_##field]), \
+    LUX_TIER_##tier, LUX_IN_##field, false}
+#define X(member, field, tier) {&LuxpowerSNAComponent::member, \
+    LUX_INPUT_FIELD[LUX_IN_##field].addr, lux_field_width(&LUX_INPUT_FIELD[LUX_IN_##field]), \
+    LUX_TIER_##tier, LUX_IN_##field, true}
+#define D(member, reg, n, tier) {&LuxpowerSNAComponent::member, reg, n, LUX_TIER_##tier, LUX_IN_NONE, false}
+const LuxpowerSNAComponent::InputBinding LuxpowerSNAComponent::INPUT_BINDINGS[] = {
+    // Bank 0
+    F(pv_v1_, V_PV1, FAST), F(pv_v2_, V_PV2, FAST), F(pv_v3_, V_PV3, FAST), F(bat_v_, V_BAT, FAST),
+    F(bat_soc_, SOC, FAST), F(bat_soh_, SOH, FAST), X(internal_fault_, INTERNAL_FAULT, FAST),
+    F(pv_p1_, P_PV1, FAST), F(pv_p2_, P_PV2, FAST), F(pv_p3_, P_PV3, FAST), D(pv_total_, 7, 3, FAST),
+    F(bat_chg_, P_CHARGE, FAST), F(bat_dischg_, P_DISCHARGE, FAST),
+    F(grid_v_r_, V_AC_R, FAST), F(grid_v_s_, V_AC_S, FAST), F(grid_v_t_, V_AC_T, FAST),
+    F(grid_v_live_, V_AC_R, FAST), F(grid_freq_, F_AC, FAST),
+    F(p_inv_, P_INV, FAST), F(p_rec_, P_REC, FAST), F(rms_current_, RMS_CURRENT, FAST), F(pf_, PF, FAST),
+    F(eps_v_r_, V_EPS_R, FAST), F(eps_v_s_, V_EPS_S, FAST), F(eps_v_t_, V_EPS_T, FAST), F(eps_freq_, F_EPS, FAST),
+    F(p_to_eps_, P_TO_EPS, FAST), F(p_to_grid_, P_TO_GRID, FAST), F(p_to_user_, P_TO_USER, FAST),
+    F(e_pv1_day_, E_PV1_DAY, SLOW), F(e_pv2_day_, E_PV2_DAY, SLOW), F(e_pv3_day_, E_PV3_DAY, SLOW),
+    D(e_pv_day_total_, 28, 3, SLOW),
+    F(e_inv_day_, E_INV_DAY, SLOW), F(e_rec_day_, E_REC_DAY, SLOW), F(e_chg_day_, E_CHG_DAY, SLOW),
+    F(e_dischg_day_, E_DISCHG_DAY, SLOW), F(e_eps_day_, E_EPS_DAY, SLOW),
+    F(e_to_grid_day_, E_TO_GRID_DAY, SLOW), F(e_to_user_day_, E_TO_USER_DAY, SLOW),
+    F(v_bus1_, V_BUS1, FAST), F(v_bus2_, V_BUS2, FAST),
+    D(p_home_, 17, 1, FAST), D(p_home_, 27, 1, FAST),
+    D(bat_flow_, 10, 2, FAST), D(grid_flow_, 26, 2, FAST),
+    D(home_live_, 16, 2, FAST), D(home_live_, 26, 2, FAST),
+    D(home_day_, 31, 2, SLOW), D(home_day_, 36, 2, SLOW),
+    // Bank 1
+    F(e_pv1_all_, E_PV1_ALL, SLOW), F(e_pv2_all_, E_PV2_ALL, SLOW), F(e_pv3_all_, E_PV3_ALL, SLOW),
+    D(e_pv_all_total_, 40, 6, SLOW),
+    F(e_inv_all_, E_INV_ALL, SLOW), F(e_rec_all_, E_REC_ALL, SLOW), F(e_chg_all_, E_CHG_ALL, SLOW),
+    F(e_dischg_all_, E_DISCHG_ALL, SLOW), F(e_eps_all_, E_EPS_ALL, SLOW),
+    F(e_to_grid_all_, E_TO_GRID_ALL, SLOW), F(e_to_user_all_, E_TO_USER_ALL, SLOW),
+    D(home_total_, 46, 4, SLOW), D(home_total_, 56, 4, SLOW),
+    X(fault_code_, FAULT_CODE, FAST), X(warning_code_, WARNING_CODE, FAST),
+    F(t_inner_, T_INNER, SLOW), F(t_rad1_, T_RAD1, SLOW), F(t_rad2_, T_RAD2, SLOW), F(t_bat_, T_BAT, SLOW),
+    F(uptime_, UPTIME, SLOW),
+    // Bank 2
+    F(bms_max_chg_, MAX_CHG_CURR, SLOW), F(bms_max_dischg_, MAX_DISCHG_CURR, SLOW),
+    F(chg_volt_ref_, CHG_VOLT_REF, SLOW), F(dischg_cut_v_, DISCHG_CUT_VOLT, SLOW),
+    X(bat_status_inv_, BAT_STATUS_INV, SLOW), X(bat_count_, BAT_COUNT, SLOW), F(bat_cap_ah_, BAT_CAPACITY, SLOW),
+    F(bat_curr_, BAT_CURRENT, FAST),
+    F(max_cell_v_, MAX_CELL_VOLT, SLOW), F(min_cell_v_, MIN_CELL_VOLT, SLOW),
+    F(max_cell_t_, MAX_CELL_TEMP, SLOW), F(min_cell_t_, MIN_CELL_TEMP, SLOW),
+    X(bat_cycles_, BAT_CYCLES, SLOW), F(p_load2_, P_LOAD2, FAST),
+    // Bank 3
+    F(gen_v_, GEN_VOLT, FAST), F(gen_freq_, GEN_FREQ, FAST), D(gen_p_, 123, 1, FAST),
+    F(gen_p_day_, GEN_E_DAY, SLOW), F(gen_p_all_, GEN_E_ALL, SLOW),
+    F(eps_l1_v_, EPS_L1_VOLT, FAST), F(eps_l2_v_, EPS_L2_VOLT, FAST),
+    F(eps_l1_w_, EPS_L1_WATT, FAST), F(eps_l2_w_, EPS_L2_WATT, FAST),
+    // Bank 4
+    F(p_load_ongrid_, P_LOAD, FAST), F(e_load_day_, E_LOAD_DAY, SLOW), F(e_load_all_, E_LOAD_ALL, SLOW),
+};
+#undef F
+#undef X
+#undef D
+
+const char *const LuxpowerSNAComponent::TIER_NAMES[LUX_TIER_COUNT] = {
+    "fast", "slow", "config",
+};
 
 // ---------------------------------------------------------------------------
 // Component lifecycle
 // ---------------------------------------------------------------------------
 void LuxpowerSNAComponent::setup() {
     ESP_LOGCONFIG(TAG, "LuxPower SNA setup…");
-    memset(recv_buf_, 0, sizeof(recv_buf_));
-    recv_buf_len_ = 0;
-    last_input_poll_ms_ = millis();
-    last_hold_poll_ms_  = millis();
+    rx_.clear();
+    lux_trk_init(&tracker_, RESPONSE_TIMEOUT_MS);
+    build_read_plans_();
+    build_pub_slots_();
+    // Everything is due on the first connected tick
+    uint32_t now = millis();
+    for (auto &t : tiers_) t.due_ms = now;
     // Load persisted host from NVS — runs before MQTT can overwrite it
     load_host_prefs_();
 }
@@ -72,20 +136,80 @@ void LuxpowerSNAComponent::dump_config() {
     ESP_LOGCONFIG(TAG, "  Host: %s:%u", host_.c_str(), port_);
     ESP_LOGCONFIG(TAG, "  Dongle:   %s", dongle_serial_.c_str());
     ESP_LOGCONFIG(TAG, "  Inverter: %s", inverter_serial_.c_str());
-    ESP_LOGCONFIG(TAG, "  Poll interval: %ums, Hold interval: %ums",
-                  update_interval_ms_, hold_interval_ms_);
+    ESP_LOGCONFIG(TAG, "  Poll interval: %ums, Slow interval: %ums, Hold interval: %ums",
+                  update_interval_ms_, slow_interval_ms_, hold_interval_ms_);
+    ESP_LOGCONFIG(TAG, "  Poll window: %u request(s) in flight", poll_window_);
+    ESP_LOGCONFIG(TAG, "  Publish: on change, deadband %.3f / %.1f%%, max age %ums",
+                  deadband_abs_, deadband_rel_ * 100.0f, (unsigned)publish_max_age_ms_);
+    ESP_LOGCONFIG(TAG, "  Publish queue: %u per tick, budget %uus (peak %u, %u coalesced, "
+                  "%u ticks deferred)", pub_per_tick_, (unsigned)pub_budget_us_,
+                  (unsigned)pub_queue_peak_, (unsigned)publishes_coalesced_,
+                  (unsigned)pub_ticks_deferred_);
+    ESP_LOGCONFIG(TAG, "  Read plan (max %u regs/request):", max_read_regs_);
+    std::vector<PollReq> plan;
+    for (uint8_t i = 0; i < LUX_TIER_COUNT; i++) {
+        const TierSched &t = tiers_[i];
+        if (t.nregs == 0) continue;
+        plan_requests_(t.need, t.fn, max_read_regs_, plan);
+        ESP_LOGCONFIG(TAG, "    %-6s %3u regs, %u request(s), every %ums", TIER_NAMES[i],
+                      t.nregs, (unsigned)plan.size(), (unsigned)t.interval_ms);
+        for (const auto &r : plan)
+            ESP_LOGCONFIG(TAG, "      %s %3u..%3u (%u regs)",
+                          r.fn == LUX_FN_READ_INPUT ? "INPUT" : "HOLD ",
+                          r.start, r.start + r.count - 1, r.count);
+    }
     ESP_LOGCONFIG(TAG, "  Switches: %d, Numbers: %d",
                   (int)switches_.size(), (int)numbers_.size());
     ESP_LOGCONFIG(TAG, "  Scan: batch=%u, connect_timeout=%ums, verify_timeout=%ums",
                   (unsigned)LUX_SCAN_BATCH, LUX_SCAN_CONNECT_TIMEOUT,
                   LUX_SCAN_VERIFY_TIMEOUT);
+
+    const lux_trk_stats_t &st = tracker_.stats;
+    ESP_LOGCONFIG(TAG, "  Requests: sent=%u answered=%u timeouts=%u late=%u duplicate=%u "
+                  "unsolicited=%u, dongle echoes seq: %s",
+                  (unsigned)st.sent, (unsigned)st.answered, (unsigned)st.timeouts,
+                  (unsigned)st.stale, (unsigned)st.duplicates, (unsigned)st.unsolicited,
+                  lux_trk_seq_trusted(&tracker_) ? "yes" : "no");
+    ESP_LOGCONFIG(TAG, "  Timing since boot:");
+    for (uint8_t m = 0; m < LUX_TIMING_COUNT; m++) {
+        const lux_lat_hist_t &h = timing_hist_(m);
+        const char *unit = timing_in_us_(m) ? "us" : "ms";
+        if (h.count == 0) {
+            ESP_LOGCONFIG(TAG, "    %-10s no samples", TIMING_NAMES[m]);
+            continue;
+        }
+        ESP_LOGCONFIG(TAG, "    %-10s n=%-6u p50=%u p95=%u p99=%u max=%u %s", TIMING_NAMES[m],
+                      (unsigned)h.count, (unsigned)lux_lat_percentile(&h, 50),
+                      (unsigned)lux_lat_percentile(&h, 95), (unsigned)lux_lat_percentile(&h, 99),
+                      (unsigned)h.max, unit);
+    }
 }
 
 // ---------------------------------------------------------------------------
 // Main loop – non-blocking state machine
 // ---------------------------------------------------------------------------
 void LuxpowerSNAComponent::loop() {
-    uint32_t now = esphome::millis();
+    uint32_t tick_us = micros();
+    uint32_t now     = esphome::millis();
+
+    // ── Timing diagnostics → sensors ──────────────────────────────────────
+    if (now - timing_pub_ms_ >= LUX_TIMING_PUBLISH_MS) {
+        timing_pub_ms_ = now;
+        publish_timing_();
+    }
+
+    step_(now);
+
+    // ── Publish what this tick's budget allows, the rest goes next tick ───
+    drain_publishes_(tick_us);
+    if (pub_tick_us_) {
+        lux_lat_add(&hist_publish_, pub_tick_us_);
+        pub_tick_us_ = 0;
+    }
+    lux_lat_add(&hist_loop_, micros() - tick_us);
+}
+
+void LuxpowerSNAComponent::step_(uint32_t now) {
 
     // ── Watchdog + progress UI while the scan task is running ─────────────
     // Heartbeat-based: the task pulses scan_heartbeat_ms_ after every batch and
@@ -164,83 +288,78 @@ void LuxpowerSNAComponent::loop() {
                 close_socket_();
                 state_ = State::DISCONNECTED;
             }
+        } else {
+            lux_lat_add(&hist_connect_, now - last_connect_ms_);
         }
         return;
     }
 
     // ── Connected – receive data first (always) ───────────────────────────
+    uint32_t recv_us   = micros();
+    size_t   rx_before = rx_.size();
     try_recv_();
+    if (rx_.size() > rx_before) lux_lat_add(&hist_recv_, micros() - recv_us);
     while (try_process_packet_()) {}
 
-    // ── Response timeout guard ────────────────────────────────────────────
-    if (awaiting_ && (now - req_sent_ms_ > RESPONSE_TIMEOUT_MS)) {
-        ESP_LOGW(TAG, "Response timeout (bank %u)", bank_idx_);
-        awaiting_ = false;
-        bank_idx_++;
-        if (state_ == State::POLLING_INPUT && bank_idx_ >= 5) {
-            state_ = State::IDLE;
-        } else if (state_ == State::POLLING_HOLD && bank_idx_ >= 6) {
-            state_ = State::IDLE;
-            initial_hold_done_ = true;
-        } else if (state_ == State::WRITING) {
-            state_ = State::IDLE;
-        }
-    }
-
-    if (awaiting_) return;
+    // ── Per-request timeouts ──────────────────────────────────────────────
+    expire_requests_(now);
 
     // ── State transitions ─────────────────────────────────────────────────
     switch (state_) {
         case State::IDLE: {
+            if (tracker_.n > 0) break;   // late replies from an aborted cycle
             if (!write_queue_.empty()) {
+                // Stays queued if the send drops the link; retried after reconnect
                 auto cmd = write_queue_.front();
-                write_queue_.pop();
-                send_write_single_(cmd.reg, cmd.value);
-                state_ = State::WRITING;
-                awaiting_ = true;
-                req_sent_ms_ = now;
+                if (send_request_(LUX_FN_WRITE_SINGLE, cmd.reg, cmd.value, now)) {
+                    write_queue_.pop();
+                    state_ = State::WRITING;
+                }
                 return;
             }
-            if (!initial_hold_done_) {
-                bank_idx_ = 0;
-                state_ = State::POLLING_HOLD;
-            } else if (now - last_input_poll_ms_ >= update_interval_ms_) {
-                last_input_poll_ms_ = now;
-                bank_idx_ = 0;
-                state_ = State::POLLING_INPUT;
-            } else if (now - last_hold_poll_ms_ >= hold_interval_ms_) {
-                last_hold_poll_ms_ = now;
-                bank_idx_ = 0;
-                state_ = State::POLLING_HOLD;
-            }
+            // Switches need their state before anything else
+            uint8_t due = initial_hold_done_ ? due_tiers_(now) : (1u << LUX_TIER_CONFIG);
+            if (due == 0) break;
+            // Earliest deadline first. Other input tiers that are also due
+            // ride along so their registers coalesce into the same requests.
+            uint8_t first = earliest_tier_(due);
+            if (tiers_[first].fn == LUX_FN_READ_HOLD)
+                begin_cycle_(LUX_FN_READ_HOLD, 1u << first, now);
+            else
+                begin_cycle_(LUX_FN_READ_INPUT, due & ~(1u << LUX_TIER_CONFIG), now);
             break;
         }
 
-        case State::POLLING_INPUT: {
-            static const uint16_t INPUT_BANKS[5] = {0, 40, 80, 120, 160};
-            if (bank_idx_ < 5) {
-                send_read_input_(INPUT_BANKS[bank_idx_]);
-                awaiting_ = true;
-                req_sent_ms_ = now;
-            } else {
-                ESP_LOGI(TAG, "Input poll cycle complete.");
-                state_ = State::IDLE;
-            }
+        case State::WRITING: {
+            if (tracker_.n == 0) state_ = State::IDLE;
             break;
         }
 
+        case State::POLLING_INPUT:
         case State::POLLING_HOLD: {
-            if (bank_idx_ < 6) {
-                send_read_hold_(bank_idx_ * 40);
-                awaiting_ = true;
-                req_sent_ms_ = now;
+            // Keep up to poll_window_ requests on the wire
+            while (tracker_.n < poll_window_ && cycle_next_ < cycle_.size()) {
+                const PollReq &r = cycle_[cycle_next_];
+                if (!send_request_(r.fn, r.start, r.count, now)) return;
+                cycle_next_++;
+            }
+            if (cycle_done_ < cycle_.size()) break;
+
+            if (state_ == State::POLLING_INPUT) {
+                lux_lat_add(&hist_cycle_, now - cycle_start_ms_);
+                ESP_LOGI(TAG, "Input poll cycle complete (%s%s, %u ms).",
+                         (cycle_tiers_ & (1u << LUX_TIER_FAST)) ? "fast " : "",
+                         (cycle_tiers_ & (1u << LUX_TIER_SLOW)) ? "slow " : "",
+                         (unsigned)(now - cycle_start_ms_));
+                ESP_LOGD(TAG, "Publishes: %u emitted, %u suppressed",
+                         (unsigned)publishes_emitted_, (unsigned)publishes_suppressed_);
             } else {
-                ESP_LOGI(TAG, "Hold poll cycle complete.");
+                ESP_LOGI(TAG, "Hold poll cycle complete (%u ms).",
+                         (unsigned)(now - cycle_start_ms_));
                 initial_hold_done_ = true;
-                last_hold_poll_ms_ = now;
                 notify_hold_listeners_();
-                state_ = State::IDLE;
             }
+            state_ = State::IDLE;
             break;
         }
 
@@ -249,6 +368,183 @@ void LuxpowerSNAComponent::loop() {
     }
 }
 
+// ---------------------------------------------------------------------------
+// Read planning
+// ---------------------------------------------------------------------------
+// Only registers some configured entity uses are read. Adjacent ones are
+// merged into requests of up to max_read_regs_; long unused gaps are skipped.
+void LuxpowerSNAComponent::plan_requests_(const lux_reg_set_t &need, uint8_t fn,
+                                          uint16_t max_count, std::vector<PollReq> &out) {
+    lux_read_span_t spans[LUX_PLAN_MAX_REG / 2];
+    size_t n = lux_plan_reads(&need, max_count, LUX_READ_GAP_TCP, spans,
+                              sizeof(spans) / sizeof(spans[0]));
+    out.clear();
+    for (size_t i = 0; i < n; i++)
+        out.push_back(PollReq{fn, spans[i].start, spans[i].count});
+}
+
+void LuxpowerSNAComponent::build_read_plans_() {
+    for (auto &t : tiers_) {
+        lux_regset_clear(&t.need);
+        t.fn = LUX_FN_READ_INPUT;
+    }
+    memset(bank_sensors_, 0, sizeof(bank_sensors_));
+    const InputBinding *prev = nullptr;
+    for (const auto &b : INPUT_BINDINGS) {
+        if (!(this->*b.sensor)) continue;
+        lux_regset_add(&tiers_[b.tier].need, b.reg, b.nregs);
+        // Derived sensors have consecutive rows; count each sensor once
+        if (!prev || prev->sensor != b.sensor) bank_sensors_[b.reg / 40]++;
+        prev = &b;
+    }
+    if (lux_status_text_)     lux_regset_add(&tiers_[LUX_TIER_FAST].need, 0, 1);
+    if (lux_bat_status_text_) lux_regset_add(&tiers_[LUX_TIER_SLOW].need, 95, 1);
+
+    lux_reg_set_t &hold = tiers_[LUX_TIER_CONFIG].need;
+    tiers_[LUX_TIER_CONFIG].fn = LUX_FN_READ_HOLD;
+    for (auto *sw  : switches_) if (sw->get_register()  < 240) lux_regset_add(&hold, sw->get_register(), 1);
+    for (auto *num : numbers_)  if (num->get_register() < 240) lux_regset_add(&hold, num->get_register(), 1);
+    for (auto *t   : times_)    if (t->get_register()   < 240) lux_regset_add(&hold, t->get_register(), 1);
+
+    tiers_[LUX_TIER_FAST].interval_ms   = update_interval_ms_;
+    tiers_[LUX_TIER_SLOW].interval_ms   = slow_interval_ms_;
+    tiers_[LUX_TIER_CONFIG].interval_ms = hold_interval_ms_;
+    for (uint8_t i = 0; i < LUX_TIER_COUNT; i++) {
+        tiers_[i].nregs = lux_regset_count(&tiers_[i].need);
+        ESP_LOGD(TAG, "Tier %s: %u regs", TIER_NAMES[i], tiers_[i].nregs);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Tier scheduling
+// ---------------------------------------------------------------------------
+// Deadlines are compared as signed differences so millis() wrap is harmless.
+uint8_t LuxpowerSNAComponent::due_tiers_(uint32_t now) const {
+    uint8_t due = 0;
+    for (uint8_t i = 0; i < LUX_TIER_COUNT; i++) {
+        const TierSched &t = tiers_[i];
+        if (t.nregs == 0) continue;
+        if ((int32_t)(now - t.due_ms) >= 0) due |= 1u << i;
+    }
+    return due;
+}
+
+// Most overdue tier in `mask`; ties go to the lower tier (FAST before SLOW ...)
+uint8_t LuxpowerSNAComponent::earliest_tier_(uint8_t mask) const {
+    uint8_t best = LUX_TIER_COUNT;
+    for (uint8_t i = 0; i < LUX_TIER_COUNT; i++) {
+        if (!(mask & (1u << i))) continue;
+        if (best == LUX_TIER_COUNT || (int32_t)(tiers_[i].due_ms - tiers_[best].due_ms) < 0)
+            best = i;
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Request pipeline
+// ---------------------------------------------------------------------------
+void LuxpowerSNAComponent::begin_cycle_(uint8_t fn, uint8_t tiers, uint32_t now) {
+    lux_reg_set_t need;
+    lux_regset_clear(&need);
+    for (uint8_t i = 0; i < LUX_TIER_COUNT; i++) {
+        if (!(tiers & (1u << i))) continue;
+        TierSched &t = tiers_[i];
+        for (int w = 0; w < LUX_PLAN_WORDS; w++) need.w[w] |= t.need.w[w];
+        // Advance by whole intervals so the cadence doesn't drift with cycle
+        // length; after a long stall restart from now instead of bursting.
+        t.due_ms += t.interval_ms;
+        if ((int32_t)(now - t.due_ms) >= 0) t.due_ms = now + t.interval_ms;
+    }
+    plan_requests_(need, fn, max_read_regs_, cycle_);
+    state_ = fn == LUX_FN_READ_INPUT ? State::POLLING_INPUT : State::POLLING_HOLD;
+    cycle_tiers_    = tiers;
+    cycle_next_     = 0;
+    cycle_done_     = 0;
+    cycle_start_ms_ = now;
+}
+
+bool LuxpowerSNAComponent::send_request_(uint8_t fn, uint16_t start,
+                                         uint16_t count_or_value, uint32_t now) {
+    if (lux_trk_full(&tracker_)) return false;
+    uint8_t seq = lux_trk_next_seq(&tracker_);
+    bool sent = false;
+    switch (fn) {
+        case LUX_FN_READ_INPUT:   sent = send_read_input_(start, count_or_value, seq);   break;
+        case LUX_FN_READ_HOLD:    sent = send_read_hold_(start, count_or_value, seq);    break;
+        case LUX_FN_WRITE_SINGLE: sent = send_write_single_(start, count_or_value, seq); break;
+        default: return false;
+    }
+    if (!sent) return false;   // send failed and dropped the link
+    lux_trk_sent(&tracker_, seq, fn, start, count_or_value, now);
+    return true;
+}
+
+// Match a reply to its request. Late answers after a timeout, repeats and
+// other clients' traffic echoed to us only count as stale / duplicate /
+// unsolicited; their register data is still applied by the caller.
+void LuxpowerSNAComponent::complete_request_(uint8_t seq, uint8_t fn, uint16_t start,
+                                             uint32_t now) {
+    lux_trk_req_t req;
+    switch (lux_trk_match(&tracker_, seq, fn, start, now, &req)) {
+        case LUX_TRK_OK:
+            ESP_LOGV(TAG, "Reply seq %u fn 0x%02X reg %u after %u ms", seq, fn, start,
+                     (unsigned)(now - req.sent_ms));
+            if (fn != LUX_FN_WRITE_SINGLE) cycle_done_++;
+            break;
+        case LUX_TRK_STALE:
+            ESP_LOGD(TAG, "Late reply seq %u fn 0x%02X reg %u (already timed out)", seq, fn, start);
+            break;
+        case LUX_TRK_DUPLICATE:
+            ESP_LOGD(TAG, "Duplicate reply seq %u fn 0x%02X reg %u", seq, fn, start);
+            break;
+        case LUX_TRK_UNSOLICITED:
+            ESP_LOGV(TAG, "Unsolicited reply seq %u fn 0x%02X reg %u", seq, fn, start);
+            break;
+    }
+}
+
+void LuxpowerSNAComponent::expire_requests_(uint32_t now) {
+    lux_trk_req_t req;
+    while (lux_trk_expire(&tracker_, now, &req)) {
+        ESP_LOGW(TAG, "Response timeout (seq %u fn 0x%02X reg %u)", req.seq, req.fn, req.start);
+        if (req.fn != LUX_FN_WRITE_SINGLE) cycle_done_++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Timing diagnostics
+// ---------------------------------------------------------------------------
+const char *const LuxpowerSNAComponent::TIMING_NAMES[LUX_TIMING_COUNT] = {
+    "connect", "rtt_input", "rtt_hold", "rtt_write", "cycle", "publish", "recv", "loop",
+};
+
+const lux_lat_hist_t &LuxpowerSNAComponent::timing_hist_(uint8_t metric) const {
+    switch (metric) {
+        case LUX_TIMING_RTT_INPUT: return tracker_.lat[LUX_TRK_KIND_INPUT];
+        case LUX_TIMING_RTT_HOLD:  return tracker_.lat[LUX_TRK_KIND_HOLD];
+        case LUX_TIMING_RTT_WRITE: return tracker_.lat[LUX_TRK_KIND_WRITE];
+        case LUX_TIMING_CYCLE:     return hist_cycle_;
+        case LUX_TIMING_PUBLISH:   return hist_publish_;
+        case LUX_TIMING_RECV:      return hist_recv_;
+        case LUX_TIMING_LOOP:      return hist_loop_;
+        default:                   return hist_connect_;
+    }
+}
+
+// Sensors are in ms; the µs histograms are scaled on the way out
+void LuxpowerSNAComponent::publish_timing_() {
+    static const uint8_t PCTS[LUX_TIMING_PCTS] = {50, 95, 99};
+    for (uint8_t m = 0; m < LUX_TIMING_COUNT; m++) {
+        const lux_lat_hist_t &h = timing_hist_(m);
+        if (h.count == 0) continue;
+        float scale = timing_in_us_(m) ? 0.001f : 1.0f;
+        for (uint8_t p = 0; p < LUX_TIMING_PCTS; p++) {
+            sensor::Sensor *s = timing_sensors_[m][p];
+            if (s) enqueue_pub_(s, lux_lat_percentile(&h, PCTS[p]) * scale);
+        }
+    }
+}
+
 // ---------------------------------------------------------------------------
 // Socket helpers
 // ---------------------------------------------------------------------------
@@ -332,19 +628,25 @@ void LuxpowerSNAComponent::close_socket_() {
         close(sock_fd_);
         sock_fd_ = -1;
     }
-    recv_buf_len_ = 0;
-    awaiting_ = false;
+    rx_.clear();
+    lux_trk_reset(&tracker_);
+    bank_published_ = 0;  // every bank is published in full once per connection
     state_ = State::DISCONNECTED;
 }
 
-int LuxpowerSNAComponent::send_bytes_(const uint8_t *data, size_t len) {
-    if (sock_fd_ < 0) return -1;
+// A frame goes out whole or the link is dropped: with requests pipelined, a
+// partial frame (short send or EAGAIN) would desync the dongle's parser for
+// everything sent after it.
+bool LuxpowerSNAComponent::send_bytes_(const uint8_t *data, size_t len) {
+    if (sock_fd_ < 0) return false;
     int ret = send(sock_fd_, data, len, 0);
-    if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    if (ret == (int)len) return true;
+    if (ret < 0)
         ESP_LOGW(TAG, "send() failed: %d – reconnecting", errno);
-        close_socket_();
-    }
-    return ret;
+    else
+        ESP_LOGW(TAG, "send() wrote %d of %u bytes – reconnecting", ret, (unsigned)len);
+    close_socket_();
+    return false;
 }
 
 void LuxpowerSNAComponent::try_recv_() {
@@ -356,64 +658,72 @@ void LuxpowerSNAComponent::try_recv_() {
     struct timeval tv{0, 0};
     if (select(sock_fd_ + 1, &rfds, nullptr, nullptr, &tv) <= 0) return;
 
-    uint8_t tmp[256];
-    int n = recv(sock_fd_, tmp, sizeof(tmp), 0);
-    if (n > 0) {
-        size_t space = sizeof(recv_buf_) - recv_buf_len_;
-        size_t copy_n = (size_t)n < space ? (size_t)n : space;
-        memcpy(recv_buf_ + recv_buf_len_, tmp, copy_n);
-        recv_buf_len_ += copy_n;
-    } else if (n == 0) {
-        ESP_LOGW(TAG, "Connection closed by remote");
-        close_socket_();
-    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
-        ESP_LOGW(TAG, "recv() error %d – reconnecting", errno);
-        close_socket_();
-    }
-}
-
-bool LuxpowerSNAComponent::try_process_packet_() {
-    if (recv_buf_len_ < 6) return false;
-
-    if (recv_buf_[0] != 0xA1 || recv_buf_[1] != 0x1A) {
-        for (size_t i = 1; i + 1 < recv_buf_len_; i++) {
-            if (recv_buf_[i] == 0xA1 && recv_buf_[i+1] == 0x1A) {
-                memmove(recv_buf_, recv_buf_ + i, recv_buf_len_ - i);
-                recv_buf_len_ -= i;
-                return false;
+    // recv() straight into the ring. Loop at most twice: once up to the wrap
+    // point and once more from offset 0 if the first span was filled.
+    // When the ring is full we stop reading and leave the bytes in the lwip
+    // socket buffer until try_process_packet_() frees space — never drop.
+    for (int pass = 0; pass < 2; pass++) {
+        uint8_t *p;
+        size_t span = rx_.write_span(&p);
+        if (span == 0) {
+            ESP_LOGV(TAG, "RX ring full (%u bytes), deferring recv", (unsigned)rx_.size());
+            return;
+        }
+        int n = recv(sock_fd_, p, span, 0);
+        if (n > 0) {
+            rx_.commit((size_t)n);
+            if ((size_t)n < span) return;  // socket drained
+        } else if (n == 0) {
+            ESP_LOGW(TAG, "Connection closed by remote");
+            close_socket_();
+            return;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                ESP_LOGW(TAG, "recv() error %d – reconnecting", errno);
+                close_socket_();
             }
+            return;
         }
-        recv_buf_len_ = 0;
-        return false;
     }
+}
 
-    uint16_t frame_length = (uint16_t)(recv_buf_[4] | (recv_buf_[5] << 8));
-    size_t total = frame_length + 6;
-    if (total > sizeof(recv_buf_)) {
-        ESP_LOGE(TAG, "Packet too large (%u), discarding buffer", (unsigned)total);
-        recv_buf_len_ = 0;
-        return false;
+bool LuxpowerSNAComponent::try_process_packet_() {
+    // Parse in place when the frame is contiguous; only a frame that
+    // straddles the wrap point is linearised into frame_buf_.
+    const uint8_t *p;
+    size_t total;
+    switch (lux_next_frame(rx_, frame_buf_, LUX_MAX_FRAME, &p, &total)) {
+        case LuxFrameStep::NEED_MORE:
+            return false;
+        case LuxFrameStep::RESYNC:
+            ESP_LOGV(TAG, "Resync: skipping %u bytes", (unsigned)total);
+            return true;
+        case LuxFrameStep::OVERSIZE:
+            ESP_LOGE(TAG, "Packet too large (%u), resyncing", (unsigned)total);
+            return true;
+        case LuxFrameStep::FRAME:
+            break;
     }
-    if (recv_buf_len_ < total) return false;
-
-    process_packet_(recv_buf_, total);
+    process_packet_(p, total);
 
-    memmove(recv_buf_, recv_buf_ + total, recv_buf_len_ - total);
-    recv_buf_len_ -= total;
+    // process_packet_ may have closed the socket (which clears the ring)
+    rx_.consume(total);
     return true;
 }
 
 void LuxpowerSNAComponent::process_packet_(const uint8_t *buf, size_t len) {
-    if (len < 20) return;
+    if (len < 8) return;
 
     uint8_t tcp_fn = buf[7];
     ESP_LOGV(TAG, "Packet tcp_fn=0x%02X len=%u", tcp_fn, (unsigned)len);
 
+    // Heartbeats are 19 bytes, shorter than a data header
     if (tcp_fn == LUX_TCP_HEARTBEAT) {
         ESP_LOGD(TAG, "Heartbeat – echoing back");
         send_heartbeat_response_(buf, len);
         return;
     }
+    if (len < 20) return;
 
     if (tcp_fn != LUX_TCP_TRANSLATED_DATA) {
         ESP_LOGV(TAG, "Unknown tcp_function 0x%02X, ignoring", tcp_fn);
@@ -425,7 +735,7 @@ void LuxpowerSNAComponent::process_packet_(const uint8_t *buf, size_t len) {
     const uint8_t *df = buf + 20;
     size_t df_len     = len - 20 - 2;
 
-    uint16_t crc_calc = crc16_(df, df_len);
+    uint16_t crc_calc = lux_crc16(df, df_len);
     uint16_t crc_recv = (uint16_t)(buf[len-2] | (buf[len-1] << 8));
     if (crc_calc != crc_recv) {
         ESP_LOGE(TAG, "CRC mismatch calc=0x%04X recv=0x%04X", crc_calc, crc_recv);
@@ -436,7 +746,7 @@ void LuxpowerSNAComponent::process_packet_(const uint8_t *buf, size_t len) {
     uint8_t  dev_fn = df[1];
     uint16_t reg    = (uint16_t)(df[12] | (df[13] << 8));
 
-    awaiting_ = false;
+    complete_request_(buf[6], dev_fn, reg, millis());
 
     switch (dev_fn) {
         case LUX_FN_READ_INPUT: {
@@ -445,7 +755,6 @@ void LuxpowerSNAComponent::process_packet_(const uint8_t *buf, size_t len) {
             const uint8_t *data = df + 15;
             if (df_len < (size_t)(15 + vlen)) return;
             process_read_input_(reg, data, vlen);
-            bank_idx_++;
             break;
         }
         case LUX_FN_READ_HOLD: {
@@ -454,7 +763,6 @@ void LuxpowerSNAComponent::process_packet_(const uint8_t *buf, size_t len) {
             const uint8_t *data = df + 15;
             if (df_len < (size_t)(15 + vlen)) return;
             process_read_hold_(reg, data, vlen / 2);
-            bank_idx_++;
             break;
         }
         case LUX_FN_WRITE_SINGLE: {
@@ -476,12 +784,13 @@ void LuxpowerSNAComponent::send_heartbeat_response_(const uint8_t *pkt, size_t l
 // ---------------------------------------------------------------------------
 // Packet builders
 // ---------------------------------------------------------------------------
-static void build_header_(uint8_t *buf, const char *dongle, uint16_t data_length) {
+static void build_header_(uint8_t *buf, const char *dongle, uint16_t data_length,
+                          uint8_t seq) {
     uint16_t fl = (uint16_t)(data_length + 14);
     buf[0] = 0xA1; buf[1] = 0x1A;
     buf[2] = 0x02; buf[3] = 0x00;
     buf[4] = fl & 0xFF; buf[5] = fl >> 8;
-    buf[6] = 0x01;
+    buf[6] = seq;
     buf[7] = LUX_TCP_TRANSLATED_DATA;
     memcpy(buf + 8, dongle, 10);
     buf[18] = data_length & 0xFF;
@@ -493,54 +802,55 @@ static void build_header_(uint8_t *buf, const char *dongle, uint16_t data_length
 // dialect the inverter already answers.
 void LuxpowerSNAComponent::build_read_input_packet_(uint8_t *pkt, const char *dongle,
                                                     const char *inverter,
-                                                    uint16_t start_reg, uint16_t count) {
-    build_header_(pkt, dongle, 18);
+                                                    uint16_t start_reg, uint16_t count,
+                                                    uint8_t seq) {
+    build_header_(pkt, dongle, 18, seq);
     uint8_t *df = pkt + 20;
     df[0] = LUX_ACTION_WRITE;
     df[1] = LUX_FN_READ_INPUT;
     memcpy(df + 2, inverter, 10);
     df[12] = start_reg & 0xFF; df[13] = start_reg >> 8;
     df[14] = count & 0xFF;     df[15] = count >> 8;
-    uint16_t crc = crc16_(df, 16);
+    uint16_t crc = lux_crc16(df, 16);
     pkt[36] = crc & 0xFF; pkt[37] = crc >> 8;
 }
 
-void LuxpowerSNAComponent::send_read_input_(uint16_t start_reg, uint16_t count) {
+bool LuxpowerSNAComponent::send_read_input_(uint16_t start_reg, uint16_t count, uint8_t seq) {
     uint8_t pkt[38];
     build_read_input_packet_(pkt, dongle_serial_.c_str(),
-                             inverter_serial_.c_str(), start_reg, count);
-    ESP_LOGD(TAG, "READ_INPUT reg=%u count=%u", start_reg, count);
-    send_bytes_(pkt, 38);
+                             inverter_serial_.c_str(), start_reg, count, seq);
+    ESP_LOGD(TAG, "READ_INPUT reg=%u count=%u seq=%u", start_reg, count, seq);
+    return send_bytes_(pkt, 38);
 }
 
-void LuxpowerSNAComponent::send_read_hold_(uint16_t start_reg, uint16_t count) {
+bool LuxpowerSNAComponent::send_read_hold_(uint16_t start_reg, uint16_t count, uint8_t seq) {
     uint8_t pkt[38];
-    build_header_(pkt, dongle_serial_.c_str(), 18);
+    build_header_(pkt, dongle_serial_.c_str(), 18, seq);
     uint8_t *df = pkt + 20;
     df[0] = LUX_ACTION_WRITE;
     df[1] = LUX_FN_READ_HOLD;
     memcpy(df + 2, inverter_serial_.c_str(), 10);
     df[12] = start_reg & 0xFF; df[13] = start_reg >> 8;
     df[14] = count & 0xFF;     df[15] = count >> 8;
-    uint16_t crc = crc16_(df, 16);
+    uint16_t crc = lux_crc16(df, 16);
     pkt[36] = crc & 0xFF; pkt[37] = crc >> 8;
-    ESP_LOGD(TAG, "READ_HOLD reg=%u count=%u", start_reg, count);
-    send_bytes_(pkt, 38);
+    ESP_LOGD(TAG, "READ_HOLD reg=%u count=%u seq=%u", start_reg, count, seq);
+    return send_bytes_(pkt, 38);
 }
 
-void LuxpowerSNAComponent::send_write_single_(uint16_t reg, uint16_t value) {
+bool LuxpowerSNAComponent::send_write_single_(uint16_t reg, uint16_t value, uint8_t seq) {
     uint8_t pkt[38];
-    build_header_(pkt, dongle_serial_.c_str(), 18);
+    build_header_(pkt, dongle_serial_.c_str(), 18, seq);
     uint8_t *df = pkt + 20;
     df[0] = LUX_ACTION_WRITE;
     df[1] = LUX_FN_WRITE_SINGLE;
     memcpy(df + 2, inverter_serial_.c_str(), 10);
     df[12] = reg & 0xFF;   df[13] = reg >> 8;
     df[14] = value & 0xFF; df[15] = value >> 8;
-    uint16_t crc = crc16_(df, 16);
+    uint16_t crc = lux_crc16(df, 16);
     pkt[36] = crc & 0xFF; pkt[37] = crc >> 8;
-    ESP_LOGI(TAG, "WRITE_SINGLE reg=%u value=%u", reg, value);
-    send_bytes_(pkt, 38);
+    ESP_LOGI(TAG, "WRITE_SINGLE reg=%u value=%u seq=%u", reg, value, seq);
+    return send_bytes_(pkt, 38);
 }
 
 // Write queue bounded — drop with warning when full
@@ -560,46 +870,170 @@ void LuxpowerSNAComponent::queue_write(uint16_t reg, uint16_t value) {
 // ---------------------------------------------------------------------------
 void LuxpowerSNAComponent::process_read_input_(uint16_t start_reg,
                                                const uint8_t *data, size_t data_len) {
-    if (data_len < 80) {
-        ESP_LOGW(TAG, "READ_INPUT start=%u too small (%u)", start_reg, (unsigned)data_len);
+    size_t count = data_len / 2;
+    if (count == 0 || start_reg >= 240) {
+        ESP_LOGW(TAG, "READ_INPUT start=%u len=%u ignored", start_reg, (unsigned)data_len);
         return;
     }
-    // Use memcpy instead of reinterpret_cast to avoid unaligned access on
-    // Xtensa when the raw packet buffer offset is not naturally aligned.
-    switch (start_reg) {
-        case 0: {
-            Bank0 bank;
-            memcpy(&bank, data, sizeof(Bank0));
-            process_bank0_(bank);
-            break;
-        }
-        case 40: {
-            Bank1 bank;
-            memcpy(&bank, data, sizeof(Bank1));
-            process_bank1_(bank);
-            break;
+    if (start_reg + count > 240) count = 240 - start_reg;
+    // Note which banks actually changed while the words go into the cache.
+    // A register seen for the first time counts as changed even if it is 0.
+    uint8_t changed = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint16_t reg = (uint16_t)(start_reg + i);
+        uint16_t w = (uint16_t)(data[i*2] | (data[i*2+1] << 8));
+        if (input_regs_[reg] != w || !lux_regset_has(&input_seen_, reg)) {
+            input_regs_[reg] = w;
+            lux_regset_add(&input_seen_, reg, 1);
+            changed |= (uint8_t)(1u << (reg / 40));
         }
-        case 80: {
-            Bank2 bank;
-            memcpy(&bank, data, sizeof(Bank2));
-            process_bank2_(bank);
-            break;
-        }
-        case 120: {
-            Bank3 bank;
-            memcpy(&bank, data, sizeof(Bank3));
-            process_bank3_(bank);
-            break;
+    }
+    ESP_LOGD(TAG, "READ_INPUT reg=%u count=%u cached", start_reg, (unsigned)count);
+
+    // Work out which 40-register banks to decode: touched by this reply and
+    // either changed or due for a forced refresh.
+    uint32_t now = esphome::millis();
+    uint16_t end = (uint16_t)(start_reg + count);
+    uint8_t decode = 0, force = 0;
+    for (uint16_t bank = start_reg / 40; bank < 5 && bank * 40 < end; bank++) {
+        uint8_t bit = (uint8_t)(1u << bank);
+        if (!(bank_published_ & bit) || now - bank_pub_ms_[bank] >= publish_max_age_ms_) {
+            force |= bit;
+            bank_published_ |= bit;
+            bank_pub_ms_[bank] = now;
+        } else if (!(changed & bit)) {
+            // Raw words identical: every value would be too
+            publishes_suppressed_ += bank_sensors_[bank];
+            continue;
         }
-        case 160: {
-            Bank4 bank;
-            memcpy(&bank, data, sizeof(Bank4));
-            process_bank4_(bank);
-            break;
+        decode |= bit;
+    }
+    if (decode == 0) return;
+
+    // Whole-snapshot decode is a straight-line expansion of the field list,
+    // cheaper than looking descriptors up per binding.
+    float vals[LUX_IN_COUNT];
+    lux_input_decode_all(input_regs_, vals);
+    for (const auto &b : INPUT_BINDINGS) {
+        uint8_t bit = (uint8_t)(1u << (b.reg / 40));
+        if (b.field == LUX_IN_NONE || !(decode & bit)) continue;
+        sensor::Sensor *s = this->*b.sensor;
+        if (!s || !input_have_(b.reg, b.nregs)) continue;
+        force_publish_ = force & bit;
+        pub(s, vals[b.field], b.exact);
+    }
+    process_derived_(decode, force);
+    force_publish_ = false;
+}
+
+bool LuxpowerSNAComponent::input_have_(uint16_t reg, uint16_t n) const {
+    for (; n > 0; reg++, n--)
+        if (!lux_regset_has(&input_seen_, reg)) return false;
+    return true;
+}
+
+// A derived sensor reads every register listed in its D() rows.
+bool LuxpowerSNAComponent::derived_ready_(sensor::Sensor *LuxpowerSNAComponent::*member) const {
+    for (const auto &b : INPUT_BINDINGS)
+        if (b.sensor == member && b.field == LUX_IN_NONE && !input_have_(b.reg, b.nregs))
+            return false;
+    return true;
+}
+
+// Values are a pure function of the raw words, so an unchanged word gives a
+// bit-identical float and the equality test below is the raw comparison.
+// raw_state is the value before the sensor's own filters. `exact` values
+// skip the deadband: only an identical value is suppressed.
+void LuxpowerSNAComponent::pub(sensor::Sensor *s, float v, bool exact) {
+    if (!s) return;
+    // Already waiting: raw_state is older than the queued value, so gating
+    // against it could keep a stale value. Take the newer one unconditionally.
+    auto it = std::lower_bound(pub_slots_.begin(), pub_slots_.end(), s,
+                               [](const PubSlot &p, sensor::Sensor *k) { return p.sensor < k; });
+    if (it != pub_slots_.end() && it->sensor == s && it->pending) {
+        it->value = v;
+        publishes_coalesced_++;
+        return;
+    }
+    if (!force_publish_ && s->has_state()) {
+        float last = s->raw_state;
+        float diff = v > last ? v - last : last - v;
+        float band = exact ? 0.0f
+                           : std::max(deadband_abs_, deadband_rel_ * (last < 0 ? -last : last));
+        if (v == last || diff <= band) {
+            publishes_suppressed_++;
+            return;
         }
-        default:
-            ESP_LOGW(TAG, "Unknown INPUT bank start_reg=%u", start_reg);
-            break;
+    }
+    enqueue_pub_(s, v);
+}
+
+// ---------------------------------------------------------------------------
+// Publish queue
+// ---------------------------------------------------------------------------
+// Every sensor the hub can publish: input bindings (derived ones included)
+// and the timing sensors. Setters have all run by setup().
+void LuxpowerSNAComponent::build_pub_slots_() {
+    pub_slots_.clear();
+    for (const auto &b : INPUT_BINDINGS)
+        if (this->*b.sensor) pub_slots_.push_back(PubSlot{this->*b.sensor, 0.0f, false});
+    for (auto &row : timing_sensors_)
+        for (auto *s : row)
+            if (s) pub_slots_.push_back(PubSlot{s, 0.0f, false});
+    std::sort(pub_slots_.begin(), pub_slots_.end(),
+              [](const PubSlot &a, const PubSlot &b) { return a.sensor < b.sensor; });
+    pub_slots_.erase(std::unique(pub_slots_.begin(), pub_slots_.end(),
+                                 [](const PubSlot &a, const PubSlot &b) {
+                                     return a.sensor == b.sensor;
+                                 }),
+                     pub_slots_.end());
+    pub_fifo_.reserve(pub_slots_.size());
+}
+
+// Binary search for the sensor's slot; a pending one takes the newer value.
+// A sensor without a slot (not expected) is published on the spot.
+void LuxpowerSNAComponent::enqueue_pub_(sensor::Sensor *s, float v) {
+    auto it = std::lower_bound(pub_slots_.begin(), pub_slots_.end(), s,
+                               [](const PubSlot &p, sensor::Sensor *k) { return p.sensor < k; });
+    if (it == pub_slots_.end() || it->sensor != s) {
+        uint32_t t0 = micros();
+        publishes_emitted_++;
+        s->publish_state(v);
+        pub_tick_us_ += micros() - t0;
+        return;
+    }
+    it->value = v;
+    if (it->pending) {
+        publishes_coalesced_++;
+        return;
+    }
+    it->pending = true;
+    pub_fifo_.push_back((uint16_t)(it - pub_slots_.begin()));
+    uint32_t depth = (uint32_t)(pub_fifo_.size() - pub_head_);
+    if (depth > pub_queue_peak_) pub_queue_peak_ = depth;
+}
+
+// publish_state() runs the sensor's filters and every frontend (API, MQTT,
+// web_server) synchronously, so this is where a burst costs loop time.
+// Every publish path adds its time to pub_tick_us_; loop() records the sum.
+void LuxpowerSNAComponent::drain_publishes_(uint32_t tick_start_us) {
+    if (pub_head_ == pub_fifo_.size()) return;
+    uint32_t t0 = micros();
+    uint8_t  n  = 0;
+    do {
+        PubSlot &p = pub_slots_[pub_fifo_[pub_head_++]];
+        p.pending = false;
+        publishes_emitted_++;
+        p.sensor->publish_state(p.value);
+    } while (pub_head_ < pub_fifo_.size() && ++n < pub_per_tick_ &&
+             micros() - tick_start_us < pub_budget_us_);
+
+    pub_tick_us_ += micros() - t0;
+    if (pub_head_ == pub_fifo_.size()) {
+        pub_fifo_.clear();
+        pub_head_ = 0;
+    } else {
+        pub_ticks_deferred_++;
     }
 }
 
@@ -619,155 +1053,93 @@ void LuxpowerSNAComponent::process_write_single_(uint16_t reg, uint16_t value) {
         hold_regs_[reg] = value;
         notify_hold_listeners_();
     }
-    state_ = State::IDLE;
 }
 
+// Text sensors are few and rarely change, so they publish directly.
+void LuxpowerSNAComponent::pub(text_sensor::TextSensor *s, const std::string &v) {
+    if (!s) return;
+    uint32_t t0 = micros();
+    s->publish_state(v);
+    pub_tick_us_ += micros() - t0;
+}
+
+// Listeners publish their own state from the new hold values.
 void LuxpowerSNAComponent::notify_hold_listeners_() {
+    uint32_t t0 = micros();
     for (auto *sw  : switches_) sw->on_hold_update(hold_regs_);
     for (auto *num : numbers_)  num->on_hold_update(hold_regs_);
     for (auto *t   : times_)    t->on_hold_update(hold_regs_);
+    pub_tick_us_ += micros() - t0;
 }
 
 // ---------------------------------------------------------------------------
-// Bank 0 processing
+// Derived sensors and status texts
 // ---------------------------------------------------------------------------
-void LuxpowerSNAComponent::process_bank0_(const Bank0 &d) {
-    pub(pv_v1_, d.v_pv_1 / 10.0f);
-    pub(pv_v2_, d.v_pv_2 / 10.0f);
-    pub(pv_v3_, d.v_pv_3 / 10.0f);
-    pub(bat_v_,    d.v_bat / 10.0f);
-    pub(bat_soc_,  d.soc);
-    pub(bat_soh_,  d.soh);
-    pub(internal_fault_, (float)d.internal_fault);
-    pub(pv_p1_, d.p_pv_1);
-    pub(pv_p2_, d.p_pv_2);
-    pub(pv_p3_, d.p_pv_3);
-    pub(pv_total_, (float)(d.p_pv_1 + d.p_pv_2 + d.p_pv_3));
-    pub(bat_chg_,    d.p_charge);
-    pub(bat_dischg_, d.p_discharge);
-    pub(grid_v_r_,    d.v_ac_r / 10.0f);
-    pub(grid_v_s_,    d.v_ac_s / 10.0f);
-    pub(grid_v_t_,    d.v_ac_t / 10.0f);
-    pub(grid_v_live_, d.v_ac_r / 10.0f);
-    pub(grid_freq_,   d.f_ac / 100.0f);
-    pub(p_inv_,        d.p_inv);
-    pub(p_rec_,        d.p_rec);
-    pub(rms_current_,  d.rms_current / 100.0f);
-    pub(pf_,           d.pf / 1000.0f);
-    pub(eps_v_r_,  d.v_eps_r / 10.0f);
-    pub(eps_v_s_,  d.v_eps_s / 10.0f);
-    pub(eps_v_t_,  d.v_eps_t / 10.0f);
-    pub(eps_freq_, d.f_eps / 100.0f);
-    pub(p_to_eps_, d.p_to_eps);
-    pub(p_to_grid_, d.p_to_grid);
-    pub(p_to_user_, d.p_to_user);
-    pub(e_pv1_day_,     d.e_pv_1_day / 10.0f);
-    pub(e_pv2_day_,     d.e_pv_2_day / 10.0f);
-    pub(e_pv3_day_,     d.e_pv_3_day / 10.0f);
-    pub(e_pv_day_total_, (d.e_pv_1_day + d.e_pv_2_day + d.e_pv_3_day) / 10.0f);
-    pub(e_inv_day_,     d.e_inv_day / 10.0f);
-    pub(e_rec_day_,     d.e_rec_day / 10.0f);
-    pub(e_chg_day_,     d.e_chg_day / 10.0f);
-    pub(e_dischg_day_,  d.e_dischg_day / 10.0f);
-    pub(e_eps_day_,     d.e_eps_day / 10.0f);
-    pub(e_to_grid_day_, d.e_to_grid_day / 10.0f);
-    pub(e_to_user_day_, d.e_to_user_day / 10.0f);
-    pub(v_bus1_, d.v_bus_1 / 10.0f);
-    pub(v_bus2_, d.v_bus_2 / 10.0f);
-    float home_live = (float)d.p_to_user - d.p_rec + d.p_inv - d.p_to_grid;
-    float home_day  = (d.e_to_user_day - d.e_rec_day + d.e_inv_day - d.e_to_grid_day) / 10.0f;
-    pub(p_home_,   (float)(d.p_to_user - d.p_rec));
-    pub(bat_flow_, (d.p_discharge > 0) ? -(float)d.p_discharge : (float)d.p_charge);
-    pub(grid_flow_,(d.p_to_user > 0)   ? -(float)d.p_to_user   : (float)d.p_to_grid);
-    pub(home_live_, home_live);
-    pub(home_day_,  home_day);
-    if (d.status < 193 && STATUS_TEXTS[d.status] && strlen(STATUS_TEXTS[d.status]) > 0) {
-        pub(lux_status_text_, STATUS_TEXTS[d.status]);
-    } else {
-        pub(lux_status_text_, "Unknown Status");
+// Values computed from more than one field (or with a transform). Plain
+// fields are published straight from INPUT_BINDINGS in process_read_input_.
+// Each one waits until the registers in its D() rows have all arrived.
+void LuxpowerSNAComponent::process_derived_(uint8_t banks, uint8_t force) {
+    const uint16_t *r = input_regs_;
+#define READY(member) (member && derived_ready_(&LuxpowerSNAComponent::member))
+
+    if (banks & 0x01) {
+        force_publish_ = force & 0x01;
+        int32_t p_pv1 = LUX_INPUT_RAW(r, P_PV1), p_pv2 = LUX_INPUT_RAW(r, P_PV2);
+        int32_t p_pv3 = LUX_INPUT_RAW(r, P_PV3);
+        int32_t p_chg = LUX_INPUT_RAW(r, P_CHARGE), p_dis = LUX_INPUT_RAW(r, P_DISCHARGE);
+        int32_t p_inv = LUX_INPUT_RAW(r, P_INV), p_rec = LUX_INPUT_RAW(r, P_REC);
+        int32_t p_to_grid = LUX_INPUT_RAW(r, P_TO_GRID), p_to_user = LUX_INPUT_RAW(r, P_TO_USER);
+        int32_t e_inv = LUX_INPUT_RAW(r, E_INV_DAY), e_rec = LUX_INPUT_RAW(r, E_REC_DAY);
+        int32_t e_to_grid = LUX_INPUT_RAW(r, E_TO_GRID_DAY), e_to_user = LUX_INPUT_RAW(r, E_TO_USER_DAY);
+
+        if (READY(pv_total_)) pub(pv_total_, (float)(p_pv1 + p_pv2 + p_pv3));
+        if (READY(e_pv_day_total_))
+            pub(e_pv_day_total_, (LUX_INPUT_RAW(r, E_PV1_DAY) + LUX_INPUT_RAW(r, E_PV2_DAY) +
+                                  LUX_INPUT_RAW(r, E_PV3_DAY)) / 10.0f);
+        if (READY(p_home_))    pub(p_home_,   (float)(p_to_user - p_rec));
+        if (READY(bat_flow_))  pub(bat_flow_, (p_dis > 0) ? -(float)p_dis : (float)p_chg);
+        if (READY(grid_flow_)) pub(grid_flow_,(p_to_user > 0) ? -(float)p_to_user : (float)p_to_grid);
+        if (READY(home_live_)) pub(home_live_, (float)p_to_user - p_rec + p_inv - p_to_grid);
+        if (READY(home_day_))  pub(home_day_,  (e_to_user - e_rec + e_inv - e_to_grid) / 10.0f);
+
+        uint16_t status_reg = LUX_INPUT_FIELD[LUX_IN_STATUS].addr;
+        uint16_t status = r[status_reg];
+        if (input_have_(status_reg, 1)) {
+            if (status < 193 && STATUS_TEXTS[status] && strlen(STATUS_TEXTS[status]) > 0) {
+                pub(lux_status_text_, STATUS_TEXTS[status]);
+            } else {
+                pub(lux_status_text_, "Unknown Status");
+            }
+        }
     }
-}
-
-// ---------------------------------------------------------------------------
-// Bank 1 processing
-// ---------------------------------------------------------------------------
-void LuxpowerSNAComponent::process_bank1_(const Bank1 &d) {
-    pub(e_pv1_all_,      d.e_pv_1_all / 10.0f);
-    pub(e_pv2_all_,      d.e_pv_2_all / 10.0f);
-    pub(e_pv3_all_,      d.e_pv_3_all / 10.0f);
-    pub(e_pv_all_total_, (d.e_pv_1_all + d.e_pv_2_all + d.e_pv_3_all) / 10.0f);
-    pub(e_inv_all_,      d.e_inv_all / 10.0f);
-    pub(e_rec_all_,      d.e_rec_all / 10.0f);
-    pub(e_chg_all_,      d.e_chg_all / 10.0f);
-    pub(e_dischg_all_,   d.e_dischg_all / 10.0f);
-    pub(e_eps_all_,      d.e_eps_all / 10.0f);
-    pub(e_to_grid_all_,  d.e_to_grid_all / 10.0f);
-    pub(e_to_user_all_,  d.e_to_user_all / 10.0f);
-    pub(fault_code_,   (float)d.fault_code);
-    pub(warning_code_, (float)d.warning_code);
-    pub(t_inner_, (float)d.t_inner);
-    pub(t_rad1_,  (float)d.t_rad_1);
-    pub(t_rad2_,  (float)d.t_rad_2);
-    pub(t_bat_,   (float)d.t_bat);
-    pub(uptime_,  (float)d.uptime);
-    float home_total = (d.e_to_user_all - d.e_rec_all + d.e_inv_all - d.e_to_grid_all) / 10.0f;
-    pub(home_total_, home_total);
-}
 
-// ---------------------------------------------------------------------------
-// Bank 2 processing
-// ---------------------------------------------------------------------------
-void LuxpowerSNAComponent::process_bank2_(const Bank2 &d) {
-    pub(bms_max_chg_,   d.max_chg_curr / 10.0f);
-    pub(bms_max_dischg_,d.max_dischg_curr / 10.0f);
-    pub(chg_volt_ref_,  d.charge_volt_ref / 10.0f);
-    pub(dischg_cut_v_,  d.dischg_cut_volt / 10.0f);
-    pub(bat_status_inv_,(float)d.bat_status_inv);
-    pub(bat_count_,     (float)d.bat_count);
-    pub(bat_cap_ah_,    (float)d.bat_capacity);
-    int16_t bc = d.bat_current;
-    pub(bat_curr_, bc / 10.0f);
-    pub(max_cell_v_, d.max_cell_volt / 1000.0f);
-    pub(min_cell_v_, d.min_cell_volt / 1000.0f);
-    int16_t max_t = d.max_cell_temp;
-    int16_t min_t = d.min_cell_temp;
-    if (max_t & 0x8000) max_t -= 0x10000;
-    if (min_t & 0x8000) min_t -= 0x10000;
-    pub(max_cell_t_, max_t / 10.0f);
-    pub(min_cell_t_, min_t / 10.0f);
-    pub(bat_cycles_, (float)d.bat_cycle_count);
-    pub(p_load2_,    (float)d.p_load2);
-    uint8_t bs = (uint8_t)(d.bat_status_inv < 17 ? d.bat_status_inv : 16);
-    if (BAT_STATUS_TEXTS[bs] && strlen(BAT_STATUS_TEXTS[bs]) > 0) {
-        pub(lux_bat_status_text_, BAT_STATUS_TEXTS[bs]);
-    } else {
-        pub(lux_bat_status_text_, "Unknown Battery Status");
+    if (banks & 0x02) {
+        force_publish_ = force & 0x02;
+        if (READY(e_pv_all_total_))
+            pub(e_pv_all_total_, (LUX_INPUT_RAW(r, E_PV1_ALL) + LUX_INPUT_RAW(r, E_PV2_ALL) +
+                                  LUX_INPUT_RAW(r, E_PV3_ALL)) / 10.0f);
+        if (READY(home_total_))
+            pub(home_total_, (LUX_INPUT_RAW(r, E_TO_USER_ALL) - LUX_INPUT_RAW(r, E_REC_ALL) +
+                              LUX_INPUT_RAW(r, E_INV_ALL) - LUX_INPUT_RAW(r, E_TO_GRID_ALL)) / 10.0f);
     }
-}
 
-// ---------------------------------------------------------------------------
-// Bank 3 processing
-// ---------------------------------------------------------------------------
-void LuxpowerSNAComponent::process_bank3_(const Bank3 &d) {
-    pub(gen_v_,     d.gen_input_volt / 10.0f);
-    pub(gen_freq_,  d.gen_input_freq / 100.0f);
-    int16_t gen_p = (d.gen_power_watt < 125) ? 0 : d.gen_power_watt;
-    pub(gen_p_,     (float)gen_p);
-    pub(gen_p_day_, d.gen_power_day / 10.0f);
-    pub(gen_p_all_, d.gen_power_all / 10.0f);
-    pub(eps_l1_v_,  d.eps_L1_volt / 10.0f);
-    pub(eps_l2_v_,  d.eps_L2_volt / 10.0f);
-    pub(eps_l1_w_,  (float)d.eps_L1_watt);
-    pub(eps_l2_w_,  (float)d.eps_L2_watt);
-}
+    if ((banks & 0x04) &&
+        input_have_(LUX_INPUT_FIELD[LUX_IN_BAT_STATUS_INV].addr, 1)) {
+        int32_t st = LUX_INPUT_RAW(r, BAT_STATUS_INV);
+        uint8_t bs = (uint8_t)(st < 17 ? st : 16);
+        if (BAT_STATUS_TEXTS[bs] && strlen(BAT_STATUS_TEXTS[bs]) > 0) {
+            pub(lux_bat_status_text_, BAT_STATUS_TEXTS[bs]);
+        } else {
+            pub(lux_bat_status_text_, "Unknown Battery Status");
+        }
+    }
 
-// ---------------------------------------------------------------------------
-// Bank 4 processing
-// ---------------------------------------------------------------------------
-void LuxpowerSNAComponent::process_bank4_(const Bank4 &d) {
-    pub(p_load_ongrid_, (float)d.p_load_ongrid);
-    pub(e_load_day_,    d.e_load_day / 10.0f);
-    pub(e_load_all_,    d.e_load_all_l / 10.0f);
+    if (banks & 0x08) {
+        force_publish_ = force & 0x08;
+        int32_t gen_p = LUX_INPUT_RAW(r, GEN_POWER);
+        if (READY(gen_p_)) pub(gen_p_, (float)(gen_p < 125 ? 0 : gen_p));
+    }
+#undef READY
 }
 
 // ---------------------------------------------------------------------------
@@ -1023,8 +1395,9 @@ bool LuxpowerSNAComponent::probe_lux_(const char *ip, uint16_t port) {
     }
 
     uint8_t pkt[38];
+    // One-shot on its own socket (scan task): a fixed seq, no tracker
     build_read_input_packet_(pkt, dongle_serial_.c_str(),
-                             inverter_serial_.c_str(), 0, 40);
+                             inverter_serial_.c_str(), 0, 40, 0x01);
     if (send(fd, pkt, sizeof(pkt), 0) != (int) sizeof(pkt)) {
         close(fd);
         return false;
@@ -24,6 +24,11 @@
 #include "esphome/components/button/button.h"
 #include "esphome/core/time.h"
 
+#include "lux_ring_buffer.h"
+#include "lux_read_plan.h"
+#include "lux_req_track.h"
+#include "lux_regdecode.h"
+
 #include "lwip/sockets.h"
 #include "lwip/netdb.h"
 
@@ -57,6 +62,49 @@ static const uint8_t  LUX_ACTION_WRITE        = 0x00;  // used for ALL requests
 // Write queue max depth — prevents unbounded growth when inverter is offline
 static const size_t   LUX_WRITE_QUEUE_MAX     = 20;
 
+// Upper bound for the `poll_window` option (requests outstanding at once).
+static const uint8_t  LUX_MAX_POLL_WINDOW     = 6;
+
+// Poll tiers – the periodic groups of LuxPollGroup in tools/registermap.h.
+// Each tier has its own interval. No hub entity reads a POLL_BOOT register
+// (serial number, firmware code), so there is no once-per-connection tier.
+enum LuxPollTier : uint8_t {
+    LUX_TIER_FAST = 0,  // update_interval
+    LUX_TIER_SLOW,      // slow_update_interval
+    LUX_TIER_CONFIG,    // hold_update_interval (READ_HOLD)
+    LUX_TIER_COUNT,
+};
+
+// Timing diagnostics: each is a lux_lat_hist_t (lux_req_track.h), exported
+// as p50/p95/p99 sensors every LUX_TIMING_PUBLISH_MS and in dump_config().
+// Request RTTs live in the request tracker; the rest are kept by the hub.
+enum LuxTiming : uint8_t {
+    LUX_TIMING_CONNECT = 0,   // TCP connect, ms
+    LUX_TIMING_RTT_INPUT,     // request → reply, ms
+    LUX_TIMING_RTT_HOLD,
+    LUX_TIMING_RTT_WRITE,
+    LUX_TIMING_CYCLE,         // input poll cycle, first request → last reply, ms
+    LUX_TIMING_PUBLISH,       // entity publish_state() per tick that published, µs
+    LUX_TIMING_RECV,          // try_recv_() calls that read data, µs
+    LUX_TIMING_LOOP,          // whole loop() tick, µs
+    LUX_TIMING_COUNT,
+};
+static const uint8_t  LUX_TIMING_PCTS          = 3;       // p50, p95, p99
+static const uint32_t LUX_TIMING_PUBLISH_MS    = 60000;
+
+// Publish queue: sensor updates are drained a few per loop() tick so a burst
+// of replies doesn't hold the loop (and WiFi / API / MQTT) for tens of ms.
+// A tick stops after the per-tick count or once the tick has used the µs
+// budget, whichever comes first; at least one entry always goes out.
+static const uint8_t  LUX_PUB_PER_TICK_DEFAULT = 8;
+static const uint32_t LUX_PUB_BUDGET_US_DEFAULT = 4000;
+
+// Receive ring: a heartbeat plus five 117-byte bank replies can arrive in one
+// burst, so keep room for all of them. Power of two (see lux_ring_buffer.h).
+static const size_t   LUX_RX_RING_SIZE        = 1024;
+// Largest frame we accept: 20 hdr + 15 df + 254 data + 2 CRC rounded up.
+static const size_t   LUX_MAX_FRAME           = 320;
+
 // ---------------------------------------------------------------------------
 // Scan tuning
 // ---------------------------------------------------------------------------
@@ -74,7 +122,7 @@ static const uint32_t LUX_SCAN_VERIFY_TIMEOUT  = 1500;  // ms
 static const uint32_t LUX_SCAN_SETTLE_MS       = 1500;  // ms
 
 // ---------------------------------------------------------------------------
-// Packed structs for INPUT data banks
+// Packed frame headers (input values are decoded via lux_regdecode.h)
 // ---------------------------------------------------------------------------
 #pragma pack(push, 1)
 
@@ -96,89 +144,8 @@ struct LuxTranslatedData {
     uint8_t  value_length;
 };  // 15 bytes
 
-// Bank 0: registers 0-39
-struct Bank0 {
-    uint16_t status;
-    int16_t  v_pv_1, v_pv_2, v_pv_3, v_bat;
-    uint8_t  soc, soh;
-    uint16_t internal_fault;
-    int16_t  p_pv_1, p_pv_2, p_pv_3, p_charge, p_discharge;
-    int16_t  v_ac_r, v_ac_s, v_ac_t, f_ac, p_inv, p_rec;
-    int16_t  rms_current, pf;
-    int16_t  v_eps_r, v_eps_s, v_eps_t, f_eps, p_to_eps, apparent_eps_power;
-    int16_t  p_to_grid, p_to_user;
-    int16_t  e_pv_1_day, e_pv_2_day, e_pv_3_day, e_inv_day, e_rec_day;
-    int16_t  e_chg_day, e_dischg_day, e_eps_day, e_to_grid_day, e_to_user_day;
-    int16_t  v_bus_1, v_bus_2;
-};  // 80 bytes = 40 registers
-
-// Bank 1: registers 40-79
-struct Bank1 {
-    int32_t  e_pv_1_all, e_pv_2_all, e_pv_3_all;
-    int32_t  e_inv_all, e_rec_all, e_chg_all, e_dischg_all, e_eps_all;
-    int32_t  e_to_grid_all, e_to_user_all;
-    uint32_t fault_code, warning_code;
-    int16_t  t_inner, t_rad_1, t_rad_2, t_bat;
-    uint16_t _reserved68;
-    uint32_t uptime;
-    uint8_t  _tail[18];
-};  // 80 bytes = 40 registers
-
-// Bank 2: registers 80-119
-struct Bank2 {
-    uint16_t _r80;
-    int16_t  max_chg_curr, max_dischg_curr, charge_volt_ref, dischg_cut_volt;
-    uint8_t  _placeholder[20];
-    int16_t  bat_status_inv;
-    int16_t  bat_count;
-    int16_t  bat_capacity;
-    int16_t  bat_current;
-    int16_t  _r99, _r100;
-    int16_t  max_cell_volt;
-    int16_t  min_cell_volt;
-    int16_t  max_cell_temp;
-    int16_t  min_cell_temp;
-    uint16_t _r105;
-    int16_t  bat_cycle_count;
-    uint8_t  _r107_113[14];
-    int16_t  p_load2;
-    uint8_t  _r115_119[10];
-};  // 80 bytes
-
-// Bank 3: registers 120-159
-struct Bank3 {
-    uint16_t _r120;
-    int16_t  gen_input_volt;
-    int16_t  gen_input_freq;
-    int16_t  gen_power_watt;
-    int16_t  gen_power_day;
-    int16_t  gen_power_all;
-    uint16_t _r126;
-    int16_t  eps_L1_volt;
-    int16_t  eps_L2_volt;
-    int16_t  eps_L1_watt;
-    int16_t  eps_L2_watt;
-    uint8_t  _r131_159[58];
-};  // 80 bytes
-
-// Bank 4: registers 160-199
-struct Bank4 {
-    uint8_t  _r160_169[20];
-    int16_t  p_load_ongrid;
-    int16_t  e_load_day;
-    int16_t  e_load_all_l;
-    uint8_t  _r173_199[54];
-};  // 80 bytes
-
 #pragma pack(pop)
 
-// Compile-time size guards — catches struct padding issues at build time
-static_assert(sizeof(Bank0) == 80, "Bank0 size mismatch — check struct members");
-static_assert(sizeof(Bank1) == 80, "Bank1 size mismatch — check struct members");
-static_assert(sizeof(Bank2) == 80, "Bank2 size mismatch — check struct members");
-static_assert(sizeof(Bank3) == 80, "Bank3 size mismatch — check struct members");
-static_assert(sizeof(Bank4) == 80, "Bank4 size mismatch — check struct members");
-
 // ---------------------------------------------------------------------------
 // Write command (from switches / numbers)
 // ---------------------------------------------------------------------------
@@ -314,6 +281,27 @@ class LuxpowerSNAComponent : public Component {
     void set_inverter_serial(const std::string &s){ inverter_serial_ = s; }
     void set_update_interval(uint32_t ms)         { update_interval_ms_ = ms; }
     void set_hold_update_interval(uint32_t ms)    { hold_interval_ms_ = ms; }
+    void set_slow_update_interval(uint32_t ms)    { slow_interval_ms_ = ms; }
+    void set_max_read_registers(uint16_t n)       { max_read_regs_ = n; }
+    void set_poll_window(uint8_t n) {
+        poll_window_ = n < 1 ? 1 : (n > LUX_MAX_POLL_WINDOW ? LUX_MAX_POLL_WINDOW : n);
+    }
+    void set_publish_deadband(float abs_v, float rel) { deadband_abs_ = abs_v; deadband_rel_ = rel; }
+    void set_publish_max_age(uint32_t ms)         { publish_max_age_ms_ = ms; }
+    void set_publish_budget(uint8_t per_tick, uint32_t us) {
+        pub_per_tick_  = per_tick ? per_tick : 1;
+        pub_budget_us_ = us;
+    }
+
+    // Publish statistics (usable from template sensor lambdas)
+    uint32_t publishes_emitted() const    { return publishes_emitted_; }
+    uint32_t publishes_suppressed() const { return publishes_suppressed_; }
+    uint32_t publishes_pending() const    { return (uint32_t)(pub_fifo_.size() - pub_head_); }
+
+    // Timing diagnostics: `metric` is a LuxTiming, `pct` 0/1/2 = p50/p95/p99
+    void set_timing_sensor(uint8_t metric, uint8_t pct, sensor::Sensor *s) {
+        if (metric < LUX_TIMING_COUNT && pct < LUX_TIMING_PCTS) timing_sensors_[metric][pct] = s;
+    }
 
     // ---- Runtime reconfiguration ----
     void reconnect() {
@@ -459,11 +447,14 @@ class LuxpowerSNAComponent : public Component {
     void save_host_prefs_();
     void load_host_prefs_();
 
+    // ---- One loop() tick minus the publish drain ----
+    void  step_(uint32_t now);
+
     // ---- Socket ----
     bool  start_connect_();
     bool  check_connect_();
     void  close_socket_();
-    int   send_bytes_(const uint8_t *data, size_t len);
+    bool  send_bytes_(const uint8_t *data, size_t len);
     void  try_recv_();
     bool  try_process_packet_();
 
@@ -471,13 +462,28 @@ class LuxpowerSNAComponent : public Component {
     // Shared by the poller and the scanner so both speak exactly the same dialect.
     static void build_read_input_packet_(uint8_t *pkt, const char *dongle,
                                          const char *inverter,
-                                         uint16_t start_reg, uint16_t count);
+                                         uint16_t start_reg, uint16_t count,
+                                         uint8_t seq);
 
-    void  send_read_input_(uint16_t start_reg, uint16_t count = 40);
-    void  send_read_hold_(uint16_t start_reg, uint16_t count = 40);
-    void  send_write_single_(uint16_t reg, uint16_t value);
+    bool  send_read_input_(uint16_t start_reg, uint16_t count, uint8_t seq);
+    bool  send_read_hold_(uint16_t start_reg, uint16_t count, uint8_t seq);
+    bool  send_write_single_(uint16_t reg, uint16_t value, uint8_t seq);
     void  send_heartbeat_response_(const uint8_t *pkt, size_t len);
 
+    // ---- Read planning ----
+    void  build_read_plans_();
+    struct PollReq;
+    static void plan_requests_(const lux_reg_set_t &need, uint8_t fn, uint16_t max_count,
+                               std::vector<PollReq> &out);
+
+    // ---- Request pipeline ----
+    uint8_t due_tiers_(uint32_t now) const;
+    uint8_t earliest_tier_(uint8_t mask) const;
+    void  begin_cycle_(uint8_t fn, uint8_t tiers, uint32_t now);
+    bool  send_request_(uint8_t fn, uint16_t start, uint16_t count_or_value, uint32_t now);
+    void  complete_request_(uint8_t seq, uint8_t fn, uint16_t start, uint32_t now);
+    void  expire_requests_(uint32_t now);
+
     // ---- Packet processors ----
     void  process_packet_(const uint8_t *buf, size_t len);
     void  process_read_input_(uint16_t start_reg, const uint8_t *data, size_t data_len);
@@ -486,18 +492,20 @@ class LuxpowerSNAComponent : public Component {
     void  notify_hold_listeners_();
 
     // ---- Bank processors ----
-    void  process_bank0_(const Bank0 &d);
-    void  process_bank1_(const Bank1 &d);
-    void  process_bank2_(const Bank2 &d);
-    void  process_bank3_(const Bank3 &d);
-    void  process_bank4_(const Bank4 &d);
+    void  process_derived_(uint8_t banks, uint8_t force);
 
-    // ---- CRC ----
-    static uint16_t crc16_(const uint8_t *data, size_t len);
+    // ---- Timing diagnostics ----
+    static const char *const TIMING_NAMES[LUX_TIMING_COUNT];
+    const lux_lat_hist_t &timing_hist_(uint8_t metric) const;
+    static bool timing_in_us_(uint8_t metric) { return metric >= LUX_TIMING_PUBLISH; }
+    void  publish_timing_();
 
     // ---- Publish helpers ----
-    static void pub(sensor::Sensor         *s, float v)            { if (s) s->publish_state(v); }
-    static void pub(text_sensor::TextSensor *s, const std::string &v) { if (s) s->publish_state(v); }
+    void        pub(sensor::Sensor         *s, float v, bool exact = false);   // change-gated, see .cpp
+    void        build_pub_slots_();
+    void        enqueue_pub_(sensor::Sensor *s, float v);
+    void        drain_publishes_(uint32_t tick_start_us);
+    void        pub(text_sensor::TextSensor *s, const std::string &v);
 
     // ---- Apply scan result (called from loop() on main thread) ----
     void apply_scanned_host_(const std::string &ip);
@@ -548,9 +556,33 @@ class LuxpowerSNAComponent : public Component {
         WRITING,
     };
     State    state_     = State::DISCONNECTED;
-    uint8_t  bank_idx_  = 0;
-    bool     awaiting_  = false;
-    uint32_t req_sent_ms_ = 0;
+
+    // One read of the current poll cycle
+    struct PollReq {
+        uint8_t  fn;
+        uint16_t start;
+        uint16_t count;
+    };
+    // Requests the dongle still owes us an answer for: sequence numbers,
+    // reply matching (seq, function, reg_start) and latency histograms
+    lux_req_tracker_t tracker_{};
+    uint8_t    poll_window_ = 1;   // 1 = classic stop-and-wait
+    uint16_t   max_read_regs_ = 40;          // one bank; some dongles drop larger reads
+    // Registers each tier's entities use, built once in setup()
+    struct TierSched {
+        lux_reg_set_t need;
+        uint8_t  fn;            // LUX_FN_READ_INPUT / LUX_FN_READ_HOLD
+        uint16_t nregs;
+        uint32_t interval_ms;
+        uint32_t due_ms;        // next deadline
+    };
+    TierSched  tiers_[LUX_TIER_COUNT]{};
+    static const char *const TIER_NAMES[LUX_TIER_COUNT];
+    std::vector<PollReq> cycle_;
+    uint8_t    cycle_tiers_ = 0;   // tier mask the current cycle serves
+    size_t     cycle_next_  = 0;   // next request to send
+    size_t     cycle_done_  = 0;   // answered or timed out
+    uint32_t   cycle_start_ms_ = 0;
 
     static const uint32_t RESPONSE_TIMEOUT_MS = 4000;
 
@@ -565,18 +597,77 @@ class LuxpowerSNAComponent : public Component {
 
     // ---- Timing ----
     uint32_t update_interval_ms_ = 20000;
+    uint32_t slow_interval_ms_   = 60000;
     uint32_t hold_interval_ms_   = 60000;
-    uint32_t last_input_poll_ms_ = 0;
-    uint32_t last_hold_poll_ms_  = 0;
     uint32_t last_connect_ms_    = 0;
     bool     initial_hold_done_  = false;
 
-    // ---- Receive buffer ----
-    uint8_t  recv_buf_[512];
-    size_t   recv_buf_len_ = 0;
+    // ---- Receive ring ----
+    LuxRingBuffer<LUX_RX_RING_SIZE> rx_;
+    uint8_t  frame_buf_[LUX_MAX_FRAME];  // only used when a frame wraps the ring
 
-    // ---- Hold register cache (reg 0-239) ----
+    // ---- Register caches (reg 0-239) ----
+    // Reads no longer line up with the 40-register banks, so replies land
+    // here first and the bank decoders read from the cache.
+    uint16_t input_regs_[240] = {};
     uint16_t hold_regs_[240] = {};
+    // Input registers received since boot. The cache starts zeroed, so a
+    // sensor is only published once every register it reads has arrived;
+    // a 0 standing in for an energy total would look like a meter reset.
+    lux_reg_set_t input_seen_{};
+    bool input_have_(uint16_t reg, uint16_t n) const;
+    bool derived_ready_(sensor::Sensor *LuxpowerSNAComponent::*member) const;
+
+    // ---- Sensor → input register map (drives the read planner) ----
+    struct InputBinding {
+        sensor::Sensor *LuxpowerSNAComponent::*sensor;
+        uint16_t reg;
+        uint8_t  nregs;
+        uint8_t  tier;    // LuxPollTier
+        uint8_t  field;   // lux_input_field_t, LUX_IN_NONE for derived sensors
+        bool     exact;   // code / bitfield / count: any change publishes
+    };
+    static const InputBinding INPUT_BINDINGS[];
+
+    // ---- Publish-on-change ----
+    // A 40-register bank whose raw words did not change since its last
+    // decode is not decoded at all; inside a decoded bank each value is compared with the
+    // sensor's last raw_state. Every bank is republished after max-age.
+    float    deadband_abs_        = 0.0f;    // 0/0 = publish on any change
+    float    deadband_rel_        = 0.0f;    // fraction of the last value
+    uint32_t publish_max_age_ms_  = 300000;  // 0 = publish every decode
+    uint32_t bank_pub_ms_[5]      = {};
+    uint8_t  bank_published_      = 0;       // banks decoded since connect
+    uint8_t  bank_sensors_[5]     = {};      // configured sensors per bank
+    bool     force_publish_       = false;   // set while a bank is refreshed
+    uint32_t publishes_emitted_   = 0;
+    uint32_t publishes_suppressed_ = 0;
+
+    // ---- Publish queue ----
+    // One slot per configured sensor, sorted by pointer and built once in
+    // setup(), holds its waiting value. pub_fifo_ lists the pending slots in
+    // publish order; a newer value for a pending slot just overwrites it
+    // (counted in publishes_coalesced_). Entries before pub_head_ are done;
+    // the fifo is cleared once it drains.
+    struct PubSlot {
+        sensor::Sensor *sensor;
+        float           value;
+        bool            pending;
+    };
+    std::vector<PubSlot>  pub_slots_;
+    std::vector<uint16_t> pub_fifo_;
+    size_t   pub_head_            = 0;
+    uint8_t  pub_per_tick_        = LUX_PUB_PER_TICK_DEFAULT;
+    uint32_t pub_budget_us_       = LUX_PUB_BUDGET_US_DEFAULT;
+    uint32_t publishes_coalesced_ = 0;
+    uint32_t pub_queue_peak_      = 0;
+    uint32_t pub_ticks_deferred_  = 0;       // ticks that left work for the next
+    uint32_t pub_tick_us_         = 0;       // publish_state() time this tick
+
+    // ---- Timing diagnostics (since boot) ----
+    lux_lat_hist_t  hist_connect_{}, hist_cycle_{}, hist_publish_{}, hist_recv_{}, hist_loop_{};
+    sensor::Sensor *timing_sensors_[LUX_TIMING_COUNT][LUX_TIMING_PCTS]{};
+    uint32_t        timing_pub_ms_ = 0;
 
     // ---- Write queue ----
     std::queue<WriteCmd> write_queue_;
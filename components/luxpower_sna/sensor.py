@@ -11,12 +11,14 @@ from esphome.const import (
     DEVICE_CLASS_POWER,
     DEVICE_CLASS_TEMPERATURE,
     DEVICE_CLASS_VOLTAGE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_TOTAL_INCREASING,
     UNIT_AMPERE,
     UNIT_CELSIUS,
     UNIT_HERTZ,
     UNIT_KILOWATT_HOURS,
+    UNIT_MILLISECOND,
     UNIT_PERCENT,
     UNIT_VOLT,
     UNIT_WATT,
@@ -252,6 +254,21 @@ SENSOR_TYPES = {
     "e_load_all_l":  sensor.sensor_schema(unit_of_measurement=UNIT_KILOWATT_HOURS, device_class=DEVICE_CLASS_ENERGY, state_class=TI, accuracy_decimals=1),
 }
 
+# Timing diagnostics: percentiles since boot, republished once a minute.
+# Order matches LuxTiming / the percentile index in luxpower_sna.h.
+TIMING_METRICS = ["connect", "rtt_input", "rtt_hold", "rtt_write", "cycle", "publish", "recv", "loop"]
+TIMING_PCTS = ["p50", "p95", "p99"]
+TIMING_SENSORS = {
+    f"timing_{m}_{p}": (i, j)
+    for i, m in enumerate(TIMING_METRICS)
+    for j, p in enumerate(TIMING_PCTS)
+}
+for _key, (_i, _j) in TIMING_SENSORS.items():
+    SENSOR_TYPES[_key] = sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND, state_class=M,
+        accuracy_decimals=2 if TIMING_METRICS[_i] in ("publish", "recv", "loop") else 0,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC, icon="mdi:timer-outline")
+
 CONFIG_SCHEMA = cv.All(
     LUXPOWER_SNA_COMPONENT_SCHEMA.extend(
         {cv.Optional(k): v for k, v in SENSOR_TYPES.items()}
@@ -272,3 +289,9 @@ async def to_code(config):
         else:
             sens = await sensor.new_sensor(conf)
         cg.add(getattr(hub, f"set_{c_name}_sensor")(sens))
+
+    for yaml_key, (metric, pct) in TIMING_SENSORS.items():
+        if yaml_key not in config:
+            continue
+        sens = await sensor.new_sensor(config[yaml_key])
+        cg.add(hub.set_timing_sensor(metric, pct, sens))
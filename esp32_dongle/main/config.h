@@ -5,6 +5,10 @@
 // Define RELAY_MODE to act as transparent MITM relay (real dongle → ESP32 → cloud)
 // Undefine to act as a dongle itself (ESP32 polls cloud directly)
 #define RELAY_MODE
+// Define RS485_MASTER_MODE to poll the inverter directly over RS485 (Modbus
+// RTU, lux_rs485_poll.c): g_regs is fed from the bus and MQTT writes go out
+// on it, so neither the WiFi dongle nor the cloud is in the data path
+//#define RS485_MASTER_MODE
 
 // ── WiFi STA (home LAN) ───────────────────────────────────────
 // TODO: Phase 2 — replace with captive portal / WiFiManager style
@@ -30,6 +34,9 @@
 #define DONGLE_LOCAL_PORT    8000
 
 #define LUX_CLOUD_PORT       4346
+// Registers per poll read. Some dongles don't answer large reads, so 40
+// (one bank) like the hub's max_read_registers; up to 120 is opt-in.
+#define CLOUD_READ_MAX_REGS  40
 
 // ── Dongle / Inverter identity ────────────────────────────────
 #define DONGLE_SN            "BA32500699"   // "BA12150911"
@@ -45,9 +52,13 @@ static const uint8_t WRITE_MULTI_UNK[WRITE_MULTI_UNK_LEN] = {
 #define RS485_TX_PIN         1
 #define RS485_RX_PIN         3
 #define RS485_DE_RE_PIN      21
-#define RS485_BAUD           19200
+#define RS485_BAUD           19200    // default / fallback; see calibration
+// Rates lux_rs485_calibrate() tries, fastest first (RS485_BAUD is always
+// tried last). The inverter must already be set to the rate it answers on.
+#define RS485_PROBE_BAUDS    { 115200, 57600, 38400 }
 #define MODBUS_SLAVE_ADDR    1
 #define MODBUS_UART_NUM      UART_NUM_1
+#define RS485_STATS_MS       60000    // per-block RTT / error report
 
 // ── MQTT ─────────────────────────────────────────────────────
 #define MQTT_BROKER_URI      "mqtt://myhome.sfdp.net:1883"
@@ -57,10 +68,29 @@ static const uint8_t WRITE_MULTI_UNK[WRITE_MULTI_UNK_LEN] = {
 #define MQTT_PREFIX          "lux"
 #define MQTT_CMD_PREFIX      "lux/cmd"
 #define MQTT_LOG_TOPIC       "lux/log"
+#define MQTT_FULL_REFRESH_MS 300000   // republish unchanged values this often
+// 1 = lux/state/bat_curr keeps its original 0.01 scale; 0 = /10 (amps) like
+// the hub, the Arduino sketch and LXPPacket.py. Switching changes the value
+// existing consumers and HA history see by 10x.
+#define MQTT_BAT_CURR_LEGACY 1
+// 1 = one JSON document per register bank on lux/state/bank/<n> (HA reads
+// it via value_template); 0 = one plain topic per sensor
+#define MQTT_BATCH_JSON      0
+
+// ── Local :8000 fan-out ──────────────────────────────────────
+// Reads whose whole range was stored within this window are answered from
+// g_regs without asking the dongle; 0 = always forward
+#define LOCAL_CACHE_MAX_AGE_MS    5000
 
 // ── OTA web server ────────────────────────────────────────────
 #define OTA_PORT             8080
 
+// ── Frame capture (lux_capture.c) → GET /capture on OTA_PORT ─
+// RAM ring of direction-tagged frames from the relay and the :8000 fan-out;
+// oldest frames are overwritten. Off (0) by default: set e.g. 32768 while
+// debugging, the ring is allocated at boot and never given back.
+#define CAPTURE_BUF_SIZE     0
+
 // ── Timing (ms) ──────────────────────────────────────────────
 #define POLL_INPUT_MS             5000
 #define POLL_HOLD_MS              60000
@@ -71,8 +101,26 @@ static const uint8_t WRITE_MULTI_UNK[WRITE_MULTI_UNK_LEN] = {
 // ── FreeRTOS task config ──────────────────────────────────────
 #define TASK_PRIO_CLOUD      4
 #define TASK_PRIO_MQTT       3
+#define TASK_PRIO_RS485      4
 #define STACK_CLOUD          8192
-#define STACK_MQTT           4096
+#define STACK_RS485          4096
+#define STACK_MQTT           5120    // publish holds a reg_snapshot_t (960 B)
+
+// ── Socket budget ────────────────────────────────────────────
+// Every socket comes out of one lwIP pool of CONFIG_LWIP_MAX_SOCKETS
+// (set in sdkconfig.defaults; lux_netloop.c checks it at build time):
+//   OTA httpd    listener + control socket + OTA_HTTPD_SESSIONS
+//   MQTT client  1
+//   lux_cloud.c  1
+//   netloop      NET_LISTENERS (:4346 relay, :8000 fan-out) + NET_MAX_CONNS
+#define LWIP_SOCKET_BUDGET   16
+#define OTA_HTTPD_SESSIONS   3
+#define NET_LISTENERS        2
+
+// ── Relay connection pool (lux_netloop.c) ────────────────────
+// Whatever the budget leaves: 7 slots. A relay session takes two (client +
+// upstream); the :8000 fan-out one per client plus its shared upstream.
+#define NET_MAX_CONNS        (LWIP_SOCKET_BUDGET - (2 + OTA_HTTPD_SESSIONS) - 1 - 1 - NET_LISTENERS)
 
 // ── Register counts ───────────────────────────────────────────
 #define INPUT_REG_COUNT      240
@@ -0,0 +1,123 @@
+// lux_capture.c
+// RAM ring of timestamped frames; see lux_capture.h for the file format.
+//
+// Positions are free-running u32 byte counters (masked by % size on
+// access), so a reader can tell whether the writer lapped it. The mutex is
+// held only for one record append or one chunk copy, never across a send.
+
+#include "lux_capture.h"
+#include "config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "capture";
+
+static uint8_t          *s_buf;
+static uint32_t          s_size;
+static uint32_t          s_head, s_tail;     // write position, oldest record
+static uint32_t          s_records, s_overwritten;
+static SemaphoreHandle_t s_mutex;
+
+static void ring_put(uint32_t pos, const uint8_t *src, size_t len) {
+    uint32_t off = pos % s_size;
+    size_t first = s_size - off < len ? s_size - off : len;
+    memcpy(s_buf + off, src, first);
+    memcpy(s_buf, src + first, len - first);
+}
+
+static void ring_get(uint32_t pos, uint8_t *dst, size_t len) {
+    uint32_t off = pos % s_size;
+    size_t first = s_size - off < len ? s_size - off : len;
+    memcpy(dst, s_buf + off, first);
+    memcpy(dst + first, s_buf, len - first);
+}
+
+static uint32_t rec_len_at(uint32_t pos) {
+    uint8_t h[LUX_CAP_REC_HDR];
+    ring_get(pos, h, sizeof(h));
+    return LUX_CAP_REC_HDR + (h[6] | ((uint32_t)h[7] << 8));
+}
+
+void lux_capture_init(void) {
+    if (CAPTURE_BUF_SIZE == 0 || s_buf) return;
+    s_buf = malloc(CAPTURE_BUF_SIZE);
+    if (!s_buf) {
+        ESP_LOGW(TAG, "No memory for a %u B capture ring — capture off",
+                 (unsigned)CAPTURE_BUF_SIZE);
+        return;
+    }
+    s_size  = CAPTURE_BUF_SIZE;
+    s_mutex = xSemaphoreCreateMutex();
+    configASSERT(s_mutex);
+    ESP_LOGI(TAG, "Capturing frames into %u B of RAM", (unsigned)s_size);
+}
+
+void lux_capture_frame(lux_cap_tag_t tag, const uint8_t *frame, size_t len) {
+    if (!s_buf || len > LUX_CAP_MAX_FRAME || LUX_CAP_REC_HDR + len > s_size)
+        return;
+    uint32_t t = (uint32_t)(esp_timer_get_time() / 1000);
+    uint8_t h[LUX_CAP_REC_HDR] = {
+        t & 0xFF, (t >> 8) & 0xFF, (t >> 16) & 0xFF, (t >> 24) & 0xFF,
+        (uint8_t)tag, 0, len & 0xFF, (len >> 8) & 0xFF,
+    };
+    uint32_t need = LUX_CAP_REC_HDR + (uint32_t)len;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    while (s_head - s_tail + need > s_size) {      // evict oldest records
+        s_tail += rec_len_at(s_tail);
+        s_records--;
+        s_overwritten++;
+    }
+    ring_put(s_head, h, sizeof(h));
+    ring_put(s_head + LUX_CAP_REC_HDR, frame, len);
+    s_head += need;
+    s_records++;
+    xSemaphoreGive(s_mutex);
+}
+
+uint32_t lux_capture_begin(uint32_t *end) {
+    if (!s_buf) { *end = 0; return 0; }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t start = s_tail;
+    *end = s_head;
+    xSemaphoreGive(s_mutex);
+    return start;
+}
+
+size_t lux_capture_read(uint32_t *pos, uint32_t end, uint8_t *out, size_t cap) {
+    if (!s_buf) return 0;
+    size_t n = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if ((int32_t)(*pos - s_tail) < 0) *pos = s_tail;    // lapped by the writer
+    while ((int32_t)(end - *pos) > 0) {
+        uint32_t rl = rec_len_at(*pos);
+        if (n + rl > cap) break;
+        ring_get(*pos, out + n, rl);
+        n    += rl;
+        *pos += rl;
+    }
+    xSemaphoreGive(s_mutex);
+    return n;
+}
+
+void lux_capture_clear(void) {
+    if (!s_buf) return;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_tail = s_head;
+    s_records = s_overwritten = 0;
+    xSemaphoreGive(s_mutex);
+}
+
+void lux_capture_stats(uint32_t *records, uint32_t *bytes, uint32_t *overwritten) {
+    if (!s_buf) { *records = *bytes = *overwritten = 0; return; }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *records     = s_records;
+    *bytes       = s_head - s_tail;
+    *overwritten = s_overwritten;
+    xSemaphoreGive(s_mutex);
+}
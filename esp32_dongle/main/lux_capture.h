@@ -0,0 +1,55 @@
+#pragma once
+// lux_capture.h
+// Frame capture: every A1 1A frame the relay and the :8000 fan-out see is
+// appended, timestamped and tagged with its direction, to a RAM ring of
+// CAPTURE_BUF_SIZE bytes (oldest records are overwritten). The ring is
+// downloaded from the status web server at /capture and replayed on a PC
+// with tools/sim/lux_replay.cpp.
+//
+// File format (little-endian):
+//   "LUXCAP01"                                   8-byte magic
+//   per record: u32 t_ms | u8 tag | u8 0 | u16 len | len frame bytes
+// t_ms is milliseconds since boot; tag is lux_cap_tag_t.
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LUX_CAP_MAGIC       "LUXCAP01"
+#define LUX_CAP_MAGIC_LEN   8
+#define LUX_CAP_REC_HDR     8
+#define LUX_CAP_MAX_FRAME   1024    // = the netloop reassembly buffer
+
+typedef enum {
+    LUX_CAP_DONGLE_TO_CLOUD = 0,   // relay :4346, real dongle → cloud
+    LUX_CAP_CLOUD_TO_DONGLE = 1,   // relay :4346, cloud → real dongle
+    LUX_CAP_CLIENT_TO_LOCAL = 2,   // fan-out :8000, local client → ESP
+    LUX_CAP_DONGLE_TO_LOCAL = 3,   // fan-out :8000, real dongle → ESP
+} lux_cap_tag_t;
+
+// Allocate the ring. No-op (capture off) if CAPTURE_BUF_SIZE is 0 or the
+// allocation fails; lux_capture_frame() is then free.
+void lux_capture_init(void);
+
+// Append one frame (any task)
+void lux_capture_frame(lux_cap_tag_t tag, const uint8_t *frame, size_t len);
+
+// Reader: lux_capture_begin() returns the oldest record position and sets
+// *end to the current write position. lux_capture_read() copies whole
+// records from *pos (advanced) up to `end` into out; if the writer has
+// overwritten *pos meanwhile, it skips ahead to the oldest record. Returns
+// the bytes copied, 0 when done. cap must hold one record
+// (LUX_CAP_REC_HDR + LUX_CAP_MAX_FRAME).
+uint32_t lux_capture_begin(uint32_t *end);
+size_t   lux_capture_read(uint32_t *pos, uint32_t end, uint8_t *out, size_t cap);
+
+void lux_capture_clear(void);
+
+// Records and bytes held now, records overwritten since boot / clear
+void lux_capture_stats(uint32_t *records, uint32_t *bytes, uint32_t *overwritten);
+
+#ifdef __cplusplus
+}
+#endif
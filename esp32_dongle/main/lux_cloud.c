@@ -10,19 +10,36 @@
 #include "config.h"
 #include "lux_proto.h"
 #include "shared_state.h"
+#include "lux_read_plan.h"
 
 static const char *TAG = "lux_cloud";
 
 // ── Poll schedule ─────────────────────────────────────────────
-// INPUT: 5 banks × 40 regs = 200 regs
-static const uint16_t INPUT_BANKS[]  = {0, 40, 80, 120, 160};
-static const uint16_t INPUT_COUNTS[] = {40, 40, 40, 40, 40};  // FIX: was 20,20
-#define INPUT_BANK_COUNT 5
-
-// HOLD: 6 banks × 40 regs = 240 regs
-static const uint16_t HOLD_BANKS[]   = {0, 40, 80, 120, 160, 200};
-static const uint16_t HOLD_COUNTS[]  = {40, 40, 40, 40, 40, 40};
-#define HOLD_BANK_COUNT 6
+// Built once from the registers g_regs readers need: adjacent registers are
+// merged into reads of up to CLOUD_READ_MAX_REGS, unused gaps are skipped.
+#if CLOUD_READ_MAX_REGS < 1 || CLOUD_READ_MAX_REGS > LUX_READ_MAX_TCP
+#error "CLOUD_READ_MAX_REGS must be 1..LUX_READ_MAX_TCP"
+#endif
+#define PLAN_MAX 16
+static lux_read_span_t s_input_plan[PLAN_MAX];
+static size_t          s_input_plan_len;
+static lux_read_span_t s_hold_plan[PLAN_MAX];
+static size_t          s_hold_plan_len;
+
+static void cloud_build_plans(void) {
+    lux_reg_set_t input, hold;
+    lux_regset_clear(&input);
+    lux_regset_clear(&hold);
+    reg_poll_needed(&input, &hold);
+    s_input_plan_len = lux_plan_reads(&input, CLOUD_READ_MAX_REGS, LUX_READ_GAP_TCP,
+                                      s_input_plan, PLAN_MAX);
+    s_hold_plan_len  = lux_plan_reads(&hold, CLOUD_READ_MAX_REGS, LUX_READ_GAP_TCP,
+                                      s_hold_plan, PLAN_MAX);
+    for (size_t i = 0; i < s_input_plan_len; i++)
+        ESP_LOGI(TAG, "plan INPUT %u+%u", s_input_plan[i].start, s_input_plan[i].count);
+    for (size_t i = 0; i < s_hold_plan_len; i++)
+        ESP_LOGI(TAG, "plan HOLD  %u+%u", s_hold_plan[i].start, s_hold_plan[i].count);
+}
 
 #define RECV_BUF_SIZE 1024
 
@@ -248,6 +265,7 @@ void lux_cloud_task(void *arg) {
 
     cloud_ctx_t ctx = {};
     ctx.sock = -1;
+    cloud_build_plans();
 
     uint32_t last_heartbeat  = 0;
     uint32_t last_input_poll = 0;
@@ -306,13 +324,14 @@ void lux_cloud_task(void *arg) {
 
         // ── Initial HOLD poll (once on connect) ───────────────
         if (!initial_hold_done) {
-            if (!cloud_send_read_hold(&ctx,
-                                      HOLD_BANKS[hold_bank],
-                                      HOLD_COUNTS[hold_bank])) {
+            if (hold_bank < s_hold_plan_len &&
+                !cloud_send_read_hold(&ctx,
+                                      s_hold_plan[hold_bank].start,
+                                      s_hold_plan[hold_bank].count)) {
                 close(ctx.sock); ctx.sock = -1; continue;
             }
             hold_bank++;
-            if (hold_bank >= HOLD_BANK_COUNT) {
+            if (hold_bank >= s_hold_plan_len) {
                 hold_bank = 0;
                 initial_hold_done = true;
                 last_hold_poll = now;
@@ -324,10 +343,10 @@ void lux_cloud_task(void *arg) {
 
         // ── Periodic INPUT poll ───────────────────────────────
         if (now - last_input_poll >= POLL_INPUT_MS) {
-            for (int i = 0; i < INPUT_BANK_COUNT; i++) {
+            for (size_t i = 0; i < s_input_plan_len; i++) {
                 if (!cloud_send_read_input(&ctx,
-                                           INPUT_BANKS[i],
-                                           INPUT_COUNTS[i])) {
+                                           s_input_plan[i].start,
+                                           s_input_plan[i].count)) {
                     close(ctx.sock); ctx.sock = -1; break;
                 }
                 vTaskDelay(pdMS_TO_TICKS(100));
@@ -338,10 +357,10 @@ void lux_cloud_task(void *arg) {
 
         // ── Periodic HOLD poll ────────────────────────────────
         if (now - last_hold_poll >= POLL_HOLD_MS) {
-            for (int i = 0; i < HOLD_BANK_COUNT; i++) {
+            for (size_t i = 0; i < s_hold_plan_len; i++) {
                 if (!cloud_send_read_hold(&ctx,
-                                          HOLD_BANKS[i],
-                                          HOLD_COUNTS[i])) {
+                                          s_hold_plan[i].start,
+                                          s_hold_plan[i].count)) {
                     close(ctx.sock); ctx.sock = -1; break;
                 }
                 vTaskDelay(pdMS_TO_TICKS(100));
@@ -15,6 +15,7 @@
 #include "mqtt_client.h"
 #include "esp_log.h"
 #include "config.h"
+#include "lux_mqtt.h"
 
 static const char *HA_TAG = "ha_disc";
 
@@ -22,6 +23,16 @@ static const char *HA_TAG = "ha_disc";
 #define HA_PREFIX        "homeassistant"
 #define HA_NODE_ID       "luxpower_sna"
 
+// With MQTT_BATCH_JSON the state lives in a per-bank JSON document; entities
+// point at it and pull their key out with a value template.
+#if MQTT_BATCH_JSON
+#define HA_VAL_TPL_FMT   "\"val_tpl\":\"{{value_json.%s}}\","
+#define HA_AVTY_TPL      "{{value_json.vpv1|float(0)|string}}"
+#else
+#define HA_VAL_TPL_FMT   "%.0s"
+#define HA_AVTY_TPL      "{{value|float(0)|string}}"
+#endif
+
 // Device info block (reused in every payload)
 #define HA_DEVICE \
     "\"dev\":{" \
@@ -47,30 +58,32 @@ static void ha_pub(esp_mqtt_client_handle_t c,
 // ── Sensor ────────────────────────────────────────────────────
 static void ha_sensor(esp_mqtt_client_handle_t c,
                        const char *obj_id, const char *name,
-                       const char *state_topic,
                        const char *unit, const char *dev_class,
                        const char *icon) {
-    char buf[512];
+    char buf[512], stat_t[64], avty_t[64];
+    lux_mqtt_state_topic(obj_id, stat_t, sizeof(stat_t));
+    lux_mqtt_state_topic("vpv1", avty_t, sizeof(avty_t));
     snprintf(buf, sizeof(buf),
         "{"
         "\"name\":\"%s\","
         "\"stat_t\":\"%s\","
+        HA_VAL_TPL_FMT
         "\"unit_of_meas\":\"%s\","
         "%s%s%s"   // dev_class (optional)
         "%s%s%s"   // icon (optional)
         "\"uniq_id\":\"" HA_NODE_ID "_%s\","
-        "\"avty_t\":\"" MQTT_PREFIX "/state/vpv1\","
-        "\"avty_tpl\":\"{{value|float(0)|string}}\","
+        "\"avty_t\":\"%s\","
+        "\"avty_tpl\":\"" HA_AVTY_TPL "\","
         HA_DEVICE
         "}",
-        name, state_topic, unit,
+        name, stat_t, obj_id, unit,
         dev_class ? "\"dev_cla\":\"" : "",
         dev_class ? dev_class : "",
         dev_class ? "\"," : "",
         icon ? "\"ic\":\"" : "",
         icon ? icon : "",
         icon ? "\"," : "",
-        obj_id
+        obj_id, avty_t
     );
     ha_pub(c, "sensor", obj_id, buf);
 }
@@ -78,14 +91,16 @@ static void ha_sensor(esp_mqtt_client_handle_t c,
 // ── Number (writable) ─────────────────────────────────────────
 static void ha_number(esp_mqtt_client_handle_t c,
                        const char *obj_id, const char *name,
-                       const char *state_topic, const char *cmd_topic,
+                       const char *cmd_topic,
                        float min, float max, float step,
                        const char *unit, const char *icon) {
-    char buf[512];
+    char buf[512], stat_t[64];
+    lux_mqtt_state_topic(obj_id, stat_t, sizeof(stat_t));
     snprintf(buf, sizeof(buf),
         "{"
         "\"name\":\"%s\","
         "\"stat_t\":\"%s\","
+        HA_VAL_TPL_FMT
         "\"cmd_t\":\"%s\","
         "\"min\":%.0f,\"max\":%.0f,\"step\":%.1f,"
         "\"unit_of_meas\":\"%s\","
@@ -94,7 +109,7 @@ static void ha_number(esp_mqtt_client_handle_t c,
         "\"ret\":true,"
         HA_DEVICE
         "}",
-        name, state_topic, cmd_topic,
+        name, stat_t, obj_id, cmd_topic,
         min, max, step, unit, icon, obj_id
     );
     ha_pub(c, "number", obj_id, buf);
@@ -149,60 +164,37 @@ static void lux_ha_discovery_publish(esp_mqtt_client_handle_t c) {
     ESP_LOGI(HA_TAG, "Publishing HA discovery...");
 
     // ── SENSORS ──────────────────────────────────────────────
-    ha_sensor(c, "vpv1",       "PV1 Voltage",
-              MQTT_PREFIX "/state/vpv1",       "V",   "voltage",    "mdi:solar-power");
-    ha_sensor(c, "vpv2",       "PV2 Voltage",
-              MQTT_PREFIX "/state/vpv2",       "V",   "voltage",    "mdi:solar-power");
-    ha_sensor(c, "ppv1",       "PV1 Power",
-              MQTT_PREFIX "/state/ppv1",       "W",   "power",      "mdi:solar-power");
-    ha_sensor(c, "ppv2",       "PV2 Power",
-              MQTT_PREFIX "/state/ppv2",       "W",   "power",      "mdi:solar-power");
-    ha_sensor(c, "ppv_total",  "PV Total Power",
-              MQTT_PREFIX "/state/ppv_total",  "W",   "power",      "mdi:solar-power-variant");
-    ha_sensor(c, "vbat",       "Battery Voltage",
-              MQTT_PREFIX "/state/vbat",       "V",   "voltage",    "mdi:battery");
-    ha_sensor(c, "soc",        "Battery SOC",
-              MQTT_PREFIX "/state/soc",        "%",   "battery",    NULL);
-    ha_sensor(c, "bat_curr",   "Battery Current",
-              MQTT_PREFIX "/state/bat_curr",   "A",   "current",    "mdi:current-dc");
-    ha_sensor(c, "bat_power",  "Battery Power",
-              MQTT_PREFIX "/state/bat_power",  "W",   "power",      "mdi:battery-charging");
-    ha_sensor(c, "p_charge",   "Charge Power",
-              MQTT_PREFIX "/state/p_charge",   "W",   "power",      "mdi:battery-arrow-up");
-    ha_sensor(c, "p_discharge","Discharge Power",
-              MQTT_PREFIX "/state/p_discharge","W",   "power",      "mdi:battery-arrow-down");
-    ha_sensor(c, "vac_r",      "Grid Voltage",
-              MQTT_PREFIX "/state/vac_r",      "V",   "voltage",    "mdi:transmission-tower");
-    ha_sensor(c, "fac",        "Grid Frequency",
-              MQTT_PREFIX "/state/fac",        "Hz",  "frequency",  "mdi:sine-wave");
-    ha_sensor(c, "p_inv",      "Inverter Power",
-              MQTT_PREFIX "/state/p_inv",      "W",   "power",      "mdi:lightning-bolt");
-    ha_sensor(c, "p_to_grid",  "Power to Grid",
-              MQTT_PREFIX "/state/p_to_grid",  "W",   "power",      "mdi:transmission-tower-export");
-    ha_sensor(c, "p_to_user",  "Power to Load",
-              MQTT_PREFIX "/state/p_to_user",  "W",   "power",      "mdi:home-lightning-bolt");
-    ha_sensor(c, "p_load",     "Load Power",
-              MQTT_PREFIX "/state/p_load",     "W",   "power",      "mdi:lightbulb-group");
-    ha_sensor(c, "t_inner",    "Inverter Temp",
-              MQTT_PREFIX "/state/t_inner",    "°C",  "temperature","mdi:thermometer");
-    ha_sensor(c, "t_rad1",     "Radiator Temp",
-              MQTT_PREFIX "/state/t_rad1",     "°C",  "temperature","mdi:thermometer");
-    ha_sensor(c, "t_bat",      "Battery Temp",
-              MQTT_PREFIX "/state/t_bat",      "°C",  "temperature","mdi:thermometer");
+    ha_sensor(c, "vpv1",        "PV1 Voltage",     "V",   "voltage",    "mdi:solar-power");
+    ha_sensor(c, "vpv2",        "PV2 Voltage",     "V",   "voltage",    "mdi:solar-power");
+    ha_sensor(c, "ppv1",        "PV1 Power",       "W",   "power",      "mdi:solar-power");
+    ha_sensor(c, "ppv2",        "PV2 Power",       "W",   "power",      "mdi:solar-power");
+    ha_sensor(c, "ppv_total",   "PV Total Power",  "W",   "power",      "mdi:solar-power-variant");
+    ha_sensor(c, "vbat",        "Battery Voltage", "V",   "voltage",    "mdi:battery");
+    ha_sensor(c, "soc",         "Battery SOC",     "%",   "battery",    NULL);
+    ha_sensor(c, "bat_curr",    "Battery Current", "A",   "current",    "mdi:current-dc");
+    ha_sensor(c, "bat_power",   "Battery Power",   "W",   "power",      "mdi:battery-charging");
+    ha_sensor(c, "p_charge",    "Charge Power",    "W",   "power",      "mdi:battery-arrow-up");
+    ha_sensor(c, "p_discharge", "Discharge Power", "W",   "power",      "mdi:battery-arrow-down");
+    ha_sensor(c, "vac_r",       "Grid Voltage",    "V",   "voltage",    "mdi:transmission-tower");
+    ha_sensor(c, "fac",         "Grid Frequency",  "Hz",  "frequency",  "mdi:sine-wave");
+    ha_sensor(c, "p_inv",       "Inverter Power",  "W",   "power",      "mdi:lightning-bolt");
+    ha_sensor(c, "p_to_grid",   "Power to Grid",   "W",   "power",      "mdi:transmission-tower-export");
+    ha_sensor(c, "p_to_user",   "Power to Load",   "W",   "power",      "mdi:home-lightning-bolt");
+    ha_sensor(c, "p_load",      "Load Power",      "W",   "power",      "mdi:lightbulb-group");
+    ha_sensor(c, "t_inner",     "Inverter Temp",   "°C",  "temperature","mdi:thermometer");
+    ha_sensor(c, "t_rad1",      "Radiator Temp",   "°C",  "temperature","mdi:thermometer");
+    ha_sensor(c, "t_bat",       "Battery Temp",    "°C",  "temperature","mdi:thermometer");
 
     // ── NUMBERS (writable) ────────────────────────────────────
     ha_number(c, "charge_rate", "Charge Current Limit",
-              MQTT_PREFIX "/state/charge_rate",
               MQTT_CMD_PREFIX "/set/charge_rate",
               0, 110, 1, "A", "mdi:battery-arrow-up-outline");
 
     ha_number(c, "dischg_rate", "Discharge Current Limit",
-              MQTT_PREFIX "/state/dischg_rate",
               MQTT_CMD_PREFIX "/set/dischg_rate",
               0, 110, 1, "A", "mdi:battery-arrow-down-outline");
 
     ha_number(c, "eod_soc", "End-of-Discharge SOC",
-              MQTT_PREFIX "/state/eod_soc",
               MQTT_CMD_PREFIX "/set/eod_soc",
               10, 90, 1, "%", "mdi:battery-low");
 
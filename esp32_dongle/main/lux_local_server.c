@@ -1,191 +1,334 @@
 // lux_local_server.c
-// TCP :8000 — pure transparent relay
-// ESPHome → ESP32:8000 → real dongle DONGLE_LOCAL_IP:DONGLE_LOCAL_PORT
-// Verbose serial logging so connection flow is visible.
+// TCP :8000 — fan-out server in front of the real dongle
+// ESPHome / HA / tools → ESP32:8000 ─┐
+//                                    ├─ ONE session → DONGLE_LOCAL_IP:DONGLE_LOCAL_PORT
+// MQTT writes (g_write_queue) ───────┘
+//
+// The dongle accepts a single TCP client, so the ESP32 holds that session
+// (shared-upstream service in lux_netloop.c) and any number of local clients
+// talk to the ESP32 instead:
+//   - client requests are queued and sent upstream one at a time
+//   - a read identical to the one in flight rides on it (one dongle round
+//     trip answers every client that asked)
+//   - upstream requests carry the ESP32's own sequence numbers
+//     (lux_req_track.h); the reply is routed back to the client(s) that
+//     asked with each client's own seq restored in the header
+//   - read replies also update g_regs, write replies the echoed HOLD reg
+//   - dongle heartbeats are answered here, never shown to clients
+//   - a read whose whole range is in g_regs and younger than
+//     LOCAL_CACHE_MAX_AGE_MS is answered locally, no dongle round trip
 
 #include "lux_local_server.h"
+#include "lux_netloop.h"
+#include "lux_proto.h"
+#include "lux_capture.h"
+#include "lux_req_track.h"
+#include "shared_state.h"
 #include "config.h"
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include "esp_log.h"
-#include "lwip/sockets.h"
-#include "lwip/netdb.h"
+#include <stdbool.h>
 #include <string.h>
-#include <errno.h>
-#include <stdlib.h>
 
 static const char *TAG = "local";
 
-#define LOCAL_PORT   8000
-#define BUF_SIZE     1024
-#define CONN_STACK   8192
-#define SRV_STACK    4096
-#define TASK_PRIO    4
-
-// ── Per-connection task ───────────────────────────────────────
-typedef struct { int client; char client_ip[20]; uint16_t client_port; } conn_arg_t;
-
-static void conn_task(void *arg) {
-    conn_arg_t *ctx = (conn_arg_t *)arg;
-    int  cs          = ctx->client;
-    char cip[20];
-    uint16_t cport   = ctx->client_port;
-    strncpy(cip, ctx->client_ip, sizeof(cip));
-    free(ctx);
-
-    ESP_LOGI(TAG, "[%s:%u] ── session start", cip, cport);
-
-    // ── Connect to real dongle local server ───────────────────
-    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
-    struct addrinfo *res  = NULL;
-    char port_str[8];
-    snprintf(port_str, sizeof(port_str), "%d", DONGLE_LOCAL_PORT);
-
-    if (getaddrinfo(DONGLE_LOCAL_IP, port_str, &hints, &res) != 0 || !res) {
-        ESP_LOGE(TAG, "[%s:%u] DNS fail for %s", cip, cport, DONGLE_LOCAL_IP);
-        close(cs);
-        vTaskDelete(NULL);
-        return;
+#define LOCAL_PORT            8000
+#define LOCAL_IDLE_MS         120000
+#define FANOUT_QUEUE_LEN      16
+#define FANOUT_REQ_TIMEOUT_MS 3000      // below the hub's 4 s response timeout
+#define FANOUT_STATS_MS       60000
+#define FANOUT_MAX_FRAME      48
+
+typedef struct {
+    net_conn_t *client;         // NULL = internal (g_write_queue)
+    uint8_t     fn;
+    uint16_t    start;          // register (writes) / first register (reads)
+    uint16_t    count;          // reads: register count; writes: value
+    uint8_t     seq;            // the client's seq, restored on the reply
+    bool        sent;           // in flight, or riding on the in-flight read
+    uint8_t     len;
+    uint8_t     frame[FANOUT_MAX_FRAME];
+} fan_req_t;
+
+static fan_req_t s_q[FANOUT_QUEUE_LEN];
+static int       s_qn = 0;
+static lux_req_tracker_t s_trk;         // at most one request upstream
+static uint32_t  s_coalesced = 0, s_dropped = 0;
+static uint32_t  s_cache_hits = 0;
+static uint8_t   s_resp[20 + 17 + LUX_RESP_MAX_REGS * 2];  // loop task only
+static uint32_t  s_stats_ms = 0;
+
+static void local_on_frame(net_conn_t *c, bool from_client,
+                           const uint8_t *buf, size_t len);
+static void local_on_close(net_conn_t *c, bool is_client);
+static void local_on_tick(uint32_t now);
+
+static const net_service_t LOCAL_SERVICE = {
+    .name            = "local",
+    .listen_port     = LOCAL_PORT,
+    .up_ip           = DONGLE_LOCAL_IP,
+    .up_port         = DONGLE_LOCAL_PORT,
+    .idle_ms         = LOCAL_IDLE_MS,
+    .shared_upstream = true,
+    .on_frame        = local_on_frame,
+    .on_close        = local_on_close,
+    .on_tick         = local_on_tick,
+};
+
+static bool is_read(uint8_t fn) {
+    return fn == LUX_FN_READ_INPUT || fn == LUX_FN_READ_HOLD;
+}
+
+// ── Request queue ─────────────────────────────────────────────
+static void q_remove(int i) {
+    memmove(&s_q[i], &s_q[i + 1], (s_qn - i - 1) * sizeof(fan_req_t));
+    s_qn--;
+}
+
+static bool q_push(net_conn_t *client, uint8_t fn, uint16_t start,
+                   uint16_t count, const uint8_t *frame, size_t len) {
+    if (s_qn >= FANOUT_QUEUE_LEN || len > FANOUT_MAX_FRAME) {
+        s_dropped++;
+        ESP_LOGW(TAG, "[%s] queue full — dropping fn=0x%02X reg=%u",
+                 client ? lux_net_conn_label(client) : "internal", fn, start);
+        return false;
     }
-    int ds = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    struct timeval tv = { .tv_sec = 10 };
-    setsockopt(ds, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    setsockopt(ds, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-
-    if (ds < 0 || connect(ds, res->ai_addr, res->ai_addrlen) != 0) {
-        ESP_LOGE(TAG, "[%s:%u] Cannot reach dongle %s:%d  errno=%d",
-                 cip, cport, DONGLE_LOCAL_IP, DONGLE_LOCAL_PORT, errno);
-        if (ds >= 0) close(ds);
-        freeaddrinfo(res);
-        close(cs);
-        vTaskDelete(NULL);
-        return;
+    fan_req_t *r = &s_q[s_qn++];
+    r->client = client;
+    r->fn     = fn;
+    r->start  = start;
+    r->count  = count;
+    r->seq    = frame[6];
+    r->sent   = false;
+    r->len    = (uint8_t)len;
+    memcpy(r->frame, frame, len);
+    return true;
+}
+
+// Send the next request upstream if idle; attach queued reads identical to
+// the one in flight. Stops at the first unsent write so a later read never
+// overtakes it with pre-write data.
+static void fan_dispatch(uint32_t now) {
+    net_conn_t *up = lux_net_upstream(&LOCAL_SERVICE);
+    if (!up) return;
+    for (int i = 0; i < s_qn; i++) {
+        fan_req_t *r = &s_q[i];
+        if (r->sent) continue;
+        if (s_trk.n > 0) {
+            const lux_trk_req_t *busy = &s_trk.req[0];
+            if (!is_read(r->fn)) break;
+            if (r->fn == busy->fn && r->start == busy->start &&
+                r->count == busy->count) {
+                r->sent = true;
+                s_coalesced++;
+            }
+            continue;
+        }
+        // Header byte 6 is outside the CRC: swap in our own seq
+        uint8_t seq = lux_trk_next_seq(&s_trk);
+        r->frame[6] = seq;
+        if (!lux_net_send(up, r->frame, r->len)) return;
+        r->sent = true;
+        lux_trk_sent(&s_trk, seq, r->fn, r->start, r->count, now);
     }
-    freeaddrinfo(res);
-
-    // Clear timeout for relay operation
-    tv.tv_sec = 0;
-    setsockopt(ds, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    setsockopt(ds, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-
-    ESP_LOGI(TAG, "[%s:%u] dongle %s:%d connected  fd:client=%d fd:dongle=%d",
-             cip, cport, DONGLE_LOCAL_IP, DONGLE_LOCAL_PORT, cs, ds);
-
-    // ── Relay loop ────────────────────────────────────────────
-    uint8_t *buf  = malloc(BUF_SIZE);
-    if (!buf) {
-        ESP_LOGE(TAG, "[%s:%u] malloc fail", cip, cport);
-        close(cs); close(ds);
-        vTaskDelete(NULL);
+}
+
+// Reply from the dongle: hand it to everyone waiting on (fn, start), each
+// with the seq of its own request. Late / repeated replies are dropped.
+static void fan_complete(uint8_t seq, uint8_t fn, uint16_t start,
+                         const uint8_t *frame, size_t len, uint32_t now) {
+    lux_trk_result_t res = lux_trk_match(&s_trk, seq, fn, start, now, NULL);
+    if (res != LUX_TRK_OK) {
+        ESP_LOGD(TAG, "%s reply seq=%u fn=0x%02X reg=%u",
+                 res == LUX_TRK_STALE     ? "late" :
+                 res == LUX_TRK_DUPLICATE ? "duplicate" : "unsolicited",
+                 seq, fn, start);
         return;
     }
+    bool patch = len <= sizeof(s_resp);
+    if (patch) memcpy(s_resp, frame, len);
+    for (int i = 0; i < s_qn;) {
+        fan_req_t *r = &s_q[i];
+        if (!r->sent || r->fn != fn || r->start != start) { i++; continue; }
+        if (r->client) {
+            if (patch) s_resp[6] = r->seq;
+            lux_net_send(r->client, patch ? s_resp : frame, len);
+        }
+        q_remove(i);
+    }
+}
+
+// Forget every request already sent (timeout / upstream lost)
+static void fan_abort_sent(void) {
+    for (int i = 0; i < s_qn;) {
+        if (s_q[i].sent) q_remove(i);
+        else i++;
+    }
+}
 
-    uint32_t bytes_c2d = 0, bytes_d2c = 0;
-    int maxfd = (cs > ds ? cs : ds) + 1;
+// ── Cache-served reads ────────────────────────────────────────
+// Answer a READ_INPUT/READ_HOLD from g_regs when every register asked for
+// is fresh. Never while a write is queued or in flight: the reply must not
+// predate a write the client (or MQTT) sent before it.
+static bool cache_reply(net_conn_t *c, const lux_parsed_t *p, uint8_t seq) {
+#if LOCAL_CACHE_MAX_AGE_MS > 0
+    uint16_t start = p->reg, count = p->count;
+    if (count == 0 || count > LUX_RESP_MAX_REGS) return false;
+    for (int i = 0; i < s_qn; i++)
+        if (!is_read(s_q[i].fn)) return false;
 
-    while (1) {
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(cs, &rfds);
-        FD_SET(ds, &rfds);
-        struct timeval sel_tv = { .tv_sec = 120 };
+    uint16_t regs[LUX_RESP_MAX_REGS];
+    bool input = p->dev_fn == LUX_FN_READ_INPUT;
+    if (input ? !reg_input_fresh(start, count, LOCAL_CACHE_MAX_AGE_MS)
+              : !reg_hold_fresh(start, count, LOCAL_CACHE_MAX_AGE_MS))
+        return false;
+    if (input ? !reg_read_input(start, regs, count)
+              : !reg_read_hold(start, regs, count))
+        return false;
 
-        int r = select(maxfd, &rfds, NULL, NULL, &sel_tv);
-        if (r < 0) {
-            ESP_LOGW(TAG, "[%s:%u] select err errno=%d", cip, cport, errno);
-            break;
-        }
-        if (r == 0) {
-            ESP_LOGW(TAG, "[%s:%u] idle 120s — closing", cip, cport);
-            break;
-        }
+    int len = lux_build_read_resp(s_resp, p->dev_fn, p->df + 2, start,
+                                  regs, count, seq);
+    lux_net_send(c, s_resp, len);
+    s_cache_hits++;
+    return true;
+#else
+    return false;
+#endif
+}
 
-        // ESPHome → dongle
-        if (FD_ISSET(cs, &rfds)) {
-            int n = recv(cs, buf, BUF_SIZE, 0);
-            if (n <= 0) {
-                ESP_LOGI(TAG, "[%s:%u] ESPHome closed (recv=%d errno=%d)",
-                         cip, cport, n, errno);
+// ── g_write_queue → upstream ──────────────────────────────────
+// In RELAY_MODE nothing else talks to the inverter, so MQTT writes go
+// through this session, in order with the clients' requests (unless the
+// RS485 poller owns the inverter).
+static void fan_take_writes(void) {
+#if defined(RELAY_MODE) && !defined(RS485_MASTER_MODE)
+    write_cmd_t cmd;
+    while (s_qn < FANOUT_QUEUE_LEN && lux_net_upstream(&LOCAL_SERVICE) &&
+           xQueueReceive(g_write_queue, &cmd, 0) == pdTRUE) {
+        uint8_t buf[FANOUT_MAX_FRAME];   // seq is set by fan_dispatch()
+        int len = 0;
+        switch (cmd.type) {
+            case CMD_WRITE_SINGLE:
+                len = lux_build_write_single(buf, cmd.reg, cmd.value, 0);
                 break;
-            }
-            bytes_c2d += n;
-            ESP_LOGD(TAG, "[%s:%u] ESP→dongle %dB  (total=%lu)",
-                     cip, cport, n, (unsigned long)bytes_c2d);
-            if (send(ds, buf, n, 0) < 0) {
-                ESP_LOGW(TAG, "[%s:%u] →dongle send fail errno=%d", cip, cport, errno);
+            case CMD_WRITE_MULTI:
+                len = lux_build_write_multi(buf, cmd.reg0, cmd.reg1, 0);
                 break;
-            }
-        }
-
-        // Dongle → ESPHome
-        if (FD_ISSET(ds, &rfds)) {
-            int n = recv(ds, buf, BUF_SIZE, 0);
-            if (n <= 0) {
-                ESP_LOGW(TAG, "[%s:%u] dongle closed (recv=%d errno=%d) — "
-                         "dongle may limit connections",
-                         cip, cport, n, errno);
+            case CMD_SET_LITHIUM:
+                len = lux_build_write_multi(buf, 0x801A, 0x0100, 0);
                 break;
-            }
-            bytes_d2c += n;
-            ESP_LOGD(TAG, "[%s:%u] dongle→ESP %dB  (total=%lu)",
-                     cip, cport, n, (unsigned long)bytes_d2c);
-            if (send(cs, buf, n, 0) < 0) {
-                ESP_LOGW(TAG, "[%s:%u] →ESPHome send fail errno=%d", cip, cport, errno);
+            case CMD_SET_LEADACID:
+                len = lux_build_write_multi(buf, 0x8019, 0x0100, 0);
                 break;
-            }
         }
+        if (len <= 0) continue;
+        lux_parsed_t p = lux_parse(buf, len);
+        ESP_LOGI(TAG, "→ WRITE fn=0x%02X reg=%u val=%u [%s]", p.dev_fn,
+                 p.reg, p.value, cmd.source);
+        q_push(NULL, p.dev_fn, p.reg, p.value, buf, len);
     }
+#endif
+}
+
+// ── Service callbacks ─────────────────────────────────────────
+static void local_on_frame(net_conn_t *c, bool from_client,
+                           const uint8_t *buf, size_t len) {
+    lux_capture_frame(from_client ? LUX_CAP_CLIENT_TO_LOCAL
+                                  : LUX_CAP_DONGLE_TO_LOCAL, buf, len);
+    // Heartbeats are 19 bytes, below lux_parse()'s minimum
+    bool heartbeat = len >= 8 && buf[7] == LUX_HEARTBEAT;
+    lux_parsed_t p = lux_parse(buf, len);
 
-    ESP_LOGI(TAG, "[%s:%u] ── session end  ESP→dongle:%luB  dongle→ESP:%luB",
-             cip, cport,
-             (unsigned long)bytes_c2d,
-             (unsigned long)bytes_d2c);
+    if (!from_client) {
+        if (heartbeat) {                        // keep the session alive
+            lux_net_send(c, buf, len);
+            return;
+        }
+        if (!p.df || !p.crc_ok) {
+            ESP_LOGW(TAG, "dongle→ESP bad frame (%uB)", (unsigned)len);
+            return;
+        }
+        uint16_t regs[128], start;
+        uint16_t n = lux_resp_regs(&p, &start, regs, 128);
+        if (n && p.dev_fn == LUX_FN_READ_INPUT)     reg_update_input(start, regs, n);
+        else if (n && p.dev_fn == LUX_FN_READ_HOLD) reg_update_hold(start, regs, n);
+        else if (p.dev_fn == LUX_FN_WRITE_SINGLE)   reg_update_hold(p.reg, &p.value, 1);
+        else if (p.dev_fn == LUX_FN_WRITE_MULTI)    reg_hold_invalidate(p.reg, p.value);
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        fan_complete(buf[6], p.dev_fn, p.reg, buf, len, now);
+        fan_dispatch(now);
+        return;
+    }
 
-    free(buf);
-    close(cs);
-    close(ds);
-    vTaskDelete(NULL);
+    // Clients only echo heartbeats they were sent; none are forwarded
+    if (heartbeat) return;
+    if (!p.df || !p.crc_ok ||
+        (p.type != LUX_PKT_READ_REQ && p.type != LUX_PKT_WRITE_SINGLE_REQ &&
+         p.type != LUX_PKT_WRITE_MULTI_REQ)) {
+        ESP_LOGW(TAG, "[%s] unsupported/bad request (%uB) — ignored",
+                 lux_net_conn_label(c), (unsigned)len);
+        return;
+    }
+    ESP_LOGD(TAG, "[%s] fn=0x%02X reg=%u n=%u", lux_net_conn_label(c),
+             p.dev_fn, p.reg, p.value);
+    if (p.type == LUX_PKT_READ_REQ && is_read(p.dev_fn) && cache_reply(c, &p, buf[6]))
+        return;
+    if (q_push(c, p.dev_fn, p.reg, p.value, buf, len))
+        fan_dispatch(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+static void local_on_close(net_conn_t *c, bool is_client) {
+    if (!is_client) {
+        // Requests in flight are lost with the session; queued ones wait
+        fan_abort_sent();
+        lux_trk_reset(&s_trk);
+        return;
+    }
+    for (int i = 0; i < s_qn;) {
+        if (s_q[i].client == c) q_remove(i);
+        else i++;
+    }
 }
 
-// ── Accept loop ───────────────────────────────────────────────
-static void server_task(void *arg) {
-    int ls = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (ls < 0) { ESP_LOGE(TAG, "socket err %d", errno); vTaskDelete(NULL); return; }
-
-    int opt = 1;
-    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-    struct sockaddr_in ba = {
-        .sin_family      = AF_INET,
-        .sin_addr.s_addr = INADDR_ANY,
-        .sin_port        = htons(LOCAL_PORT),
-    };
-    if (bind(ls, (struct sockaddr *)&ba, sizeof(ba)) || listen(ls, 4)) {
-        ESP_LOGE(TAG, "bind/listen err %d", errno);
-        close(ls); vTaskDelete(NULL); return;
+static void local_on_tick(uint32_t now) {
+    lux_trk_req_t req;
+    if (lux_trk_expire(&s_trk, now, &req)) {
+        ESP_LOGW(TAG, "dongle timeout seq=%u fn=0x%02X reg=%u", req.seq, req.fn, req.start);
+        fan_abort_sent();
     }
-    ESP_LOGI(TAG, "Listening :%d  →  %s:%d",
-             LOCAL_PORT, DONGLE_LOCAL_IP, DONGLE_LOCAL_PORT);
-
-    while (1) {
-        struct sockaddr_in ca; socklen_t cl = sizeof(ca);
-        int cs = accept(ls, (struct sockaddr *)&ca, &cl);
-        if (cs < 0) { ESP_LOGE(TAG, "accept err %d", errno); continue; }
-
-        conn_arg_t *a = malloc(sizeof(conn_arg_t));
-        if (!a) { close(cs); continue; }
-        a->client      = cs;
-        a->client_port = ntohs(ca.sin_port);
-        inet_ntop(AF_INET, &ca.sin_addr, a->client_ip, sizeof(a->client_ip));
-
-        ESP_LOGI(TAG, "ESPHome connecting: %s:%u", a->client_ip, a->client_port);
-        xTaskCreate(conn_task, "local_conn", CONN_STACK, a, TASK_PRIO, NULL);
+    fan_take_writes();
+    fan_dispatch(now);
+
+    if (now - s_stats_ms >= FANOUT_STATS_MS) {
+        s_stats_ms = now;
+        const lux_trk_stats_t *st = &s_trk.stats;
+        if (st->sent || s_coalesced || s_cache_hits) {
+            ESP_LOGI(TAG, "fan-out: forwarded=%lu coalesced=%lu cached=%lu "
+                     "timeouts=%lu late=%lu dup=%lu unsolicited=%lu dropped=%lu queued=%d "
+                     "seq-echo=%s",
+                     (unsigned long)st->sent, (unsigned long)s_coalesced,
+                     (unsigned long)s_cache_hits, (unsigned long)st->timeouts,
+                     (unsigned long)st->stale, (unsigned long)st->duplicates,
+                     (unsigned long)st->unsolicited, (unsigned long)s_dropped, s_qn,
+                     lux_trk_seq_trusted(&s_trk) ? "yes" : "no");
+            static const char *const KIND[LUX_TRK_KINDS] = { "input", "hold", "write" };
+            for (int k = 0; k < LUX_TRK_KINDS; k++) {
+                const lux_lat_hist_t *h = &s_trk.lat[k];
+                if (!h->count) continue;
+                ESP_LOGI(TAG, "  %-5s n=%lu p50=%lums p95=%lums p99=%lums max=%lums", KIND[k],
+                         (unsigned long)h->count,
+                         (unsigned long)lux_lat_percentile(h, 50),
+                         (unsigned long)lux_lat_percentile(h, 95),
+                         (unsigned long)lux_lat_percentile(h, 99),
+                         (unsigned long)h->max);
+            }
+        }
     }
 }
 
 void lux_local_server_start(void) {
-    xTaskCreatePinnedToCore(server_task, "local_srv",
-                            SRV_STACK, NULL, TASK_PRIO, NULL, 0);
-    ESP_LOGI(TAG, "Local relay started :%d", LOCAL_PORT);
-}
\ No newline at end of file
+    lux_trk_init(&s_trk, FANOUT_REQ_TIMEOUT_MS);
+    if (lux_net_add_service(&LOCAL_SERVICE))
+        ESP_LOGI(TAG, "Local fan-out :%d → %s:%d (one dongle session)",
+                 LOCAL_PORT, DONGLE_LOCAL_IP, DONGLE_LOCAL_PORT);
+}
@@ -1,7 +1,9 @@
 #pragma once
 // lux_local_server.h
-// TCP :8000 — LuxApp local connection
-// ESP32 pushes shared_state data to the app using the same A1 1A protocol.
+// TCP :8000 — fan-out server: any number of local clients (ESPHome, HA,
+// tools) share ONE persistent session to the real dongle, which itself only
+// accepts a single client. Requests are serialized upstream, replies update
+// shared_state, MQTT writes (g_write_queue) go out on the same session.
 // Call lux_local_server_start() after WiFi is connected.
 
 void lux_local_server_start(void);
\ No newline at end of file
@@ -10,75 +10,234 @@
 #include "config.h"
 #include "shared_state.h"
 #include "lux_log_mqtt.h"
+#include "lux_mqtt.h"
+#include "lux_regdecode.h"
 
 static const char *TAG = "lux_mqtt";
 static esp_mqtt_client_handle_t s_client = NULL;
 static bool s_connected = false;
+static volatile bool s_full_pending = true;   // next publish sends everything
+static uint32_t s_pub_sent = 0, s_pub_skipped = 0;
+
+// Frame -> broker latency over the current refresh window (microseconds):
+// from reg_update_*() storing a change to the last publish call for it.
+typedef struct {
+    uint32_t n;
+    int64_t  min_us, max_us, sum_us;
+} latency_stats_t;
+static latency_stats_t s_lat = {};
 
 // ── Sensor map ────────────────────────────────────────────────
+// Input values decode through the shared table in lux_regdecode.h; the
+// HOLD (config) values are plain words with local descriptors.
 typedef struct {
-    const char *name;
-    uint16_t    reg;
-    bool        is_input;
-    float       scale;
-    bool        is_signed;
+    const char        *name;
+    bool               is_input;
+    const lux_field_t *f;
 } mqtt_sensor_t;
 
+static const lux_field_t HOLD_CHARGE_RATE = LUX_FIELD(101, U16, 0, 0, 1);
+static const lux_field_t HOLD_DISCHG_RATE = LUX_FIELD(102, U16, 0, 0, 1);
+static const lux_field_t HOLD_EOD_SOC     = LUX_FIELD(105, U16, 0, 0, 1);
+
+// bat_curr keeps the scale it was published with (see config.h)
+#if MQTT_BAT_CURR_LEGACY
+static const lux_field_t IN_BAT_CURR_LEGACY = LUX_FIELD(98, S16, 0, 0, 100);
+#define BAT_CURR_FIELD &IN_BAT_CURR_LEGACY
+#else
+#define BAT_CURR_FIELD IN(BAT_CURRENT)
+#endif
+
+#define IN(id) &LUX_INPUT_FIELD[LUX_IN_##id]
 static const mqtt_sensor_t SENSORS[] = {
-    {"vpv1",      1,  true,  0.1f,  false},
-    {"vpv2",      2,  true,  0.1f,  false},
-    {"vbat",      4,  true,  0.1f,  false},
-    {"soc",       5,  true,  1.0f,  false},   // low byte only
-    {"ppv1",      7,  true,  1.0f,  false},
-    {"ppv2",      8,  true,  1.0f,  false},
-    {"p_charge",  10, true,  1.0f,  false},
-    {"p_discharge",11,true,  1.0f,  false},
-    {"vac_r",     12, true,  0.1f,  false},
-    {"fac",       15, true,  0.01f, false},
-    {"p_inv",     16, true,  1.0f,  false},
-    {"p_to_grid", 26, true,  1.0f,  false},
-    {"p_to_user", 27, true,  1.0f,  false},
-    {"t_inner",   64, true,  1.0f,  true },
-    {"t_rad1",    65, true,  1.0f,  true },
-    {"t_bat",     67, true,  1.0f,  true },
-    {"bat_curr",  98, true,  0.01f, true },
-    {"p_load",   170, true,  1.0f,  false},
+    {"vpv1",       true, IN(V_PV1)},
+    {"vpv2",       true, IN(V_PV2)},
+    {"vbat",       true, IN(V_BAT)},
+    {"soc",        true, IN(SOC)},
+    {"ppv1",       true, IN(P_PV1)},
+    {"ppv2",       true, IN(P_PV2)},
+    {"p_charge",   true, IN(P_CHARGE)},
+    {"p_discharge",true, IN(P_DISCHARGE)},
+    {"vac_r",      true, IN(V_AC_R)},
+    {"fac",        true, IN(F_AC)},
+    {"p_inv",      true, IN(P_INV)},
+    {"p_to_grid",  true, IN(P_TO_GRID)},
+    {"p_to_user",  true, IN(P_TO_USER)},
+    {"t_inner",    true, IN(T_INNER)},
+    {"t_rad1",     true, IN(T_RAD1)},
+    {"t_bat",      true, IN(T_BAT)},
+    {"bat_curr",   true, BAT_CURR_FIELD},
+    {"p_load",     true, IN(P_LOAD)},
     // HOLD (config)
-    {"charge_rate", 101, false, 1.0f, false},
-    {"dischg_rate", 102, false, 1.0f, false},
-    {"eod_soc",     105, false, 1.0f, false},
+    {"charge_rate", false, &HOLD_CHARGE_RATE},
+    {"dischg_rate", false, &HOLD_DISCHG_RATE},
+    {"eod_soc",     false, &HOLD_EOD_SOC},
 };
+#undef IN
+#undef BAT_CURR_FIELD
 #define SENSOR_COUNT (sizeof(SENSORS) / sizeof(mqtt_sensor_t))
 
+// Derived sensors, computed in mqtt_publish() from bank 0 registers
+static const char *const DERIVED[] = {"ppv_total", "bat_power"};
+#define DERIVED_COUNT (sizeof(DERIVED) / sizeof(DERIVED[0]))
+#define OUT_COUNT     (SENSOR_COUNT + DERIVED_COUNT)
+
+// Batched mode groups values by 40-register input bank; HOLD values share
+// one extra document.
+#define BANK_HOLD     (INPUT_REG_COUNT / 40)
+#define BANK_COUNT    (BANK_HOLD + 1)
+
+static uint8_t out_bank(int i) {
+    if (i >= (int)SENSOR_COUNT) return 0;
+    return SENSORS[i].is_input ? SENSORS[i].f->addr / 40 : BANK_HOLD;
+}
+
+static const char *out_name(int i) {
+    return i < (int)SENSOR_COUNT ? SENSORS[i].name : DERIVED[i - SENSOR_COUNT];
+}
+
+static void bank_topic(uint8_t bank, char *out, size_t out_len) {
+    if (bank == BANK_HOLD)
+        snprintf(out, out_len, MQTT_PREFIX "/state/bank/hold");
+    else
+        snprintf(out, out_len, MQTT_PREFIX "/state/bank/%u", bank);
+}
+
+void lux_mqtt_state_topic(const char *name, char *out, size_t out_len) {
+#if MQTT_BATCH_JSON
+    for (int i = 0; i < (int)OUT_COUNT; i++) {
+        if (strcmp(out_name(i), name) == 0) {
+            bank_topic(out_bank(i), out, out_len);
+            return;
+        }
+    }
+#endif
+    snprintf(out, out_len, MQTT_PREFIX "/state/%s", name);
+}
+
+// Derived sensors (ppv_total, bat_power) only use registers already listed.
+void lux_mqtt_needed_regs(lux_reg_set_t *input, lux_reg_set_t *hold) {
+    for (int i = 0; i < (int)SENSOR_COUNT; i++)
+        lux_regset_add(SENSORS[i].is_input ? input : hold, SENSORS[i].f->addr,
+                       lux_field_width(SENSORS[i].f));
+}
+
 // ── Publish helpers ───────────────────────────────────────────
+// "%.2f" without snprintf: the float formatter dominates publish CPU time.
+// Returns the length written (max 22 chars incl. sign).
+static int fmt_2dp(char *out, float val) {
+    double v = val;
+    char *p = out;
+    if (v < 0) { *p++ = '-'; v = -v; }
+    if (!(v < 9.0e17)) return p - out + sprintf(p, "%.2f", v);   // inf/nan/huge
+    // float * 100 is exact in double, so ties can round half-even like printf
+    double x = v * 100.0;
+    uint64_t c = (uint64_t)x;
+    double frac = x - (double)c;
+    if (frac > 0.5 || (frac == 0.5 && (c & 1))) c++;
+    char tmp[20];
+    int n = 0;
+    uint64_t ip = c / 100;
+    do { tmp[n++] = (char)('0' + ip % 10); ip /= 10; } while (ip);
+    while (n) *p++ = tmp[--n];
+    *p++ = '.';
+    *p++ = (char)('0' + (c / 10) % 10);
+    *p++ = (char)('0' + c % 10);
+    *p = '\0';
+    return p - out;
+}
+
 static void pub_float(const char *name, float val) {
     if (!s_connected) return;
     char topic[64], payload[24];
-    snprintf(topic,   sizeof(topic),   MQTT_PREFIX "/state/%s", name);
-    snprintf(payload, sizeof(payload), "%.2f", val);
+    snprintf(topic, sizeof(topic), MQTT_PREFIX "/state/%s", name);
+    fmt_2dp(payload, val);
     esp_mqtt_client_publish(s_client, topic, payload, 0, 0, 0);
 }
 
-static void mqtt_publish_all(void) {
+#if MQTT_BATCH_JSON
+// One {"name":value,...} document per bank that has anything changed; the
+// whole bank is sent so HA templates always find every key.
+// Only the MQTT task publishes, so the buffer can be static.
+static char s_json[640];
+
+static uint32_t pub_banks(const float *val, const bool *chg) {
+    uint32_t sent = 0;
+    for (uint8_t b = 0; b < BANK_COUNT; b++) {
+        bool any = false;
+        for (int i = 0; i < (int)OUT_COUNT && !any; i++)
+            any = chg[i] && out_bank(i) == b;
+        if (!any) continue;
+
+        int len = 0;
+        s_json[len++] = '{';
+        for (int i = 0; i < (int)OUT_COUNT; i++) {
+            if (out_bank(i) != b) continue;
+            const char *name = out_name(i);
+            size_t nl = strlen(name);
+            if (len + nl + 28 >= sizeof(s_json)) break;
+            if (len > 1) s_json[len++] = ',';
+            s_json[len++] = '"';
+            memcpy(s_json + len, name, nl);
+            len += nl;
+            s_json[len++] = '"';
+            s_json[len++] = ':';
+            len += fmt_2dp(s_json + len, val[i]);
+            sent++;
+        }
+        s_json[len++] = '}';
+        char topic[48];
+        bank_topic(b, topic, sizeof(topic));
+        esp_mqtt_client_publish(s_client, topic, s_json, len, 0, 0);
+    }
+    return sent;
+}
+#endif
+
+static bool regs_dirty(const lux_reg_set_t *d, uint16_t addr, uint16_t n) {
+    for (; n > 0; addr++, n--)
+        if (lux_regset_has(d, addr)) return true;
+    return false;
+}
+
+// Publish the sensors whose source registers are set in the dirty sets
+// (everything when `full`). One lock-free snapshot per publish; every
+// value, derived ones too, comes from the same copy of the cache.
+static void mqtt_publish(bool full) {
+    lux_reg_set_t din, dhold;
+    reg_take_dirty(&din, &dhold);
+    reg_snapshot_t snap;
+    reg_snapshot(&snap);
+
+    float val[OUT_COUNT];
+    bool  chg[OUT_COUNT];
     for (int i = 0; i < (int)SENSOR_COUNT; i++) {
         const mqtt_sensor_t *s = &SENSORS[i];
-        uint16_t raw = s->is_input ? reg_get_input(s->reg)
-                                   : reg_get_hold(s->reg);
-        float val;
-        if (s->is_signed) {
-            val = (float)(int16_t)raw * s->scale;
-        } else {
-            // SOC stored in low byte
-            if (s->reg == 5 && s->is_input) raw = raw & 0xFF;
-            val = (float)raw * s->scale;
-        }
-        pub_float(s->name, val);
+        val[i] = lux_field_value(s->f, s->is_input ? snap.input : snap.hold);
+        chg[i] = full || regs_dirty(s->is_input ? &din : &dhold, s->f->addr,
+                                    lux_field_width(s->f));
     }
     // Derived sensors
-    pub_float("ppv_total",
-              (float)(reg_get_input(7) + reg_get_input(8)));
-    pub_float("bat_power",
-              (float)reg_get_input(10) - (float)reg_get_input(11));
+    val[SENSOR_COUNT]     = (float)(snap.input[7] + snap.input[8]);
+    chg[SENSOR_COUNT]     = full || regs_dirty(&din, 7, 2);
+    val[SENSOR_COUNT + 1] = (float)snap.input[10] - (float)snap.input[11];
+    chg[SENSOR_COUNT + 1] = full || regs_dirty(&din, 10, 2);
+
+    uint32_t sent = 0;
+#if MQTT_BATCH_JSON
+    if (s_connected) sent = pub_banks(val, chg);
+#else
+    for (int i = 0; i < (int)OUT_COUNT; i++) {
+        if (!chg[i]) continue;
+        pub_float(out_name(i), val[i]);
+        sent++;
+    }
+#endif
+    s_pub_sent    += sent;
+    s_pub_skipped += OUT_COUNT - sent;
+    ESP_LOGD(TAG, "publish %s: %lu/%u (total sent=%lu skipped=%lu)",
+             full ? "full" : "delta", (unsigned long)sent, (unsigned)OUT_COUNT,
+             (unsigned long)s_pub_sent, (unsigned long)s_pub_skipped);
 }
 
 // ── Subscribe to commands ─────────────────────────────────────
@@ -146,7 +305,8 @@ static void mqtt_event_handler(void *arg, esp_event_base_t base,
             lux_log_mqtt_attach(ev->client);   // redirect logs to MQTT
             mqtt_subscribe_all();
             lux_ha_discovery_publish(ev->client);
-            mqtt_publish_all();
+            s_full_pending = true;   // retained state may be stale; task resends all
+            xEventGroupSetBits(g_events.group, EV_PUBLISH_ALL);
             break;
 
         case MQTT_EVENT_DISCONNECTED:
@@ -188,22 +348,52 @@ void lux_mqtt_init(void) {
     ESP_LOGI(TAG, "MQTT client → %s", MQTT_BROKER_URI);
 }
 
+static void latency_add(int64_t us) {
+    if (s_lat.n == 0 || us < s_lat.min_us) s_lat.min_us = us;
+    if (s_lat.n == 0 || us > s_lat.max_us) s_lat.max_us = us;
+    s_lat.sum_us += us;
+    s_lat.n++;
+}
+
+static void latency_report(void) {
+    if (s_lat.n == 0) return;
+    ESP_LOGI(TAG, "publish latency: n=%lu min=%.1f avg=%.1f max=%.1f ms",
+             (unsigned long)s_lat.n, s_lat.min_us / 1000.0,
+             (double)s_lat.sum_us / s_lat.n / 1000.0, s_lat.max_us / 1000.0);
+    memset(&s_lat, 0, sizeof(s_lat));
+}
+
 void lux_mqtt_task(void *arg) {
     ESP_LOGI(TAG, "MQTT task on core %d", xPortGetCoreID());
     lux_mqtt_init();
 
-    uint32_t last_pub = 0;
+    uint32_t last_full = xTaskGetTickCount() * portTICK_PERIOD_MS;
     while (1) {
+        // Sleep until a register update (or connect) signals, or the next
+        // full refresh is due - no polling.
         uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        uint32_t since = now - last_full;
+        TickType_t wait = since >= MQTT_FULL_REFRESH_MS
+                        ? 0 : pdMS_TO_TICKS(MQTT_FULL_REFRESH_MS - since);
+        EventBits_t ev = xEventGroupWaitBits(g_events.group, EV_ALL,
+                                             pdTRUE, pdFALSE, wait);
+        now = xTaskGetTickCount() * portTICK_PERIOD_MS;
 
-        bool do_pub = false;
-        xSemaphoreTake(g_events.mutex, portMAX_DELAY);
-        if (g_events.input_updated) { g_events.input_updated = false; do_pub = true; }
-        xSemaphoreGive(g_events.mutex);
-
-        if (now - last_pub >= POLL_INPUT_MS) { do_pub = true; last_pub = now; }
-        if (do_pub && s_connected) mqtt_publish_all();
+        // Unchanged values still go out now and then so a broker/HA restart
+        // without retained state recovers.
+        if (now - last_full >= MQTT_FULL_REFRESH_MS) {
+            s_full_pending = true;
+            latency_report();
+        }
+        int64_t changed_us = __atomic_exchange_n(&g_events.first_change_us, 0,
+                                                 __ATOMIC_ACQUIRE);
+        if (!s_connected) continue;   // dirty sets keep; connect sends all
+        if (!(ev & EV_ALL) && !s_full_pending) continue;
 
-        vTaskDelay(pdMS_TO_TICKS(500));
+        bool full = s_full_pending;
+        s_full_pending = false;
+        if (full) last_full = now;
+        mqtt_publish(full);
+        if (changed_us) latency_add(esp_timer_get_time() - changed_us);
     }
-}
\ No newline at end of file
+}
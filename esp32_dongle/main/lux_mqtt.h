@@ -0,0 +1,19 @@
+#pragma once
+// lux_mqtt.h
+// MQTT publisher + command handler (Home Assistant discovery).
+#include "lux_read_plan.h"
+
+void lux_mqtt_init(void);
+void lux_mqtt_task(void *arg);
+
+/**
+ * Mark every register the MQTT sensor map publishes.
+ * Pollers feed this to lux_plan_reads() so they only fetch what is used.
+ */
+void lux_mqtt_needed_regs(lux_reg_set_t *input, lux_reg_set_t *hold);
+
+/**
+ * State topic HA discovery should use for sensor `name`: lux/state/<name>,
+ * or its bank document lux/state/bank/<n> when MQTT_BATCH_JSON is set.
+ */
+void lux_mqtt_state_topic(const char *name, char *out, size_t out_len);
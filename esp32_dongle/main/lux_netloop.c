@@ -0,0 +1,604 @@
+// lux_netloop.c
+// Single select() loop for all TCP relay sessions (see lux_netloop.h).
+//
+// Per connection state machine:
+//   WAIT_PEER   accepted client, upstream still connecting (not read yet,
+//               bytes wait in the socket buffer)
+//   CONNECTING  non-blocking connect() to the upstream in progress
+//   OPEN        relaying
+// Either side closing, erroring or idling out closes the pair.
+//
+// Shared-upstream services have no pairs: clients go straight to OPEN and
+// the one upstream connection belongs to the listener, reconnecting every
+// NET_RECONNECT_MS while down. Closing a client never touches the upstream.
+//
+// Sockets stay non-blocking. Bytes read from one side are appended to the
+// peer's output ring and flushed as the peer becomes writable; a short
+// send just leaves the rest queued. While the peer's ring has less than
+// NET_RX_MIN free, the source is not read at all (TCP flow control pushes
+// back on the sender) and the time spent like that is counted as a stall.
+//
+// A slot's output ring and reassembly buffer are one heap block taken when
+// the slot is handed out and freed when it is released, so an idle pool
+// costs ~100 bytes per slot instead of 3 KB (with PSRAM the block lands
+// there, see CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL).
+
+#include "lux_netloop.h"
+#include "lux_proto.h"
+#include "config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "netloop";
+
+#if defined(CONFIG_LWIP_MAX_SOCKETS) && CONFIG_LWIP_MAX_SOCKETS < LWIP_SOCKET_BUDGET
+#error "CONFIG_LWIP_MAX_SOCKETS is below LWIP_SOCKET_BUDGET (config.h): the pool would run dry"
+#endif
+#if NET_MAX_CONNS < 3
+#error "NET_MAX_CONNS leaves no room for a relay pair and the :8000 upstream"
+#endif
+
+#define NET_BUF_SIZE          1024
+#define NET_MAX_SERVICES      4
+#define NET_CONNECT_TIMEOUT_MS 15000
+#define NET_OUTQ_SIZE         2048      // per connection, bytes towards it
+#define NET_RX_MIN            256       // read the peer only with this much room
+#define NET_SEND_TIMEOUT_MS   5000      // queued output with no progress
+#define NET_RECONNECT_MS      5000
+#define NET_WAIT_LOG_MS       60000
+#define NET_TICK_MS           250       // select() timeout with shared services
+#define NET_TASK_STACK        4096
+#define NET_TASK_PRIO         5
+
+typedef enum {
+    NC_FREE = 0,
+    NC_WAIT_PEER,
+    NC_CONNECTING,
+    NC_OPEN,
+} nc_state_t;
+
+struct net_conn {
+    int                  fd;
+    nc_state_t           state;
+    bool                 is_client;
+    const net_service_t *svc;
+    net_conn_t          *peer;
+    uint32_t             since_ms;      // accept / connect start
+    uint32_t             last_rx_ms;
+    uint32_t             bytes_in;
+    bool                 eof;           // read side done, flushing the peer
+    const char          *doom;          // close reason, acted on by the loop
+    uint32_t             tx_wait_ms;    // last send progress while queued
+    // Backpressure on this (source) side: peer's ring full
+    uint32_t             stall_since_ms;    // 0 = not stalled
+    uint32_t             stalls;
+    uint32_t             stall_ms;
+    size_t               oq_head, oq_len;   // output ring, bytes to send
+    uint8_t             *oq;            // NET_OUTQ_SIZE, start of the slot's block
+    char                 label[24];
+    size_t               fb_len;        // frame reassembly
+    uint8_t             *fb;            // NET_BUF_SIZE, after oq
+};
+
+typedef struct {
+    const net_service_t *svc;
+    int                  fd;
+    uint32_t             last_log_ms;
+    net_conn_t          *up;            // shared upstream (NULL while down)
+    uint32_t             up_retry_ms;
+} net_listener_t;
+
+static net_conn_t     s_conns[NET_MAX_CONNS];
+static net_listener_t s_lsn[NET_MAX_SERVICES];
+static int            s_nlsn = 0;
+static bool           s_task_started = false;
+static bool           s_any_shared = false;
+static uint8_t        s_rx[NET_BUF_SIZE];   // recv scratch, loop task only
+static uint32_t       s_stalls_total = 0, s_stall_ms_total = 0;
+
+static uint32_t now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+const char *lux_net_conn_label(const net_conn_t *c) {
+    return c->label;
+}
+
+static void set_nonblock(int fd, bool on) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, on ? (fl | O_NONBLOCK) : (fl & ~O_NONBLOCK));
+}
+
+// ── Pool ──────────────────────────────────────────────────────
+// The slot's buffers are allocated here and freed by conn_release(), which
+// every path that gives a slot back goes through. NULL if no slot or no heap.
+static net_conn_t *conn_alloc(void) {
+    for (int i = 0; i < NET_MAX_CONNS; i++) {
+        net_conn_t *c = &s_conns[i];
+        if (c->state != NC_FREE) continue;
+        if (!c->oq) c->oq = (uint8_t *)malloc(NET_OUTQ_SIZE + NET_BUF_SIZE);
+        if (!c->oq) {
+            ESP_LOGE(TAG, "no heap for a connection (%u B)",
+                     (unsigned)(NET_OUTQ_SIZE + NET_BUF_SIZE));
+            return NULL;
+        }
+        c->fb = c->oq + NET_OUTQ_SIZE;
+        c->fd = -1;
+        return c;
+    }
+    return NULL;
+}
+
+// Free slots, minus one held back for every shared upstream that is down
+static int conns_free(void) {
+    int n = 0;
+    for (int i = 0; i < NET_MAX_CONNS; i++)
+        if (s_conns[i].state == NC_FREE) n++;
+    int nlsn = __atomic_load_n(&s_nlsn, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < nlsn; i++)
+        if (s_lsn[i].svc->shared_upstream && !s_lsn[i].up) n--;
+    return n;
+}
+
+static net_listener_t *listener_of(const net_service_t *svc) {
+    int nlsn = __atomic_load_n(&s_nlsn, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < nlsn; i++)
+        if (s_lsn[i].svc == svc) return &s_lsn[i];
+    return NULL;
+}
+
+static void conn_release(net_conn_t *c) {
+    if (c->fd >= 0) close(c->fd);
+    free(c->oq);
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+}
+
+static void stall_end(net_conn_t *c, uint32_t now) {
+    if (!c->stall_since_ms) return;
+    uint32_t d = now - c->stall_since_ms;
+    c->stall_ms      += d;
+    s_stall_ms_total += d;
+    c->stall_since_ms = 0;
+}
+
+static void pair_close(net_conn_t *c, const char *why) {
+    net_conn_t *cl = c->is_client ? c : c->peer;
+    net_conn_t *up = c->is_client ? c->peer : c;
+    uint32_t now = now_ms();
+    if (cl) stall_end(cl, now);
+    if (up) stall_end(up, now);
+    ESP_LOGI(TAG, "[%s] %s: session end (%s)  client→up:%luB  up→client:%luB",
+             c->label, c->svc->name, why,
+             (unsigned long)(cl ? cl->bytes_in : 0),
+             (unsigned long)(up ? up->bytes_in : 0));
+    uint32_t stalls = (cl ? cl->stalls : 0) + (up ? up->stalls : 0);
+    if (stalls)
+        ESP_LOGI(TAG, "[%s] %s: stalls client %lu/%lums  upstream %lu/%lums"
+                 "  (total %lu/%lums)", c->label, c->svc->name,
+                 (unsigned long)(cl ? cl->stalls : 0), (unsigned long)(cl ? cl->stall_ms : 0),
+                 (unsigned long)(up ? up->stalls : 0), (unsigned long)(up ? up->stall_ms : 0),
+                 (unsigned long)s_stalls_total, (unsigned long)s_stall_ms_total);
+    if (cl) conn_release(cl);
+    if (up) conn_release(up);
+}
+
+// Shared mode: close one connection; an upstream is retried later
+static void shared_close(net_conn_t *c, const char *why) {
+    const net_service_t *svc = c->svc;
+    stall_end(c, now_ms());
+    ESP_LOGI(TAG, "[%s] %s: %s closed (%s)  in:%luB  stalls %lu/%lums",
+             c->label, svc->name, c->is_client ? "client" : "upstream", why,
+             (unsigned long)c->bytes_in, (unsigned long)c->stalls,
+             (unsigned long)c->stall_ms);
+    if (svc->on_close) svc->on_close(c, c->is_client);
+    if (!c->is_client) {
+        net_listener_t *l = listener_of(svc);
+        l->up          = NULL;
+        l->up_retry_ms = now_ms() + NET_RECONNECT_MS;
+    }
+    conn_release(c);
+}
+
+static void conn_close(net_conn_t *c, const char *why) {
+    if (c->svc->shared_upstream) shared_close(c, why);
+    else                         pair_close(c, why);
+}
+
+// ── Frame reassembly ──────────────────────────────────────────
+static void conn_emit_frame(void *ctx, const uint8_t *frame, size_t len) {
+    net_conn_t *c = (net_conn_t *)ctx;
+    c->svc->on_frame(c, c->is_client, frame, len);
+}
+
+static void conn_feed_frames(net_conn_t *c, const uint8_t *data, int n) {
+    if (!c->svc->on_frame) return;
+    lux_frame_feed(c->fb, &c->fb_len, NET_BUF_SIZE, data, (size_t)n,
+                   conn_emit_frame, c);
+}
+
+// ── Output ring ───────────────────────────────────────────────
+static size_t oq_free(const net_conn_t *c) {
+    return NET_OUTQ_SIZE - c->oq_len;
+}
+
+static void oq_push(net_conn_t *c, const uint8_t *data, size_t n) {
+    if (c->oq_len == 0) c->tx_wait_ms = now_ms();
+    size_t tail = (c->oq_head + c->oq_len) % NET_OUTQ_SIZE;
+    size_t first = NET_OUTQ_SIZE - tail;
+    if (first > n) first = n;
+    memcpy(c->oq + tail, data, first);
+    memcpy(c->oq, data + first, n - first);
+    c->oq_len += n;
+}
+
+// Send as much queued output as the socket takes. False on a hard error.
+static bool conn_flush(net_conn_t *c) {
+    while (c->oq_len) {
+        size_t chunk = NET_OUTQ_SIZE - c->oq_head;
+        if (chunk > c->oq_len) chunk = c->oq_len;
+        int n = send(c->fd, c->oq + c->oq_head, chunk, 0);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+        c->oq_head = (c->oq_head + n) % NET_OUTQ_SIZE;
+        c->oq_len -= n;
+        c->tx_wait_ms = now_ms();
+        if ((size_t)n < chunk) break;       // socket buffer full
+    }
+    if (c->oq_len == 0) c->oq_head = 0;
+    return true;
+}
+
+// ── Accept: client slot + upstream slot, non-blocking connect ─
+static void listener_accept(net_listener_t *l) {
+    struct sockaddr_in ca;
+    socklen_t cl = sizeof(ca);
+    int cs = accept(l->fd, (struct sockaddr *)&ca, &cl);
+    if (cs < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            ESP_LOGE(TAG, "%s: accept err %d", l->svc->name, errno);
+        return;
+    }
+    char label[24], ip[16];
+    inet_ntop(AF_INET, &ca.sin_addr, ip, sizeof(ip));
+    snprintf(label, sizeof(label), "%s:%u", ip, ntohs(ca.sin_port));
+
+    bool shared = l->svc->shared_upstream;
+    if (conns_free() < (shared ? 1 : 2)) {
+        ESP_LOGW(TAG, "[%s] %s: connection pool full — rejecting", label, l->svc->name);
+        close(cs);
+        return;
+    }
+    net_conn_t *c = conn_alloc();
+    if (!c) {
+        close(cs);
+        return;
+    }
+    if (shared) {
+        int one = 1;
+        set_nonblock(cs, true);
+        setsockopt(cs, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        c->fd = cs;         c->is_client = true;  c->svc = l->svc;
+        c->state = NC_OPEN;
+        c->since_ms = now_ms(); c->last_rx_ms = c->since_ms;
+        strncpy(c->label, label, sizeof(c->label) - 1);
+        ESP_LOGI(TAG, "[%s] %s: client fd=%d", label, l->svc->name, cs);
+        return;
+    }
+    c->state = NC_WAIT_PEER;
+    net_conn_t *u = conn_alloc();
+    if (!u) {
+        conn_release(c);
+        close(cs);
+        return;
+    }
+
+    int us = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in ua = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(l->svc->up_port),
+    };
+    inet_pton(AF_INET, l->svc->up_ip, &ua.sin_addr);
+    if (us >= 0) set_nonblock(us, true);
+    if (us < 0 || (connect(us, (struct sockaddr *)&ua, sizeof(ua)) != 0 &&
+                   errno != EINPROGRESS)) {
+        ESP_LOGE(TAG, "[%s] %s: cannot reach %s:%u errno=%d", label,
+                 l->svc->name, l->svc->up_ip, l->svc->up_port, errno);
+        if (us >= 0) close(us);
+        close(cs);
+        conn_release(c);
+        conn_release(u);
+        return;
+    }
+
+    uint32_t now = now_ms();
+    c->fd = cs;         c->is_client = true;  c->svc = l->svc; c->peer = u;
+    c->since_ms = now;  c->last_rx_ms = now;
+    u->fd = us;         u->is_client = false; u->svc = l->svc; u->peer = c;
+    u->state = NC_CONNECTING;
+    u->since_ms = now;  u->last_rx_ms = now;
+    strncpy(c->label, label, sizeof(c->label) - 1);
+    strncpy(u->label, label, sizeof(u->label) - 1);
+    ESP_LOGI(TAG, "[%s] %s: client fd=%d, connecting %s:%u fd=%d",
+             label, l->svc->name, cs, l->svc->up_ip, l->svc->up_port, us);
+}
+
+// Shared mode: (re)open the listener's persistent upstream connection
+static void upstream_connect(net_listener_t *l) {
+    const net_service_t *svc = l->svc;
+    l->up_retry_ms = now_ms() + NET_RECONNECT_MS;
+    net_conn_t *u = conn_alloc();
+    if (!u) return;
+    int us = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in ua = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(svc->up_port),
+    };
+    inet_pton(AF_INET, svc->up_ip, &ua.sin_addr);
+    if (us >= 0) set_nonblock(us, true);
+    if (us < 0 || (connect(us, (struct sockaddr *)&ua, sizeof(ua)) != 0 &&
+                   errno != EINPROGRESS)) {
+        ESP_LOGE(TAG, "%s: cannot reach %s:%u errno=%d", svc->name,
+                 svc->up_ip, svc->up_port, errno);
+        if (us >= 0) close(us);
+        conn_release(u);
+        return;
+    }
+    u->fd = us;  u->is_client = false;  u->svc = svc;
+    u->state = NC_CONNECTING;
+    u->since_ms = now_ms();  u->last_rx_ms = u->since_ms;
+    snprintf(u->label, sizeof(u->label), "%s:%u", svc->up_ip, svc->up_port);
+    l->up = u;
+}
+
+// Upstream writable (or failed): finish the connect and open the pair
+static void conn_connected(net_conn_t *u) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(u->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err) {
+        ESP_LOGE(TAG, "[%s] %s: connect %s:%u failed err=%d", u->label,
+                 u->svc->name, u->svc->up_ip, u->svc->up_port, err);
+        conn_close(u, "connect failed");
+        return;
+    }
+    if (u->svc->shared_upstream) {
+        int one = 1;
+        setsockopt(u->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        u->state      = NC_OPEN;
+        u->last_rx_ms = now_ms();
+        ESP_LOGI(TAG, "%s: upstream %s connected fd=%d", u->svc->name,
+                 u->label, u->fd);
+        return;
+    }
+    // Both sides non-blocking; Nagle off so frames are forwarded immediately
+    int one = 1;
+    net_conn_t *pair[2] = {u, u->peer};
+    for (int i = 0; i < 2; i++) {
+        set_nonblock(pair[i]->fd, true);
+        setsockopt(pair[i]->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        pair[i]->state = NC_OPEN;
+        pair[i]->last_rx_ms = now_ms();
+    }
+    ESP_LOGI(TAG, "[%s] %s: relaying client fd=%d ↔ %s:%u fd=%d", u->label,
+             u->svc->name, u->peer->fd, u->svc->up_ip, u->svc->up_port, u->fd);
+}
+
+// Relay pairs: only called with at least NET_RX_MIN free in the peer's
+// ring. Shared mode: frames go to the service, nothing is forwarded.
+static void conn_readable(net_conn_t *c) {
+    net_conn_t *dst = c->peer;
+    size_t room = dst ? oq_free(dst) : sizeof(s_rx);
+    if (room > sizeof(s_rx)) room = sizeof(s_rx);
+    int n = recv(c->fd, s_rx, room, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    if (n <= 0) {
+        // Peer still has our bytes queued: stop reading, close once flushed
+        if (n == 0 && dst && dst->oq_len) { c->eof = true; return; }
+        conn_close(c, c->is_client ? "client closed" : "upstream closed");
+        return;
+    }
+    c->bytes_in  += n;
+    c->last_rx_ms = now_ms();
+    conn_feed_frames(c, s_rx, n);
+    if (!dst) return;
+    oq_push(dst, s_rx, n);
+    if (!conn_flush(dst))
+        pair_close(c, c->is_client ? "send to upstream failed" : "send to client failed");
+}
+
+static void conn_writable(net_conn_t *c) {
+    if (!conn_flush(c)) {
+        conn_close(c, c->is_client ? "send to client failed" : "send to upstream failed");
+        return;
+    }
+    if (c->oq_len == 0 && c->peer && c->peer->eof)
+        pair_close(c, c->is_client ? "upstream closed" : "client closed");
+}
+
+// Read the source only while its destination can take more; count the
+// pauses. A shared-mode client is gated on its own ring (its replies), the
+// shared upstream is always read.
+static bool conn_want_read(net_conn_t *c, uint32_t now) {
+    if (c->eof) return false;
+    if (c->svc->shared_upstream && !c->is_client) return true;
+    net_conn_t *dst = c->peer ? c->peer : c;
+    if (oq_free(dst) >= NET_RX_MIN) {
+        stall_end(c, now);
+        return true;
+    }
+    if (!c->stall_since_ms) {
+        c->stall_since_ms = now ? now : 1;
+        c->stalls++;
+        s_stalls_total++;
+        ESP_LOGD(TAG, "[%s] %s: %s stalled, %u bytes queued", c->label,
+                 c->svc->name, c->is_client ? "client" : "upstream",
+                 (unsigned)dst->oq_len);
+    }
+    return false;
+}
+
+// ── Loop task ─────────────────────────────────────────────────
+static void netloop_task(void *arg) {
+    ESP_LOGI(TAG, "Net loop on core %d, pool=%d connections",
+             xPortGetCoreID(), NET_MAX_CONNS);
+    while (1) {
+        fd_set rfds, wfds;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        int maxfd = -1;
+        int nlsn = __atomic_load_n(&s_nlsn, __ATOMIC_ACQUIRE);
+        uint32_t now = now_ms();
+
+        for (int i = 0; i < nlsn; i++) {
+            FD_SET(s_lsn[i].fd, &rfds);
+            if (s_lsn[i].fd > maxfd) maxfd = s_lsn[i].fd;
+        }
+        for (int i = 0; i < NET_MAX_CONNS; i++) {
+            net_conn_t *c = &s_conns[i];
+            if (c->state == NC_OPEN) {
+                if (conn_want_read(c, now)) FD_SET(c->fd, &rfds);
+                if (c->oq_len)              FD_SET(c->fd, &wfds);
+            } else if (c->state == NC_CONNECTING) {
+                FD_SET(c->fd, &wfds);
+            } else continue;
+            if (c->fd > maxfd) maxfd = c->fd;
+        }
+
+        struct timeval tv = { .tv_sec  = s_any_shared ? 0 : 1,
+                              .tv_usec = s_any_shared ? NET_TICK_MS * 1000 : 0 };
+        int r = select(maxfd + 1, &rfds, &wfds, NULL, &tv);
+        if (r < 0) {
+            ESP_LOGE(TAG, "select err %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        for (int i = 0; i < nlsn; i++)
+            if (FD_ISSET(s_lsn[i].fd, &rfds)) listener_accept(&s_lsn[i]);
+
+        for (int i = 0; i < NET_MAX_CONNS; i++) {
+            net_conn_t *c = &s_conns[i];
+            if (c->state == NC_CONNECTING) {
+                if (FD_ISSET(c->fd, &wfds)) conn_connected(c);
+                continue;
+            }
+            // Either handler may close the pair (and free this slot)
+            if (c->state == NC_OPEN && FD_ISSET(c->fd, &wfds)) conn_writable(c);
+            if (c->state == NC_OPEN && FD_ISSET(c->fd, &rfds)) conn_readable(c);
+        }
+
+        // Timeouts: upstream connect, stuck output, idle clients / pairs,
+        // connections a service send overflowed
+        now = now_ms();
+        for (int i = 0; i < NET_MAX_CONNS; i++) {
+            net_conn_t *c = &s_conns[i];
+            if (c->state == NC_FREE) continue;
+            if (c->doom) {
+                conn_close(c, c->doom);
+            } else if (c->state == NC_CONNECTING) {
+                if (now - c->since_ms >= NET_CONNECT_TIMEOUT_MS)
+                    conn_close(c, "connect timeout");
+            } else if (c->state != NC_OPEN) {
+                continue;
+            } else if (c->oq_len && now - c->tx_wait_ms >= NET_SEND_TIMEOUT_MS) {
+                conn_close(c, c->is_client ? "send to client timed out"
+                                           : "send to upstream timed out");
+            } else if (c->is_client && now - c->last_rx_ms >= c->svc->idle_ms &&
+                       (!c->peer || now - c->peer->last_rx_ms >= c->svc->idle_ms)) {
+                conn_close(c, "idle");
+            }
+        }
+
+        // Shared services: reconnect the upstream, then let the service run
+        for (int i = 0; i < nlsn; i++) {
+            net_listener_t *l = &s_lsn[i];
+            if (!l->svc->shared_upstream) continue;
+            if (!l->up && (int32_t)(now - l->up_retry_ms) >= 0) upstream_connect(l);
+            if (l->svc->on_tick) l->svc->on_tick(now);
+        }
+
+        // Idle listeners: periodic "still waiting" so the log shows why
+        for (int i = 0; i < nlsn; i++) {
+            net_listener_t *l = &s_lsn[i];
+            bool active = false;
+            for (int k = 0; k < NET_MAX_CONNS && !active; k++)
+                active = s_conns[k].state != NC_FREE && s_conns[k].is_client &&
+                         s_conns[k].svc == l->svc;
+            if (active) l->last_log_ms = now;
+            else if (now - l->last_log_ms >= NET_WAIT_LOG_MS) {
+                l->last_log_ms = now;
+                ESP_LOGI(TAG, "%s: waiting for client on :%u", l->svc->name,
+                         l->svc->listen_port);
+            }
+        }
+    }
+}
+
+// ── Public API ────────────────────────────────────────────────
+// Loop task only (service callbacks)
+bool lux_net_send(net_conn_t *c, const uint8_t *buf, size_t len) {
+    if (c->state != NC_OPEN || c->doom) return false;
+    if (oq_free(c) < len) {
+        c->doom = c->is_client ? "client too slow" : "upstream too slow";
+        return false;
+    }
+    oq_push(c, buf, len);
+    if (!conn_flush(c)) {
+        c->doom = c->is_client ? "send to client failed" : "send to upstream failed";
+        return false;
+    }
+    return true;
+}
+
+net_conn_t *lux_net_upstream(const net_service_t *svc) {
+    net_listener_t *l = listener_of(svc);
+    return (l && l->up && l->up->state == NC_OPEN && !l->up->doom) ? l->up : NULL;
+}
+
+bool lux_net_add_service(const net_service_t *svc) {
+    if (s_nlsn >= NET_MAX_SERVICES) {
+        ESP_LOGE(TAG, "%s: service table full", svc->name);
+        return false;
+    }
+    int ls = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (ls < 0) { ESP_LOGE(TAG, "%s: socket err %d", svc->name, errno); return false; }
+
+    int opt = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in ba = {
+        .sin_family      = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port        = htons(svc->listen_port),
+    };
+    if (bind(ls, (struct sockaddr *)&ba, sizeof(ba)) || listen(ls, 4)) {
+        ESP_LOGE(TAG, "%s: bind/listen :%u err %d", svc->name, svc->listen_port, errno);
+        close(ls);
+        return false;
+    }
+    set_nonblock(ls, true);
+
+    net_listener_t *l = &s_lsn[s_nlsn];
+    l->svc = svc;
+    l->fd  = ls;
+    l->last_log_ms = now_ms();
+    l->up          = NULL;
+    l->up_retry_ms = now_ms();      // first connect on the next loop pass
+    if (svc->shared_upstream) s_any_shared = true;
+    __atomic_store_n(&s_nlsn, s_nlsn + 1, __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "%s: listening :%u → %s:%u", svc->name, svc->listen_port,
+             svc->up_ip, svc->up_port);
+
+    if (!s_task_started) {
+        s_task_started = true;
+        xTaskCreatePinnedToCore(netloop_task, "netloop", NET_TASK_STACK, NULL,
+                                NET_TASK_PRIO, NULL, 0);
+    }
+    return true;
+}
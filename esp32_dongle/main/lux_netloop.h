@@ -0,0 +1,56 @@
+#pragma once
+// lux_netloop.h
+// One task multiplexes every TCP listener and relay connection with
+// select(). Connections come from a fixed pool (NET_MAX_CONNS in config.h);
+// each has its own state machine and frame reassembly buffer, so there is
+// no task (and no stack) per session.
+//
+// A service is a listen port plus an upstream address: every accepted
+// client gets its own upstream connection and bytes are relayed both ways
+// unchanged. Complete A1 1A frames are reported to the service on the way.
+//
+// A shared-upstream service instead keeps ONE persistent upstream connection
+// for all of its clients (for peers that accept a single TCP client, like
+// the real dongle). Nothing is relayed: the service gets every frame from
+// either side and routes replies itself with lux_net_send().
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct net_conn net_conn_t;
+
+typedef struct {
+    const char *name;
+    uint16_t    listen_port;
+    const char *up_ip;          // IPv4 literal
+    uint16_t    up_port;
+    uint32_t    idle_ms;        // close the pair after this long without traffic
+    bool        shared_upstream;
+    // Called for each complete frame; `from_client` = accepted side
+    void (*on_frame)(net_conn_t *c, bool from_client,
+                     const uint8_t *frame, size_t len);
+    // Shared mode only: a client or the upstream is about to be closed
+    void (*on_close)(net_conn_t *c, bool is_client);
+    // Shared mode only: every loop pass (at most 250 ms apart)
+    void (*on_tick)(uint32_t now_ms);
+} net_service_t;
+
+/**
+ * Register a service: binds and listens on svc->listen_port immediately
+ * and starts the loop task on first use. `svc` must stay valid forever.
+ * Returns false if the port cannot be bound or the service table is full.
+ */
+bool lux_net_add_service(const net_service_t *svc);
+
+/**
+ * Queue bytes to a connection (callbacks only — runs on the loop task).
+ * Returns false if the connection is not open or its output ring cannot
+ * take `len` more bytes; the connection is then closed on the next pass.
+ */
+bool lux_net_send(net_conn_t *c, const uint8_t *buf, size_t len);
+
+// Shared upstream of `svc` if connected, else NULL
+net_conn_t *lux_net_upstream(const net_service_t *svc);
+
+// "ip:port" of the client a connection (or its upstream) belongs to
+const char *lux_net_conn_label(const net_conn_t *c);
@@ -7,12 +7,38 @@
 #include "freertos/task.h"
 #include "shared_state.h"
 #include "config.h"
+#include "lux_capture.h"
+#include <string.h>
+#ifdef RS485_MASTER_MODE
+#include "lux_rs485.h"
+#endif
 
 static const char *OTA_TAG = "ota";
 
 // ── Status page ────────────────────────────────────────────────
 static esp_err_t ota_status_handler(httpd_req_t *req) {
     const esp_app_desc_t *desc = esp_app_get_description();
+    uint16_t in[12];
+    reg_read_input(0, in, 12);
+    char rs485[160];
+#if defined(RS485_MASTER_MODE)
+    lux_rs485_timing_str(rs485, sizeof(rs485));
+#elif defined(RELAY_MODE)
+    snprintf(rs485, sizeof(rs485), "off (relay mode)");
+#else
+    snprintf(rs485, sizeof(rs485), "off (cloud mode)");
+#endif
+    char cap[256] = "off (CAPTURE_BUF_SIZE = 0)";
+#if CAPTURE_BUF_SIZE > 0
+    uint32_t cap_recs, cap_bytes, cap_lost;
+    lux_capture_stats(&cap_recs, &cap_bytes, &cap_lost);
+    snprintf(cap, sizeof(cap),
+        "%u frames, %u B (%u overwritten) "
+        "<a href='/capture' style='color:#0f0'>download</a> "
+        "<form method='POST' action='/capture/clear' style='display:inline'>"
+        "<input type='submit' value='clear'></form>",
+        (unsigned)cap_recs, (unsigned)cap_bytes, (unsigned)cap_lost);
+#endif
     char buf[2048];
     snprintf(buf, sizeof(buf),
         "<!DOCTYPE html><html><head>"
@@ -36,6 +62,8 @@ static esp_err_t ota_status_handler(httpd_req_t *req) {
         "<tr><td>PV total</td><td>%u W</td></tr>"
         "<tr><td>Charge</td><td>%u W</td></tr>"
         "<tr><td>Discharge</td><td>%u W</td></tr>"
+        "<tr><td>RS485</td><td>%s</td></tr>"
+        "<tr><td>Capture</td><td>%s</td></tr>"
         "</table>"
         "<h3>OTA Firmware Update</h3>"
         "<form method='POST' action='/ota' enctype='multipart/form-data'>"
@@ -48,17 +76,49 @@ static esp_err_t ota_status_handler(httpd_req_t *req) {
         DONGLE_SN, INVERTER_SN,
         g_regs.input_valid ? "YES" : "no",
         g_regs.hold_valid  ? "YES" : "no",
-        g_regs.input[4] * 0.1f,          // vbat
-        g_regs.input[5] & 0xFF,          // soc
-        g_regs.input[7] + g_regs.input[8], // ppv1+ppv2
-        g_regs.input[10],                // p_charge
-        g_regs.input[11]                 // p_discharge
+        in[4] * 0.1f,                    // vbat
+        in[5] & 0xFF,                    // soc
+        in[7] + in[8],                   // ppv1+ppv2
+        in[10],                          // p_charge
+        in[11],                          // p_discharge
+        rs485,
+        cap
     );
     httpd_resp_set_type(req, "text/html");
     httpd_resp_sendstr(req, buf);
     return ESP_OK;
 }
 
+// ── Frame capture download ─────────────────────────────────────
+// GET /capture streams the ring as a .cap file (lux_capture.h format) for
+// tools/sim/lux_replay.cpp; POST /capture/clear empties it (not a GET, so a
+// prefetch or crawler can't wipe a capture).
+static esp_err_t capture_clear_handler(httpd_req_t *req) {
+    lux_capture_clear();
+    httpd_resp_set_status(req, "303 See Other");
+    httpd_resp_set_hdr(req, "Location", "/");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+static esp_err_t capture_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition",
+                       "attachment; filename=\"luxdongle.cap\"");
+    if (httpd_resp_send_chunk(req, LUX_CAP_MAGIC, LUX_CAP_MAGIC_LEN) != ESP_OK)
+        return ESP_FAIL;
+
+    // Snapshot the end so a busy relay can't keep the download going forever
+    uint8_t  chunk[LUX_CAP_REC_HDR + LUX_CAP_MAX_FRAME];
+    uint32_t end;
+    uint32_t pos = lux_capture_begin(&end);
+    size_t   n;
+    while ((n = lux_capture_read(&pos, end, chunk, sizeof(chunk))) > 0) {
+        if (httpd_resp_send_chunk(req, (const char *)chunk, n) != ESP_OK)
+            return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 // ── OTA upload handler ─────────────────────────────────────────
 static esp_err_t ota_upload_handler(httpd_req_t *req) {
     const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
@@ -124,6 +184,8 @@ static void lux_ota_start(void) {
     httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
     cfg.server_port      = OTA_PORT;
     cfg.max_uri_handlers = 4;
+    cfg.max_open_sockets = OTA_HTTPD_SESSIONS;   // counted in LWIP_SOCKET_BUDGET
+    cfg.lru_purge_enable = true;
     cfg.recv_wait_timeout  = 30;
     cfg.send_wait_timeout  = 30;
 
@@ -139,8 +201,17 @@ static void lux_ota_start(void) {
     httpd_uri_t upload = {
         .uri = "/ota", .method = HTTP_POST, .handler = ota_upload_handler, .user_ctx = NULL
     };
+    httpd_uri_t capture = {
+        .uri = "/capture", .method = HTTP_GET, .handler = capture_handler, .user_ctx = NULL
+    };
+    httpd_uri_t capture_clear = {
+        .uri = "/capture/clear", .method = HTTP_POST, .handler = capture_clear_handler,
+        .user_ctx = NULL
+    };
     httpd_register_uri_handler(server, &status);
     httpd_register_uri_handler(server, &upload);
+    httpd_register_uri_handler(server, &capture);
+    httpd_register_uri_handler(server, &capture_clear);
 
     ESP_LOGI(OTA_TAG, "OTA server ready → http://luxdongle.local:%d", OTA_PORT);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include "config.h"
+#include "lux_crc.h"   // shared with components/luxpower_sna
 
 // ── Magic / function bytes ────────────────────────────────────
 #define LUX_MAGIC_0          0xA1
@@ -21,17 +22,6 @@
 #define DIR_DONGLE_TO_SERVER  0x0002   // 02 00
 #define DIR_DONGLE_RESP       0x0005   // 05 00
 
-// ── CRC-16/Modbus ─────────────────────────────────────────────
-static inline uint16_t lux_crc16(const uint8_t *d, size_t len) {
-    uint16_t crc = 0xFFFF;
-    while (len--) {
-        crc ^= *d++;
-        for (int i = 0; i < 8; i++)
-            crc = (crc >> 1) ^ (crc & 1 ? 0xA001 : 0);
-    }
-    return crc;
-}
-
 // ── Build outer header (20 bytes) ────────────────────────────
 static inline void lux_build_hdr(uint8_t *buf, uint16_t dir,
                                   uint16_t data_len, uint8_t seq) {
@@ -193,6 +183,96 @@ static inline lux_parsed_t lux_parse(const uint8_t *buf, size_t len) {
     return p;
 }
 
+// ── Stream → whole A1 1A frames ──────────────────────────────
+// Appends `n` bytes of a TCP stream to `fb` (`*fb_len` used, `cap` size)
+// and calls `emit` for every complete frame, in order. Bytes before a magic
+// are skipped; a magic whose length field exceeds `cap` is skipped too, so
+// the stream resyncs on the next one. Any burst size is accepted.
+// Used by lux_netloop.c; tools/bench/bench_parsers.cpp fuzzes it.
+typedef void (*lux_frame_cb_t)(void *ctx, const uint8_t *frame, size_t len);
+
+static inline void lux_frame_feed(uint8_t *fb, size_t *fb_len, size_t cap,
+                                  const uint8_t *data, size_t n,
+                                  lux_frame_cb_t emit, void *ctx) {
+    while (n) {
+        // Top up the buffer; a burst larger than the free room is taken in
+        // several passes so no buffered partial frame is ever dropped
+        size_t take = cap - *fb_len;
+        if (take > n) take = n;
+        memcpy(fb + *fb_len, data, take);
+        data += take;
+        n    -= take;
+        size_t len = *fb_len + take;
+        size_t pos = 0;
+
+        while (len - pos >= 6) {
+            const uint8_t *p = fb + pos;
+
+            // Resync to magic bytes
+            if (p[0] != LUX_MAGIC_0 || p[1] != LUX_MAGIC_1) {
+                size_t i;
+                for (i = 1; i + 1 < len - pos; i++)
+                    if (p[i] == LUX_MAGIC_0 && p[i+1] == LUX_MAGIC_1) break;
+                pos += i;
+                continue;
+            }
+
+            size_t total = (size_t)(p[4] | ((uint16_t)p[5] << 8)) + 6;
+            if (total > cap) { pos += 2; continue; }   // drop this magic only
+            if (len - pos < total) break;
+
+            emit(ctx, p, total);
+            pos += total;
+        }
+        // One move per pass, not per frame
+        if (pos) memmove(fb, fb + pos, len - pos);
+        *fb_len = len - pos;
+    }
+}
+
+// ── Register data from a READ_INPUT / READ_HOLD response ─────
+// df: [action][fn][inv_sn(10)][start_reg(2)][byte_count][data LE...][crc(2)]
+// Returns the number of registers copied to `regs` (0 = not a data reply).
+static inline uint16_t lux_resp_regs(const lux_parsed_t *p, uint16_t *start,
+                                     uint16_t *regs, uint16_t max) {
+    if (!p->df || p->df_len < 17) return 0;
+    if (p->dev_fn != LUX_FN_READ_INPUT && p->dev_fn != LUX_FN_READ_HOLD) return 0;
+    uint8_t byte_count = p->df[14];
+    if (p->df_len < (size_t)(15 + byte_count + 2)) return 0;
+    uint16_t count = byte_count / 2;
+    if (count > max) count = max;
+    const uint8_t *raw = p->df + 15;
+    for (uint16_t i = 0; i < count; i++)
+        regs[i] = (uint16_t)raw[i*2] | ((uint16_t)raw[i*2+1] << 8);
+    *start = p->reg;
+    return count;
+}
+
+// ── READ_INPUT / READ_HOLD response (37 + 2*count bytes) ─────
+// Same layout the dongle answers with; `count` <= LUX_RESP_MAX_REGS
+// (byte_count is one byte). `inverter` = 10-byte SN from the request.
+#define LUX_RESP_MAX_REGS    127
+static inline int lux_build_read_resp(uint8_t *buf, uint8_t fn,
+                                      const uint8_t *inverter,
+                                      uint16_t start, const uint16_t *regs,
+                                      uint16_t count, uint8_t seq) {
+    uint16_t data_len = 15 + count * 2 + 2;
+    lux_build_hdr(buf, DIR_DONGLE_TO_SERVER, data_len, seq);
+    uint8_t *df = buf + 20;
+    df[0] = LUX_ACTION_W;
+    df[1] = fn;
+    memcpy(df + 2, inverter, 10);
+    df[12] = start & 0xFF;  df[13] = (start >> 8) & 0xFF;
+    df[14] = (uint8_t)(count * 2);
+    for (uint16_t i = 0; i < count; i++) {
+        df[15 + i*2] = regs[i] & 0xFF;
+        df[16 + i*2] = (regs[i] >> 8) & 0xFF;
+    }
+    uint16_t crc = lux_crc16(df, data_len - 2);
+    df[data_len - 2] = crc & 0xFF;  df[data_len - 1] = (crc >> 8) & 0xFF;
+    return 20 + data_len;
+}
+
 // ── Cloud write filter ────────────────────────────────────────
 static inline bool lux_cloud_write_allowed(uint16_t reg) {
     for (int i = 0; i < (int)CLOUD_WHITELIST_LEN; i++)
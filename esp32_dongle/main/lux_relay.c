@@ -5,27 +5,24 @@
 // → lux_mqtt_task picks up & publishes to HA automatically
 
 #include "lux_relay.h"
+#include "lux_netloop.h"
 #include "lux_proto.h"
+#include "lux_capture.h"
 #include "shared_state.h"
 #include "config.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
-#include "lwip/sockets.h"
-#include "lwip/netdb.h"
+#include <stdio.h>
 #include <string.h>
-#include <errno.h>
 
 static const char *TAG = "lux_relay";
 
 #define RELAY_LISTEN_PORT   LUX_CLOUD_PORT
 #define CLOUD_HOST          LUX_CLOUD_HOST
 #define CLOUD_PORT          LUX_CLOUD_PORT
-#define BUF_SIZE            1024
-#define RELAY_CONN_STACK    5120
-#define RELAY_SRV_STACK     3072
-#define RELAY_TASK_PRIO     5
+#define RELAY_IDLE_MS       90000
 
 // ── Hex dump (debug) ──────────────────────────────────────────
 static void hex_dump(const char *label, const uint8_t *buf, int len) {
@@ -87,211 +84,32 @@ static void relay_process_dongle_frame(const uint8_t *buf, size_t total) {
     }
 }
 
-// ── Frame callbacks ───────────────────────────────────────────
-// Dongle → Server: RESP frames with actual register data → parse!
-static void on_dongle_frame(const uint8_t *buf, size_t len) {
+// ── Frame callback ────────────────────────────────────────────
+// Dongle → Server: RESP frames with actual register data
+static void relay_on_frame(net_conn_t *c, bool from_dongle,
+                           const uint8_t *buf, size_t len) {
+    lux_capture_frame(from_dongle ? LUX_CAP_DONGLE_TO_CLOUD
+                                  : LUX_CAP_CLOUD_TO_DONGLE, buf, len);
     char hex[52] = {};
     int n = len > 16 ? 16 : (int)len;
     for (int i = 0; i < n; i++) sprintf(hex + i*3, "%02X ", buf[i]);
-    ESP_LOGI(TAG, "D→C %3uB  %s%s", (unsigned)len, hex, len>16?"...":"");
+    ESP_LOGI(TAG, "%s %3uB  %s%s", from_dongle ? "D→C" : "C→D",
+             (unsigned)len, hex, len>16?"...":"");
 }
 
-static void on_cloud_frame(const uint8_t *buf, size_t len) {
-    char hex[52] = {};
-    int n = len > 16 ? 16 : (int)len;
-    for (int i = 0; i < n; i++) sprintf(hex + i*3, "%02X ", buf[i]);
-    ESP_LOGI(TAG, "C→D %3uB  %s%s", (unsigned)len, hex, len>16?"...":"");
-}
-// ── Reassemble TCP stream into complete frames ────────────────
-typedef struct {
-    uint8_t buf[BUF_SIZE];
-    size_t  len;
-} frame_buf_t;
-
-static void frame_buf_push(frame_buf_t *fb, const uint8_t *data, int n,
-                            void (*on_frame)(const uint8_t *, size_t)) {
-    if (fb->len + n > BUF_SIZE) { fb->len = 0; }
-    memcpy(fb->buf + fb->len, data, n);
-    fb->len += n;
-
-    while (fb->len >= 6) {
-        uint8_t *p = fb->buf;
-
-        // Resync to magic bytes
-        if (p[0] != LUX_MAGIC_0 || p[1] != LUX_MAGIC_1) {
-            size_t i;
-            for (i = 1; i + 1 < fb->len; i++)
-                if (p[i] == LUX_MAGIC_0 && p[i+1] == LUX_MAGIC_1) break;
-            memmove(fb->buf, fb->buf + i, fb->len - i);
-            fb->len -= i;
-            continue;
-        }
-
-        uint16_t fl    = p[4] | ((uint16_t)p[5] << 8);
-        size_t   total = (size_t)fl + 6;
-        if (total > BUF_SIZE) { fb->len = 0; break; }
-        if (fb->len < total)  break;
-
-        on_frame(p, total);
-        memmove(fb->buf, fb->buf + total, fb->len - total);
-        fb->len -= total;
-    }
-}
-
-// ── Per-connection relay task ──────────────────────────────────
-typedef struct { int dongle_sock; } relay_conn_arg_t;
-
-static void relay_conn_task(void *arg) {
-    relay_conn_arg_t *ctx = (relay_conn_arg_t *)arg;
-    int ds = ctx->dongle_sock;
-    free(ctx);
-
-    // ── Connect to cloud ──────────────────────────────────────
-    struct sockaddr_in addr = {
-        .sin_family = AF_INET,
-        .sin_port   = htons(CLOUD_PORT),
-    };
-    inet_pton(AF_INET, CLOUD_HOST, &addr.sin_addr);
-
-    int cs = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (cs < 0) {
-        ESP_LOGE(TAG, "socket failed errno=%d", errno);
-        close(ds);
-        vTaskDelete(NULL);
-        return;
-    }
-
-    // Connect timeout 15s
-    struct timeval ctv = { .tv_sec = 15 };
-    setsockopt(cs, SOL_SOCKET, SO_SNDTIMEO, &ctv, sizeof(ctv));
-    setsockopt(cs, SOL_SOCKET, SO_RCVTIMEO, &ctv, sizeof(ctv));
-
-    if (connect(cs, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
-        ESP_LOGE(TAG, "Cannot reach cloud %s:%d errno=%d",
-                 CLOUD_HOST, CLOUD_PORT, errno);
-        close(cs);
-        close(ds);
-        vTaskDelete(NULL);
-        return;
-    }
-
-    // Clear timeout after connect — relay runs indefinitely
-    ctv.tv_sec = 0; ctv.tv_usec = 0;
-    setsockopt(cs, SOL_SOCKET, SO_SNDTIMEO, &ctv, sizeof(ctv));
-    setsockopt(cs, SOL_SOCKET, SO_RCVTIMEO, &ctv, sizeof(ctv));
-
-    // Disable Nagle on both sockets — forward bytes immediately, no buffering
-    int one = 1;
-    setsockopt(ds, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
-    setsockopt(cs, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+// ── Service ───────────────────────────────────────────────────
+// Sessions run in the shared select() loop (lux_netloop.c)
+static const net_service_t RELAY_SERVICE = {
+    .name        = "relay",
+    .listen_port = RELAY_LISTEN_PORT,
+    .up_ip       = CLOUD_HOST,
+    .up_port     = CLOUD_PORT,
+    .idle_ms     = RELAY_IDLE_MS,
+    .on_frame    = relay_on_frame,
+};
 
-    ESP_LOGI(TAG, "Relay: dongle fd=%d ↔ cloud fd=%d", ds, cs);
-
-    // ── Bidirectional relay via select ────────────────────────
-    uint8_t *buf  = (uint8_t *)malloc(BUF_SIZE);
-    if (!buf) {
-        ESP_LOGE(TAG, "malloc fail");
-        close(cs); close(ds);
-        vTaskDelete(NULL);
-        return;
-    }
-
-    frame_buf_t fb_d2s = {}, fb_s2d = {};
-    int maxfd = (ds > cs ? ds : cs) + 1;
-
-    while (1) {
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(ds, &rfds);
-        FD_SET(cs, &rfds);
-        struct timeval tv = { .tv_sec = 90 };
-
-        int r = select(maxfd, &rfds, NULL, NULL, &tv);
-        if (r < 0)  { ESP_LOGE(TAG, "select err %d", errno); break; }
-        if (r == 0) { ESP_LOGW(TAG, "Relay idle 90s — closing"); break; }
-
-        // Dongle → Cloud
-        if (FD_ISSET(ds, &rfds)) {
-            int n = recv(ds, buf, BUF_SIZE, 0);
-            if (n <= 0) { ESP_LOGI(TAG, "Dongle disconnected (n=%d)", n); break; }
-            frame_buf_push(&fb_d2s, buf, n, on_dongle_frame);
-            if (send(cs, buf, n, 0) < 0) { ESP_LOGE(TAG, "→cloud send err"); break; }
-        }
-
-        // Cloud → Dongle
-        if (FD_ISSET(cs, &rfds)) {
-            int n = recv(cs, buf, BUF_SIZE, 0);
-            if (n <= 0) { ESP_LOGI(TAG, "Cloud disconnected (n=%d)", n); break; }
-            frame_buf_push(&fb_s2d, buf, n, on_cloud_frame);
-            if (send(ds, buf, n, 0) < 0) { ESP_LOGE(TAG, "→dongle send err"); break; }
-        }
-    }
-
-    free(buf);
-    close(ds);
-    close(cs);
-    ESP_LOGI(TAG, "Relay connection closed");
-    vTaskDelete(NULL);
-}
-// ── Accept loop ────────────────────────────────────────────────
-static void relay_server_task(void *arg) {
-    int ls = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (ls < 0) { ESP_LOGE(TAG, "socket: %d", errno); vTaskDelete(NULL); return; }
-
-    int opt = 1;
-    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
-    struct sockaddr_in ba = {
-        .sin_family      = AF_INET,
-        .sin_addr.s_addr = INADDR_ANY,
-        .sin_port        = htons(RELAY_LISTEN_PORT),
-    };
-    if (bind(ls, (struct sockaddr *)&ba, sizeof(ba)) ||
-        listen(ls, 2)) {
-        ESP_LOGE(TAG, "bind/listen: %d", errno);
-        close(ls); vTaskDelete(NULL); return;
-    }
-    ESP_LOGI(TAG, "Relay listening :%d → %s:%d",
-             RELAY_LISTEN_PORT, CLOUD_HOST, CLOUD_PORT);
-
-    // Set accept timeout so we can log "still waiting" periodically
-    struct timeval tv = { .tv_sec = 15 };
-    setsockopt(ls, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-
-    uint32_t wait_count = 0;
-    while (1) {
-        struct sockaddr_in ca; socklen_t cl = sizeof(ca);
-        int cs = accept(ls, (struct sockaddr *)&ca, &cl);
-
-        if (cs < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Timeout — log heartbeat every 15s
-                ESP_LOGI(TAG, "Waiting for dongle... (%lus)  point dongle → 192.168.100.21:4346",
-                         (unsigned long)(++wait_count * 15));
-            } else {
-                ESP_LOGE(TAG, "accept err %d", errno);
-            }
-            continue;
-        }
-
-        char ip[16];
-        inet_ntop(AF_INET, &ca.sin_addr, ip, sizeof(ip));
-        ESP_LOGI(TAG, "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
-        ESP_LOGI(TAG, "Dongle connected from %s:%d  fd=%d",
-                 ip, ntohs(ca.sin_port), cs);
-
-        relay_conn_arg_t *a = malloc(sizeof(relay_conn_arg_t));
-        if (!a) { close(cs); continue; }
-        a->dongle_sock = cs;
-        xTaskCreate(relay_conn_task, "relay_conn",
-                    RELAY_CONN_STACK, a, RELAY_TASK_PRIO, NULL);
-    }
-}
-
-// ── Public API ─────────────────────────────────────────────────
 void lux_relay_start(void) {
-    xTaskCreatePinnedToCore(relay_server_task, "relay_srv",
-                            RELAY_SRV_STACK, NULL,
-                            RELAY_TASK_PRIO, NULL, 0);
-    ESP_LOGI(TAG, "Relay task started — point real dongle here");
-}
\ No newline at end of file
+    if (lux_net_add_service(&RELAY_SERVICE))
+        ESP_LOGI(TAG, "Relay :%d → %s:%d — point real dongle here",
+                 RELAY_LISTEN_PORT, CLOUD_HOST, CLOUD_PORT);
+}
@@ -1,13 +1,21 @@
 #include "lux_rs485.h"
 #include "config.h"
+#include "lux_crc.h"
 
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "nvs.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 
 #include <string.h>
+#include <stdio.h>
+
+// Only RS485 master builds use the bus; otherwise this unit is empty
+#ifdef RS485_MASTER_MODE
 
 static const char *TAG = "rs485";
 
@@ -16,24 +24,58 @@ static const char *TAG = "rs485";
 // = addr(1)+fn(1)+bc(1)+data(250)+crc(2) = 255 bytes
 #define RX_BUF 300
 
-// Inter-character timeout at 19200 baud:
-//   1 char ≈ 0.52 ms → 3.5-char gap ≈ 1.8 ms → use 5 ms to be safe
-#define INTERCHAR_MS 5
-
-// Maximum total wait for a response
-#define RESP_TIMEOUT_MS 350
+// ── RX timing ─────────────────────────────────────────────────
+// Receive is event driven: the UART's RX-timeout interrupt fires once the
+// line has been idle for RX_TOUT_SYMBOLS character times (>= the Modbus
+// 3.5-char gap) and posts UART_DATA with timeout_flag set — end of frame.
+// A transaction completes as soon as the last byte is in, not on a poll
+// slice boundary.
+//
+// The deadline for a reply scales with baud rate and expected length:
+//   turnaround budget (per function code) + reply wire time × 1.5
+// so a 125-register read at a low baud rate still gets enough time.
+// Budgets start at TURNAROUND_MS and are tightened by lux_rs485_calibrate()
+// to 2 × the worst measured turnaround + TURNAROUND_MARGIN_US.
+#define RX_TOUT_SYMBOLS       4
+#define CHAR_BITS             10      // 8N1
+#define TURNAROUND_MS         250
+#define TURNAROUND_MARGIN_US  20000
+#define UART_EVT_QUEUE        16
 
 static SemaphoreHandle_t s_mutex = NULL;
+static QueueHandle_t     s_uart_q = NULL;
+static uint32_t          s_line_errs = 0;   // framing / parity events
+
+static rs485_timing_t    s_timing;
+static uint32_t          s_seen_us[RS485_SLOTS];   // worst turnaround since boot
+static uint32_t          s_last_turn_us;           // of the last good reply
+static int64_t           s_bus_idle_us;            // when the bus last went idle
+
+static uint32_t char_us(void) {
+    return CHAR_BITS * 1000000u / s_timing.baud;
+}
+
+static int fn_slot(uint8_t fn) {
+    if (fn == 0x03) return RS485_SLOT_HOLD;
+    if (fn == 0x04) return RS485_SLOT_INPUT;
+    return RS485_SLOT_WRITE;
+}
 
-// ── CRC-16 Modbus (poly 0xA001, init 0xFFFF) ──────────────────
-static uint16_t mb_crc(const uint8_t *d, size_t n) {
-    uint16_t crc = 0xFFFF;
-    while (n--) {
-        crc ^= *d++;
-        for (int i = 0; i < 8; i++)
-            crc = (crc >> 1) ^ (crc & 1 ? 0xA001 : 0);
+static uint32_t resp_timeout_ms(int slot, size_t resp_len) {
+    uint32_t wire_us = (uint32_t)(resp_len + RX_TOUT_SYMBOLS) * char_us() * 3 / 2;
+    return (s_timing.turnaround_us[slot] + wire_us + 999) / 1000;
+}
+
+// Enforce the inter-frame gap since the previous reply (or timeout). Whole
+// ticks sleep; the sub-tick remainder is a short busy wait.
+static void bus_wait_idle(void) {
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    int64_t left = s_bus_idle_us + s_timing.gap_us - esp_timer_get_time();
+    if (left >= tick_us) {
+        vTaskDelay(left / tick_us);
+        left = s_bus_idle_us + s_timing.gap_us - esp_timer_get_time();
     }
-    return crc;
+    if (left > 0) esp_rom_delay_us((uint32_t)left);
 }
 
 // ── Determine expected response length from partially-received data ──
@@ -54,10 +96,18 @@ static size_t expected_len(const uint8_t *buf, size_t have) {
 }
 
 // ── Low-level send + receive ───────────────────────────────────
-static rs485_err_t mb_transact(const uint8_t *req, size_t req_len,
+// `resp_len` = length of a normal (non-exception) reply, sizes the deadline
+static rs485_err_t mb_transact(const uint8_t *req, size_t req_len, size_t resp_len,
                                 uint8_t *resp, size_t *out_len) {
-    // Flush stale RX bytes (e.g. from a previous timeout)
-    uart_flush_input(MODBUS_UART_NUM);
+    // Bytes left over from a previous timeout would be parsed as our reply
+    size_t stale = 0;
+    uart_get_buffered_data_len(MODBUS_UART_NUM, &stale);
+    if (stale) {
+        ESP_LOGW(TAG, "Dropping %u stale RX bytes", (unsigned)stale);
+        uart_flush_input(MODBUS_UART_NUM);
+    }
+    xQueueReset(s_uart_q);
+    bus_wait_idle();
 
     // Transmit
     int sent = uart_write_bytes(MODBUS_UART_NUM, req, req_len);
@@ -71,37 +121,63 @@ static rs485_err_t mb_transact(const uint8_t *req, size_t req_len,
         return RS485_ERR_TIMEOUT;
     }
 
-    // Receive loop
+    // Receive: block on UART events until the frame is complete by length
+    // or the line goes idle after some data
+    int64_t t_tx     = esp_timer_get_time();
+    int     slot     = fn_slot(req[1]);
     uint8_t buf[RX_BUF];
     size_t  total    = 0;
-    TickType_t end   = xTaskGetTickCount() + pdMS_TO_TICKS(RESP_TIMEOUT_MS);
-
-    while (xTaskGetTickCount() < end && total < sizeof(buf)) {
-        TickType_t left = end - xTaskGetTickCount();
-        TickType_t wait = left < pdMS_TO_TICKS(INTERCHAR_MS)
-                          ? left : pdMS_TO_TICKS(INTERCHAR_MS);
-
-        int n = uart_read_bytes(MODBUS_UART_NUM,
-                                buf + total, sizeof(buf) - total, wait);
-        if (n > 0) total += n;
-
-        // Early exit once we have a complete frame
-        size_t exp = expected_len(buf, total);
-        if (exp && total >= exp) break;
+    uint32_t tmo_ms  = resp_timeout_ms(slot, resp_len);
+    TickType_t end   = xTaskGetTickCount() + pdMS_TO_TICKS(tmo_ms);
+    bool    done     = false;
+
+    while (!done && total < sizeof(buf)) {
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(end - now) <= 0) break;
+        uart_event_t ev;
+        if (xQueueReceive(s_uart_q, &ev, end - now) != pdTRUE) break;
+
+        switch (ev.type) {
+            case UART_DATA: {
+                size_t room = sizeof(buf) - total;
+                int n = uart_read_bytes(MODBUS_UART_NUM, buf + total,
+                                        ev.size < room ? ev.size : room, 0);
+                if (n > 0) total += n;
+                size_t exp = expected_len(buf, total);
+                done = (exp && total >= exp) || (ev.timeout_flag && total);
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                ESP_LOGW(TAG, "RX overflow");
+                uart_flush_input(MODBUS_UART_NUM);
+                xQueueReset(s_uart_q);
+                s_bus_idle_us = esp_timer_get_time();
+                return RS485_ERR_FRAME;
+            case UART_FRAME_ERR:
+            case UART_PARITY_ERR:
+                s_line_errs++;          // the CRC check rejects the frame
+                break;
+            default:
+                break;
+        }
     }
 
+    s_bus_idle_us = esp_timer_get_time();
+
     if (total == 0) {
-        ESP_LOGW(TAG, "No response");
+        ESP_LOGW(TAG, "No response in %lu ms", (unsigned long)tmo_ms);
         return RS485_ERR_TIMEOUT;
     }
 
     // CRC check
     size_t exp = expected_len(buf, total);
     if (!exp || total < exp) {
-        ESP_LOGW(TAG, "Short frame: got %u expected %u", (unsigned)total, (unsigned)exp);
+        ESP_LOGW(TAG, "Short frame: got %u expected %u (line errors %lu)",
+                 (unsigned)total, (unsigned)exp, (unsigned long)s_line_errs);
         return RS485_ERR_FRAME;
     }
-    uint16_t crc_calc = mb_crc(buf, exp - 2);
+    uint16_t crc_calc = lux_crc16(buf, exp - 2);
     uint16_t crc_recv = buf[exp-2] | ((uint16_t)buf[exp-1] << 8);
     if (crc_calc != crc_recv) {
         ESP_LOGW(TAG, "CRC err: calc=0x%04X recv=0x%04X", crc_calc, crc_recv);
@@ -114,6 +190,12 @@ static rs485_err_t mb_transact(const uint8_t *req, size_t req_len,
         return RS485_ERR_EXCEPTION;
     }
 
+    // Turnaround: end of TX to first reply byte = elapsed minus the reply's
+    // wire time and the idle timeout that reported it
+    int64_t turn = (s_bus_idle_us - t_tx) - (int64_t)(exp + RX_TOUT_SYMBOLS) * char_us();
+    s_last_turn_us = turn > 0 ? (uint32_t)turn : 0;
+    if (s_last_turn_us > s_seen_us[slot]) s_seen_us[slot] = s_last_turn_us;
+
     memcpy(resp, buf, exp);
     *out_len = exp;
     return RS485_OK;
@@ -126,7 +208,7 @@ static size_t build_read_req(uint8_t *buf, uint8_t fn,
     buf[1] = fn;
     buf[2] = (start >> 8) & 0xFF;  buf[3] = start & 0xFF;
     buf[4] = (count >> 8) & 0xFF;  buf[5] = count & 0xFF;
-    uint16_t crc = mb_crc(buf, 6);
+    uint16_t crc = lux_crc16(buf, 6);
     buf[6] = crc & 0xFF;  buf[7] = (crc >> 8) & 0xFF;
     return 8;
 }
@@ -146,7 +228,18 @@ static rs485_err_t parse_read_resp(const uint8_t *resp, size_t len,
 }
 
 // ── Public: init ──────────────────────────────────────────────
+static void timing_defaults(rs485_timing_t *t, uint32_t baud) {
+    memset(t, 0, sizeof(*t));
+    t->baud = baud;
+    // Modbus: 3.5 characters, fixed 1750 us above 19200 baud
+    uint32_t c = CHAR_BITS * 1000000u / baud;
+    t->gap_us = baud > 19200 ? 1750 : c * 7 / 2;
+    for (int i = 0; i < RS485_SLOTS; i++) t->turnaround_us[i] = TURNAROUND_MS * 1000;
+    t->src = RS485_TIMING_DEFAULT;
+}
+
 void lux_rs485_init(void) {
+    timing_defaults(&s_timing, RS485_BAUD);
     uart_config_t cfg = {
         .baud_rate           = RS485_BAUD,
         .data_bits           = UART_DATA_8_BITS,
@@ -165,9 +258,10 @@ void lux_rs485_init(void) {
                                  UART_PIN_NO_CHANGE));
 
     ESP_ERROR_CHECK(uart_driver_install(MODBUS_UART_NUM,
-                                        RX_BUF * 2, 0, 0, NULL, 0));
+                                        RX_BUF * 2, 0, UART_EVT_QUEUE, &s_uart_q, 0));
     ESP_ERROR_CHECK(uart_set_mode(MODBUS_UART_NUM,
                                   UART_MODE_RS485_HALF_DUPLEX));
+    ESP_ERROR_CHECK(uart_set_rx_timeout(MODBUS_UART_NUM, RX_TOUT_SYMBOLS));
 
     s_mutex = xSemaphoreCreateMutex();
     configASSERT(s_mutex);
@@ -187,7 +281,7 @@ rs485_err_t lux_rs485_read_input(uint16_t start, uint16_t count, uint16_t *out)
     uint8_t resp[RX_BUF];
     size_t  resp_len = 0;
 
-    rs485_err_t err = mb_transact(req, req_len, resp, &resp_len);
+    rs485_err_t err = mb_transact(req, req_len, 5 + count * 2, resp, &resp_len);
     if (err == RS485_OK)
         err = parse_read_resp(resp, resp_len, out, count);
     if (err != RS485_OK)
@@ -207,7 +301,7 @@ rs485_err_t lux_rs485_read_hold(uint16_t start, uint16_t count, uint16_t *out) {
     uint8_t resp[RX_BUF];
     size_t  resp_len = 0;
 
-    rs485_err_t err = mb_transact(req, req_len, resp, &resp_len);
+    rs485_err_t err = mb_transact(req, req_len, 5 + count * 2, resp, &resp_len);
     if (err == RS485_OK)
         err = parse_read_resp(resp, resp_len, out, count);
     if (err != RS485_OK)
@@ -226,12 +320,12 @@ rs485_err_t lux_rs485_write_single(uint16_t reg, uint16_t value) {
     req[0] = MODBUS_SLAVE_ADDR;  req[1] = 0x06;
     req[2] = (reg   >> 8) & 0xFF;  req[3] = reg   & 0xFF;
     req[4] = (value >> 8) & 0xFF;  req[5] = value & 0xFF;
-    uint16_t crc = mb_crc(req, 6);
+    uint16_t crc = lux_crc16(req, 6);
     req[6] = crc & 0xFF;  req[7] = (crc >> 8) & 0xFF;
 
     uint8_t resp[RX_BUF];
     size_t  resp_len = 0;
-    rs485_err_t err = mb_transact(req, 8, resp, &resp_len);
+    rs485_err_t err = mb_transact(req, 8, 8, resp, &resp_len);
 
     if (err == RS485_OK) {
         // Inverter echoes the request verbatim
@@ -264,13 +358,13 @@ rs485_err_t lux_rs485_write_multi(uint16_t start,
         req[7 + i*2 + 1] =  values[i] & 0xFF;
     }
     size_t req_len = 7 + count * 2;
-    uint16_t crc = mb_crc(req, req_len);
+    uint16_t crc = lux_crc16(req, req_len);
     req[req_len++] = crc & 0xFF;
     req[req_len++] = (crc >> 8) & 0xFF;
 
     uint8_t resp[RX_BUF];
     size_t  resp_len = 0;
-    rs485_err_t err = mb_transact(req, req_len, resp, &resp_len);
+    rs485_err_t err = mb_transact(req, req_len, 8, resp, &resp_len);
 
     if (err == RS485_OK)
         ESP_LOGI(TAG, "write_multi start=%u count=%u OK", start, count);
@@ -279,4 +373,170 @@ rs485_err_t lux_rs485_write_multi(uint16_t start,
 
     xSemaphoreGive(s_mutex);
     return err;
-}
\ No newline at end of file
+}
+
+// ── Calibration ───────────────────────────────────────────────
+#define CAL_SAMPLES       8
+#define CAL_PROBES        3
+#define CAL_READ_REGS     40
+#define CAL_GAP_MAX_US    20000
+#define NVS_NAMESPACE     "rs485"
+#define NVS_KEY_TIMING    "timing"
+#define TIMING_VERSION    1
+
+typedef struct {
+    uint8_t        version;
+    rs485_timing_t t;
+} timing_blob_t;
+
+static void timing_apply(const rs485_timing_t *t) {
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (t->baud != s_timing.baud)
+        uart_set_baudrate(MODBUS_UART_NUM, t->baud);
+    s_timing = *t;
+    xSemaphoreGive(s_mutex);
+}
+
+static bool timing_load(rs485_timing_t *t) {
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return false;
+    timing_blob_t b;
+    size_t len = sizeof(b);
+    esp_err_t err = nvs_get_blob(h, NVS_KEY_TIMING, &b, &len);
+    nvs_close(h);
+    if (err != ESP_OK || len != sizeof(b) || b.version != TIMING_VERSION || !b.t.baud)
+        return false;
+    *t = b.t;
+    return true;
+}
+
+static void timing_save(const rs485_timing_t *t) {
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return;
+    timing_blob_t b = { .version = TIMING_VERSION, .t = *t };
+    if (nvs_set_blob(h, NVS_KEY_TIMING, &b, sizeof(b)) == ESP_OK) nvs_commit(h);
+    nvs_close(h);
+}
+
+// `n` back-to-back reads of input 0; the last error, RS485_OK if all passed
+static rs485_err_t cal_probe(int n) {
+    uint16_t v;
+    rs485_err_t err = RS485_OK;
+    for (int i = 0; i < n; i++) {
+        rs485_err_t e = lux_rs485_read_input(0, 1, &v);
+        if (e != RS485_OK) err = e;
+    }
+    return err;
+}
+
+// Worst turnaround of CAL_SAMPLES reads with function `fn`
+static rs485_err_t cal_turnaround(uint8_t fn, uint32_t *worst_us) {
+    uint16_t regs[CAL_READ_REGS];
+    *worst_us = 0;
+    for (int i = 0; i < CAL_SAMPLES; i++) {
+        rs485_err_t err = fn == 0x04 ? lux_rs485_read_input(0, CAL_READ_REGS, regs)
+                                     : lux_rs485_read_hold(0, CAL_READ_REGS, regs);
+        if (err != RS485_OK) return err;
+        if (s_last_turn_us > *worst_us) *worst_us = s_last_turn_us;
+    }
+    return RS485_OK;
+}
+
+rs485_err_t lux_rs485_calibrate(bool force) {
+    if (!s_mutex) return RS485_ERR_FRAME;
+    char line[160];
+    rs485_timing_t t;
+
+    if (!force && timing_load(&t)) {
+        timing_apply(&t);
+        if (cal_probe(CAL_PROBES) == RS485_OK) {
+            s_timing.src = RS485_TIMING_NVS;
+            lux_rs485_timing_str(line, sizeof(line));
+            ESP_LOGI(TAG, "Timing from NVS: %s", line);
+            return RS485_OK;
+        }
+        ESP_LOGW(TAG, "Stored timing no longer answers — recalibrating");
+    }
+
+    // 1. Baud: fastest rate that answers every probe. Probing and the
+    //    turnaround runs use the widest gap so a slow inverter isn't
+    //    mistaken for one that doesn't answer.
+    static const uint32_t probe[] = RS485_PROBE_BAUDS;
+    rs485_err_t err = RS485_ERR_TIMEOUT;
+    for (size_t i = 0; i <= sizeof(probe) / sizeof(probe[0]); i++) {
+        uint32_t baud = i < sizeof(probe) / sizeof(probe[0]) ? probe[i] : RS485_BAUD;
+        if (i < sizeof(probe) / sizeof(probe[0]) && baud == RS485_BAUD) continue;
+        timing_defaults(&t, baud);
+        uint32_t min_gap = t.gap_us;
+        t.gap_us = CAL_GAP_MAX_US;
+        timing_apply(&t);
+        err = cal_probe(CAL_PROBES);
+        t.gap_us = min_gap;
+        ESP_LOGI(TAG, "Probe %lu baud: %s", (unsigned long)baud, rs485_err_str(err));
+        if (err == RS485_OK) break;
+    }
+    if (err != RS485_OK) {
+        timing_defaults(&t, RS485_BAUD);
+        timing_apply(&t);
+        ESP_LOGW(TAG, "Calibration failed (%s) — using defaults", rs485_err_str(err));
+        return err;
+    }
+
+    // 2. Turnaround per read function; writes keep the default budget
+    //    (measuring them would mean writing inverter EEPROM every boot)
+    const uint8_t fns[2] = { 0x03, 0x04 };
+    for (int i = 0; i < 2; i++) {
+        uint32_t worst;
+        err = cal_turnaround(fns[i], &worst);
+        if (err != RS485_OK) {
+            ESP_LOGW(TAG, "Turnaround fn=0x%02X: %s", fns[i], rs485_err_str(err));
+            timing_apply(&t);   // defaults at the working baud
+            return err;
+        }
+        uint32_t budget = worst * 2 + TURNAROUND_MARGIN_US;
+        if (budget < t.turnaround_us[fn_slot(fns[i])])
+            t.turnaround_us[fn_slot(fns[i])] = budget;
+    }
+    timing_apply(&t);   // t.gap_us = the Modbus minimum from here on
+
+    // 3. Gap: the Modbus minimum, doubled until back-to-back reads all pass.
+    //    Still failing at the widest gap means the bus isn't reliable: run
+    //    on defaults and keep NVS as it was, so the next boot tries again.
+    while ((err = cal_probe(CAL_SAMPLES)) != RS485_OK && t.gap_us < CAL_GAP_MAX_US) {
+        t.gap_us = t.gap_us * 2 < CAL_GAP_MAX_US ? t.gap_us * 2 : CAL_GAP_MAX_US;
+        timing_apply(&t);
+    }
+    if (err != RS485_OK) {
+        ESP_LOGW(TAG, "Back-to-back reads fail even with a %lu us gap (%s) — using defaults",
+                 (unsigned long)t.gap_us, rs485_err_str(err));
+        timing_defaults(&t, t.baud);
+        timing_apply(&t);
+        return err;
+    }
+
+    t.src = RS485_TIMING_CALIBRATED;
+    timing_apply(&t);
+    timing_save(&t);
+    lux_rs485_timing_str(line, sizeof(line));
+    ESP_LOGI(TAG, "Calibrated: %s", line);
+    return RS485_OK;
+}
+
+void lux_rs485_get_timing(rs485_timing_t *t, uint32_t seen_us[RS485_SLOTS]) {
+    *t = s_timing;
+    if (seen_us) memcpy(seen_us, s_seen_us, sizeof(s_seen_us));
+}
+
+void lux_rs485_timing_str(char *buf, size_t len) {
+    static const char *src[] = { "default", "nvs", "calibrated" };
+    snprintf(buf, len,
+             "%lu baud, gap %.2f ms, budget hold/input/write %.1f/%.1f/%.1f ms, "
+             "seen %.1f/%.1f/%.1f ms (%s)",
+             (unsigned long)s_timing.baud, s_timing.gap_us / 1000.0,
+             s_timing.turnaround_us[0] / 1000.0, s_timing.turnaround_us[1] / 1000.0,
+             s_timing.turnaround_us[2] / 1000.0,
+             s_seen_us[0] / 1000.0, s_seen_us[1] / 1000.0, s_seen_us[2] / 1000.0,
+             s_timing.src <= RS485_TIMING_CALIBRATED ? src[s_timing.src] : "?");
+}
+
+#endif  // RS485_MASTER_MODE
@@ -1,6 +1,11 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 // ── Return codes ──────────────────────────────────────────────
 typedef enum {
@@ -37,6 +42,41 @@ rs485_err_t lux_rs485_write_single(uint16_t reg, uint16_t value);
 rs485_err_t lux_rs485_write_multi(uint16_t start,
                                    const uint16_t *values, uint16_t count);
 
+// ── Bus timing ────────────────────────────────────────────────
+// Turnaround slots: fn=0x03, fn=0x04, writes (0x06/0x10)
+#define RS485_SLOT_HOLD     0
+#define RS485_SLOT_INPUT    1
+#define RS485_SLOT_WRITE    2
+#define RS485_SLOTS         3
+
+typedef enum {
+    RS485_TIMING_DEFAULT    = 0,   // config.h values, not calibrated
+    RS485_TIMING_NVS        = 1,   // loaded from NVS and verified
+    RS485_TIMING_CALIBRATED = 2,   // measured this boot
+} rs485_timing_src_t;
+
+typedef struct {
+    uint32_t baud;
+    uint32_t gap_us;                        // bus idle before each request
+    uint32_t turnaround_us[RS485_SLOTS];    // inverter think time, worst seen
+    uint8_t  src;                           // rs485_timing_src_t
+} rs485_timing_t;
+
+// Measures inverter turnaround per function code, probes RS485_PROBE_BAUDS
+// for the fastest rate the inverter answers on, finds the shortest reliable
+// inter-frame gap and stores the result in NVS. Without `force`, a stored
+// result is reused if the inverter still answers with it.
+// Blocks for up to a few seconds; call from the poll task before polling.
+// Returns RS485_OK, or the last error: config.h defaults stay in effect and
+// nothing is written to NVS.
+rs485_err_t lux_rs485_calibrate(bool force);
+
+// Current timing plus the worst turnaround seen since boot per slot
+void lux_rs485_get_timing(rs485_timing_t *t, uint32_t seen_us[RS485_SLOTS]);
+
+// One-line summary for logs and the status page
+void lux_rs485_timing_str(char *buf, size_t len);
+
 // ── Diagnostics ───────────────────────────────────────────────
 // Human-readable error string (for logging)
 static inline const char *rs485_err_str(rs485_err_t e) {
@@ -48,4 +88,8 @@ static inline const char *rs485_err_str(rs485_err_t e) {
         case RS485_ERR_FRAME:     return "FRAME";
         default:                  return "?";
     }
-}
\ No newline at end of file
+}
+
+#ifdef __cplusplus
+}
+#endif
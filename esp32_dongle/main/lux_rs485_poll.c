@@ -0,0 +1,186 @@
+// lux_rs485_poll.c
+// RS485 master: polls the inverter directly and feeds every front end
+// (MQTT, the :8000 cache) through shared_state.
+//
+// Schedule — the registers reg_poll_needed() asks for, as in lux_cloud.c, but
+// planned for the RTU limits (LUX_READ_MAX_RTU / LUX_READ_GAP_RTU):
+//   HOLD  once at start, then every POLL_HOLD_MS
+//   INPUT every POLL_INPUT_MS
+//   g_write_queue is drained before every block, so a write never waits
+//   for the rest of a cycle; after a battery-type change polling pauses
+//   for BATTERY_SETTLE_MS.
+// Before the first poll lux_rs485_calibrate() picks the baud rate, reply
+// deadlines and inter-frame gap (reused from NVS when still valid); the
+// driver enforces that gap, so transactions here run back to back.
+
+#include "lux_rs485_poll.h"
+#include "lux_rs485.h"
+#include "lux_read_plan.h"
+#include "shared_state.h"
+#include "config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+// Only RS485 master builds use the bus; otherwise this unit is empty
+#ifdef RS485_MASTER_MODE
+
+static const char *TAG = "rs485_poll";
+
+#define PLAN_MAX          16
+
+// One planned read and its statistics for the current report window
+typedef struct {
+    uint8_t  fn;
+    uint16_t start;
+    uint16_t count;
+    uint32_t ok;
+    uint32_t err[RS485_ERR_FRAME + 1];      // by rs485_err_t
+    uint32_t rtt_min_us, rtt_max_us;
+    uint64_t rtt_sum_us;
+} poll_block_t;
+
+static poll_block_t s_input[PLAN_MAX];
+static size_t       s_input_len;
+static poll_block_t s_hold[PLAN_MAX];
+static size_t       s_hold_len;
+static uint32_t     s_battery_change_ms = 0;
+
+static size_t poll_plan(const lux_reg_set_t *need, uint8_t fn, poll_block_t *out) {
+    lux_read_span_t spans[PLAN_MAX];
+    size_t n = lux_plan_reads(need, LUX_READ_MAX_RTU, LUX_READ_GAP_RTU, spans, PLAN_MAX);
+    for (size_t i = 0; i < n; i++) {
+        memset(&out[i], 0, sizeof(out[i]));
+        out[i].fn    = fn;
+        out[i].start = spans[i].start;
+        out[i].count = spans[i].count;
+        ESP_LOGI(TAG, "plan %s %u+%u", fn == 0x04 ? "INPUT" : "HOLD ",
+                 spans[i].start, spans[i].count);
+    }
+    return n;
+}
+
+// ── Writes ────────────────────────────────────────────────────
+static void poll_drain_writes(void) {
+    write_cmd_t cmd;
+    while (xQueueReceive(g_write_queue, &cmd, 0) == pdTRUE) {
+        rs485_err_t err;
+        if (cmd.type == CMD_WRITE_SINGLE) {
+            err = lux_rs485_write_single(cmd.reg, cmd.value);
+            if (err == RS485_OK) reg_update_hold(cmd.reg, &cmd.value, 1);
+            ESP_LOGI(TAG, "WRITE reg=%u val=%u [%s] %s", cmd.reg, cmd.value,
+                     cmd.source, rs485_err_str(err));
+        } else {
+            // Battery type: the two words the TCP WRITE_MULTI frame carries
+            // at start_reg 0 (see lux_build_write_multi)
+            uint16_t v[2] = { cmd.reg0, cmd.reg1 };
+            if (cmd.type == CMD_SET_LITHIUM)  { v[0] = 0x801A; v[1] = 0x0100; }
+            if (cmd.type == CMD_SET_LEADACID) { v[0] = 0x8019; v[1] = 0x0100; }
+            err = lux_rs485_write_multi(0, v, 2);
+            s_battery_change_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+            ESP_LOGI(TAG, "WRITE_MULTI 0x%04X [%s] %s — pausing poll %ds", v[0],
+                     cmd.source, rs485_err_str(err), BATTERY_SETTLE_MS / 1000);
+        }
+    }
+}
+
+// ── Reads ─────────────────────────────────────────────────────
+static void poll_block(poll_block_t *b) {
+    uint16_t regs[LUX_READ_MAX_RTU];
+    int64_t t0 = esp_timer_get_time();
+    rs485_err_t err = b->fn == 0x04 ? lux_rs485_read_input(b->start, b->count, regs)
+                                    : lux_rs485_read_hold(b->start, b->count, regs);
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+
+    if (err != RS485_OK) {
+        b->err[err]++;
+        return;
+    }
+    if (b->ok == 0 || us < b->rtt_min_us) b->rtt_min_us = us;
+    if (b->ok == 0 || us > b->rtt_max_us) b->rtt_max_us = us;
+    b->rtt_sum_us += us;
+    b->ok++;
+    if (b->fn == 0x04) reg_update_input(b->start, regs, b->count);
+    else               reg_update_hold(b->start, regs, b->count);
+}
+
+static void poll_blocks(poll_block_t *blocks, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        poll_drain_writes();
+        poll_block(&blocks[i]);
+    }
+}
+
+static void poll_report(poll_block_t *blocks, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        poll_block_t *b = &blocks[i];
+        uint32_t errs = 0;
+        for (int e = 0; e <= RS485_ERR_FRAME; e++) errs += b->err[e];
+        if (b->ok + errs == 0) continue;
+        ESP_LOGI(TAG, "%s %3u+%-3u ok=%lu err=%lu (to=%lu crc=%lu exc=%lu frm=%lu) "
+                 "rtt min/avg/max=%.1f/%.1f/%.1f ms",
+                 b->fn == 0x04 ? "INPUT" : "HOLD ", b->start, b->count,
+                 (unsigned long)b->ok, (unsigned long)errs,
+                 (unsigned long)b->err[RS485_ERR_TIMEOUT],
+                 (unsigned long)b->err[RS485_ERR_CRC],
+                 (unsigned long)b->err[RS485_ERR_EXCEPTION],
+                 (unsigned long)b->err[RS485_ERR_FRAME],
+                 b->rtt_min_us / 1000.0,
+                 b->ok ? (double)b->rtt_sum_us / b->ok / 1000.0 : 0.0,
+                 b->rtt_max_us / 1000.0);
+        b->ok = 0;
+        memset(b->err, 0, sizeof(b->err));
+        b->rtt_min_us = b->rtt_max_us = 0;
+        b->rtt_sum_us = 0;
+    }
+}
+
+// ── Task ──────────────────────────────────────────────────────
+void lux_rs485_poll_task(void *arg) {
+    ESP_LOGI(TAG, "RS485 poller on core %d", xPortGetCoreID());
+    lux_rs485_calibrate(false);
+
+    lux_reg_set_t input, hold;
+    lux_regset_clear(&input);
+    lux_regset_clear(&hold);
+    reg_poll_needed(&input, &hold);
+    s_input_len = poll_plan(&input, 0x04, s_input);
+    s_hold_len  = poll_plan(&hold,  0x03, s_hold);
+
+    uint32_t last_input = 0, last_hold = 0, last_report = 0;
+    bool     first = true;
+
+    while (1) {
+        poll_drain_writes();
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+        if (s_battery_change_ms && now - s_battery_change_ms < BATTERY_SETTLE_MS) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (first || now - last_hold >= POLL_HOLD_MS) {
+            poll_blocks(s_hold, s_hold_len);
+            last_hold = now;
+        }
+        if (first || now - last_input >= POLL_INPUT_MS) {
+            poll_blocks(s_input, s_input_len);
+            last_input = now;
+        }
+        first = false;
+
+        if (now - last_report >= RS485_STATS_MS) {
+            last_report = now;
+            poll_report(s_input, s_input_len);
+            poll_report(s_hold, s_hold_len);
+            char timing[160];
+            lux_rs485_timing_str(timing, sizeof(timing));
+            ESP_LOGI(TAG, "timing: %s", timing);
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+#endif  // RS485_MASTER_MODE
@@ -0,0 +1,12 @@
+#pragma once
+// lux_rs485_poll.h
+// RS485 master poller: reads the inverter over Modbus RTU into shared_state
+// and executes g_write_queue on the bus. Only used with RS485_MASTER_MODE.
+
+/**
+ * FreeRTOS task. Call lux_rs485_init() first.
+ * Polls the registers lux_mqtt publishes as coalesced blocks of up to
+ * LUX_READ_MAX_RTU registers: INPUT every POLL_INPUT_MS, HOLD every
+ * POLL_HOLD_MS. Logs per-block RTT and error counts every RS485_STATS_MS.
+ */
+void lux_rs485_poll_task(void *arg);
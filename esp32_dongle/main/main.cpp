@@ -8,9 +8,12 @@
 #include "config.h"
 
 extern "C" {
+    void lux_capture_init(void);
     void lux_relay_start(void);
     void lux_local_server_start(void);
     void lux_mqtt_task(void *arg);
+    void lux_rs485_init(void);
+    void lux_rs485_poll_task(void *arg);
 }
 
 #include <stdio.h>
@@ -151,12 +154,22 @@ extern "C" void app_main(void) {
     // OTA web server on port 8080
     lux_ota_start();
 
+    // Frame capture ring — before the services that feed it
+    lux_capture_init();
+
     // Port 4346: real dongle → cloud (transparent relay, parses frames → shared_state)
     lux_relay_start();
 
-    // Port 8000: ESPHome → real dongle (transparent relay)
+    // Port 8000: local clients → one shared session to the real dongle
     lux_local_server_start();
 
+#ifdef RS485_MASTER_MODE
+    // Core 1: poll the inverter over RS485 → shared_state; executes writes
+    lux_rs485_init();
+    xTaskCreatePinnedToCore(lux_rs485_poll_task, "rs485_poll",
+                            STACK_RS485, NULL, TASK_PRIO_RS485, NULL, 1);
+#endif
+
     // Core 1: MQTT publish + HA discovery + subscribe commands
     xTaskCreatePinnedToCore(lux_mqtt_task, "lux_mqtt",
                             STACK_MQTT, NULL, TASK_PRIO_MQTT, NULL, 1);
@@ -1,5 +1,14 @@
 #include "shared_state.h"
+#include "lux_mqtt.h"
 
 reg_cache_t    g_regs      = {};
 QueueHandle_t  g_write_queue = NULL;
 event_flags_t  g_events    = {};
+
+// MQTT sensors and the status page (lux_ota.h reads input 0..11). The
+// :8000 fan-out only answers from g_regs what is already fresh; anything
+// else is forwarded to the dongle, so it needs nothing polled on its behalf.
+void reg_poll_needed(lux_reg_set_t *input, lux_reg_set_t *hold) {
+    lux_mqtt_needed_regs(input, hold);
+    lux_regset_add(input, 0, 12);
+}
@@ -3,11 +3,27 @@
 #include <string.h>
 #include <stdbool.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
 #include "config.h"
+#include "lux_read_plan.h"
 
 // ── Register cache ────────────────────────────────────────────
+// Each register space is a seqlock: the writer bumps `seq` to odd, copies
+// the new words in, then bumps it back to even. Readers copy without any
+// lock and retry if `seq` moved underneath them, so a publisher can never
+// hold up the relay/cloud task that is storing a fresh reply. `wr_mutex`
+// only serialises writers against each other (relay vs cloud client).
+//
+// Writers also diff each reply against the cache and OR the registers that
+// actually changed into `*_dirty`; the publisher swaps those sets out with
+// reg_take_dirty() and only republishes what they touch.
+//
+// `*_ms` stamp every register with the tick it was last stored (0 = never),
+// so a reader can tell how old any particular range is, not just the cache.
 typedef struct {
     uint16_t input[INPUT_REG_COUNT];
     uint16_t hold[HOLD_REG_COUNT];
@@ -15,9 +31,25 @@ typedef struct {
     bool     hold_valid;
     uint32_t last_input_update_ms;
     uint32_t last_hold_update_ms;
-    SemaphoreHandle_t mutex;
+    uint32_t input_ms[INPUT_REG_COUNT];
+    uint32_t hold_ms[HOLD_REG_COUNT];
+    uint32_t input_seq;
+    uint32_t hold_seq;
+    lux_reg_set_t input_dirty;
+    lux_reg_set_t hold_dirty;
+    SemaphoreHandle_t wr_mutex;
 } reg_cache_t;
 
+// Consistent copy of both spaces (each one from a single writer pass)
+typedef struct {
+    uint16_t input[INPUT_REG_COUNT];
+    uint16_t hold[HOLD_REG_COUNT];
+    bool     input_valid;
+    bool     hold_valid;
+    uint32_t last_input_update_ms;
+    uint32_t last_hold_update_ms;
+} reg_snapshot_t;
+
 // ── Write command ─────────────────────────────────────────────
 typedef enum {
     CMD_WRITE_SINGLE = 0,
@@ -35,11 +67,21 @@ typedef struct {
     char       source[16];
 } write_cmd_t;
 
-// ── Event flags ───────────────────────────────────────────────
+// ── Events ────────────────────────────────────────────────────
+// Register updates wake the MQTT task through an event group whose bits say
+// which 40-register banks changed. `first_change_us` is the esp_timer time
+// of the oldest change not yet published (0 = none pending); the publisher
+// swaps it out to measure frame -> broker latency.
+#define EV_INPUT_BANK(n)  ((EventBits_t)1 << (n))          // banks 0..5
+#define EV_HOLD_BANK(n)   ((EventBits_t)1 << (8 + (n)))
+#define EV_INPUT_ANY      ((EventBits_t)0x003F)
+#define EV_HOLD_ANY       ((EventBits_t)0x3F00)
+#define EV_PUBLISH_ALL    ((EventBits_t)1 << 16)          // full refresh request
+#define EV_ALL            (EV_INPUT_ANY | EV_HOLD_ANY | EV_PUBLISH_ALL)
+
 typedef struct {
-    bool input_updated;
-    bool hold_updated;
-    SemaphoreHandle_t mutex;
+    EventGroupHandle_t group;
+    int64_t            first_change_us;
 } event_flags_t;
 
 // ── Globals ───────────────────────────────────────────────────
@@ -47,28 +89,157 @@ extern reg_cache_t    g_regs;
 extern QueueHandle_t  g_write_queue;
 extern event_flags_t  g_events;
 
+// ── Poll set ──────────────────────────────────────────────────
+// Registers the pollers (lux_cloud.c, lux_rs485_poll.c) must keep fresh
+// for every reader of g_regs, not just the MQTT sensor map.
+void reg_poll_needed(lux_reg_set_t *input, lux_reg_set_t *hold);
+
 // ── Init ──────────────────────────────────────────────────────
 static inline void shared_state_init(void) {
     memset(&g_regs, 0, sizeof(g_regs));
-    g_regs.mutex    = xSemaphoreCreateMutex();
-    g_events.mutex  = xSemaphoreCreateMutex();
+    g_regs.wr_mutex = xSemaphoreCreateMutex();
+    g_events.group  = xEventGroupCreate();
     g_write_queue   = xQueueCreate(16, sizeof(write_cmd_t));
 }
 
-// ── Thread-safe reads ─────────────────────────────────────────
+// ── Seqlock primitives ────────────────────────────────────────
+static inline void reg_seq_write_begin(uint32_t *seq) {
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void reg_seq_write_end(uint32_t *seq) {
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+// Copy `n` bytes of a seqlocked region. A writer only holds `seq` odd for
+// one memcpy of <= 128 words, so a reader normally gets through first try;
+// if it keeps colliding (e.g. it preempted a lower-priority writer on the
+// same core) it sleeps a tick to let the writer finish.
+static inline void reg_seq_read(const uint32_t *seq, void *dst,
+                                const void *src, size_t n) {
+    for (int tries = 0;; tries++) {
+        uint32_t s0 = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (!(s0 & 1)) {
+            memcpy(dst, src, n);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(seq, __ATOMIC_RELAXED) == s0) return;
+        }
+        if (tries >= 8) vTaskDelay(1);
+    }
+}
+
+// Copy `count` words into the cache and return the changed ones in `dirty`
+// (caller holds the write side of the seqlock).
+static inline void reg_store_diff(uint16_t *dst, uint16_t start, const uint16_t *src,
+                                  uint16_t count, lux_reg_set_t *dirty) {
+    for (uint16_t i = 0; i < count; i++) {
+        if (dst[start + i] != src[i]) {
+            dst[start + i] = src[i];
+            lux_regset_add(dirty, (uint16_t)(start + i), 1);
+        }
+    }
+}
+
+// Publish changed bits without a lock (the publisher may be swapping the
+// set out at the same moment) and return the 40-register banks touched.
+static inline EventBits_t reg_mark_dirty(lux_reg_set_t *set, const lux_reg_set_t *changed) {
+    EventBits_t banks = 0;
+    for (int i = 0; i < LUX_PLAN_WORDS; i++) {
+        uint32_t w = changed->w[i];
+        if (!w) continue;
+        __atomic_fetch_or(&set->w[i], w, __ATOMIC_RELEASE);
+        for (; w; w &= w - 1)
+            banks |= (EventBits_t)1 << ((i * 32 + __builtin_ctz(w)) / 40);
+    }
+    return banks;
+}
+
+// Wake the publisher for `bits`, stamping the first unpublished change
+static inline void reg_signal(EventBits_t bits) {
+    if (!bits) return;
+    int64_t none = 0;
+    __atomic_compare_exchange_n(&g_events.first_change_us, &none, esp_timer_get_time(),
+                                false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    xEventGroupSetBits(g_events.group, bits);
+}
+
+// ── Lock-free reads ───────────────────────────────────────────
+// Consistent copy of input[start .. start+count); false if out of range.
+static inline bool reg_read_input(uint16_t start, uint16_t *out, uint16_t count) {
+    if (start >= INPUT_REG_COUNT || start + count > INPUT_REG_COUNT) return false;
+    reg_seq_read(&g_regs.input_seq, out, &g_regs.input[start], count * sizeof(uint16_t));
+    return true;
+}
+
+static inline bool reg_read_hold(uint16_t start, uint16_t *out, uint16_t count) {
+    if (start >= HOLD_REG_COUNT || start + count > HOLD_REG_COUNT) return false;
+    reg_seq_read(&g_regs.hold_seq, out, &g_regs.hold[start], count * sizeof(uint16_t));
+    return true;
+}
+
+// Whole cache in one pass - publishers decode from this instead of
+// fetching registers one at a time. The flags and timestamps are single
+// words and only ever move forward, so they are read plainly.
+static inline void reg_snapshot(reg_snapshot_t *s) {
+    reg_seq_read(&g_regs.input_seq, s->input, g_regs.input, sizeof(s->input));
+    reg_seq_read(&g_regs.hold_seq, s->hold, g_regs.hold, sizeof(s->hold));
+    s->input_valid          = g_regs.input_valid;
+    s->hold_valid           = g_regs.hold_valid;
+    s->last_input_update_ms = g_regs.last_input_update_ms;
+    s->last_hold_update_ms  = g_regs.last_hold_update_ms;
+}
+
+// Move the accumulated dirty sets into `input`/`hold` and clear them. Call
+// before reg_snapshot(): a register changed in between is just published
+// once more next time.
+static inline void reg_take_dirty(lux_reg_set_t *input, lux_reg_set_t *hold) {
+    for (int i = 0; i < LUX_PLAN_WORDS; i++) {
+        input->w[i] = __atomic_exchange_n(&g_regs.input_dirty.w[i], 0, __ATOMIC_ACQUIRE);
+        hold->w[i]  = __atomic_exchange_n(&g_regs.hold_dirty.w[i],  0, __ATOMIC_ACQUIRE);
+    }
+}
+
+// True if every register of [start, start+count) was stored within the
+// last `max_age_ms`. Stamps are single words, read without the seqlock.
+static inline bool reg_range_fresh(const uint32_t *stamps, uint16_t limit,
+                                   uint16_t start, uint16_t count,
+                                   uint32_t max_age_ms) {
+    if (count == 0 || start >= limit || start + count > limit) return false;
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    for (uint16_t i = start; i < start + count; i++) {
+        uint32_t t = __atomic_load_n(&stamps[i], __ATOMIC_RELAXED);
+        if (t == 0 || now - t > max_age_ms) return false;
+    }
+    return true;
+}
+
+static inline bool reg_input_fresh(uint16_t start, uint16_t count, uint32_t max_age_ms) {
+    return reg_range_fresh(g_regs.input_ms, INPUT_REG_COUNT, start, count, max_age_ms);
+}
+
+static inline bool reg_hold_fresh(uint16_t start, uint16_t count, uint32_t max_age_ms) {
+    return reg_range_fresh(g_regs.hold_ms, HOLD_REG_COUNT, start, count, max_age_ms);
+}
+
+// Mark a range stale without knowing its new values (a WRITE_MULTI reply
+// carries only start and count), so the next read of it is forwarded.
+static inline void reg_hold_invalidate(uint16_t start, uint16_t count) {
+    if (start >= HOLD_REG_COUNT) return;
+    if (start + count > HOLD_REG_COUNT) count = HOLD_REG_COUNT - start;
+    for (uint16_t i = start; i < start + count; i++)
+        __atomic_store_n(&g_regs.hold_ms[i], 0, __ATOMIC_RELAXED);
+}
+
 static inline uint16_t reg_get_input(uint16_t addr) {
-    if (addr >= INPUT_REG_COUNT) return 0;
-    xSemaphoreTake(g_regs.mutex, portMAX_DELAY);
-    uint16_t v = g_regs.input[addr];
-    xSemaphoreGive(g_regs.mutex);
+    uint16_t v = 0;
+    reg_read_input(addr, &v, 1);
     return v;
 }
 
 static inline uint16_t reg_get_hold(uint16_t addr) {
-    if (addr >= HOLD_REG_COUNT) return 0;
-    xSemaphoreTake(g_regs.mutex, portMAX_DELAY);
-    uint16_t v = g_regs.hold[addr];
-    xSemaphoreGive(g_regs.mutex);
+    uint16_t v = 0;
+    reg_read_hold(addr, &v, 1);
     return v;
 }
 
@@ -77,28 +248,40 @@ static inline void reg_update_input(uint16_t start,
                                      const uint16_t *data, uint16_t count) {
     if (start >= INPUT_REG_COUNT) return;
     if (start + count > INPUT_REG_COUNT) count = INPUT_REG_COUNT - start;
-    xSemaphoreTake(g_regs.mutex, portMAX_DELAY);
-    memcpy(&g_regs.input[start], data, count * sizeof(uint16_t));
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    lux_reg_set_t changed;
+    lux_regset_clear(&changed);
+    xSemaphoreTake(g_regs.wr_mutex, portMAX_DELAY);
+    reg_seq_write_begin(&g_regs.input_seq);
+    reg_store_diff(g_regs.input, start, data, count, &changed);
+    for (uint16_t i = 0; i < count; i++)
+        __atomic_store_n(&g_regs.input_ms[start + i], now ? now : 1, __ATOMIC_RELAXED);
     g_regs.input_valid = true;
-    g_regs.last_input_update_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    xSemaphoreGive(g_regs.mutex);
-    xSemaphoreTake(g_events.mutex, portMAX_DELAY);
-    g_events.input_updated = true;
-    xSemaphoreGive(g_events.mutex);
+    g_regs.last_input_update_ms = now;
+    reg_seq_write_end(&g_regs.input_seq);
+    xSemaphoreGive(g_regs.wr_mutex);
+    EventBits_t banks = reg_mark_dirty(&g_regs.input_dirty, &changed);
+    reg_signal(banks);
 }
 
 static inline void reg_update_hold(uint16_t start,
                                     const uint16_t *data, uint16_t count) {
     if (start >= HOLD_REG_COUNT) return;
     if (start + count > HOLD_REG_COUNT) count = HOLD_REG_COUNT - start;
-    xSemaphoreTake(g_regs.mutex, portMAX_DELAY);
-    memcpy(&g_regs.hold[start], data, count * sizeof(uint16_t));
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    lux_reg_set_t changed;
+    lux_regset_clear(&changed);
+    xSemaphoreTake(g_regs.wr_mutex, portMAX_DELAY);
+    reg_seq_write_begin(&g_regs.hold_seq);
+    reg_store_diff(g_regs.hold, start, data, count, &changed);
+    for (uint16_t i = 0; i < count; i++)
+        __atomic_store_n(&g_regs.hold_ms[start + i], now ? now : 1, __ATOMIC_RELAXED);
     g_regs.hold_valid = true;
-    g_regs.last_hold_update_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    xSemaphoreGive(g_regs.mutex);
-    xSemaphoreTake(g_events.mutex, portMAX_DELAY);
-    g_events.hold_updated = true;
-    xSemaphoreGive(g_events.mutex);
+    g_regs.last_hold_update_ms = now;
+    reg_seq_write_end(&g_regs.hold_seq);
+    xSemaphoreGive(g_regs.wr_mutex);
+    EventBits_t banks = reg_mark_dirty(&g_regs.hold_dirty, &changed);
+    reg_signal(banks << 8);   // EV_HOLD_BANK(n)
 }
 
 // ── Queue writes ──────────────────────────────────────────────
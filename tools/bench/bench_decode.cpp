@@ -0,0 +1,175 @@
+// Host benchmark: memcpy-into-packed-struct decode vs lux_regdecode.h
+//
+// Build & run (from repo root):
+//   g++ -O2 -std=c++17 -I components/luxpower_sna tools/bench/bench_decode.cpp -o /tmp/bench_decode
+//   /tmp/bench_decode
+//
+// "struct"  - the old hub path: memcpy each 40-register bank into Bank0..4
+//             and scale every member by hand
+// "table"   - generic lux_fields_decode() loop over LUX_INPUT_FIELD[]
+// "const"   - lux_input_decode_all(): the list expanded with constant ids
+//             (hub snapshot decode, Arduino LUX_INPUT_VALUE)
+// All three must produce bit-identical floats for random register images.
+
+#include "lux_regdecode.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ---- Reference: the packed bank structs the hub used to decode through ----
+#pragma pack(push, 1)
+struct Bank0 {
+    uint16_t status;
+    int16_t  v_pv_1, v_pv_2, v_pv_3, v_bat;
+    uint8_t  soc, soh;
+    uint16_t internal_fault;
+    int16_t  p_pv_1, p_pv_2, p_pv_3, p_charge, p_discharge;
+    int16_t  v_ac_r, v_ac_s, v_ac_t, f_ac, p_inv, p_rec;
+    int16_t  rms_current, pf;
+    int16_t  v_eps_r, v_eps_s, v_eps_t, f_eps, p_to_eps, apparent_eps_power;
+    int16_t  p_to_grid, p_to_user;
+    int16_t  e_pv_1_day, e_pv_2_day, e_pv_3_day, e_inv_day, e_rec_day;
+    int16_t  e_chg_day, e_dischg_day, e_eps_day, e_to_grid_day, e_to_user_day;
+    int16_t  v_bus_1, v_bus_2;
+};
+struct Bank1 {
+    int32_t  e_pv_1_all, e_pv_2_all, e_pv_3_all;
+    int32_t  e_inv_all, e_rec_all, e_chg_all, e_dischg_all, e_eps_all;
+    int32_t  e_to_grid_all, e_to_user_all;
+    uint32_t fault_code, warning_code;
+    int16_t  t_inner, t_rad_1, t_rad_2, t_bat;
+    uint16_t _reserved68;
+    uint32_t uptime;
+    uint8_t  _tail[18];
+};
+struct Bank2 {
+    uint16_t _r80;
+    int16_t  max_chg_curr, max_dischg_curr, charge_volt_ref, dischg_cut_volt;
+    uint8_t  _placeholder[20];
+    int16_t  bat_status_inv, bat_count, bat_capacity, bat_current;
+    int16_t  _r99, _r100;
+    int16_t  max_cell_volt, min_cell_volt, max_cell_temp, min_cell_temp;
+    uint16_t _r105;
+    int16_t  bat_cycle_count;
+    uint8_t  _r107_113[14];
+    int16_t  p_load2;
+    uint8_t  _r115_119[10];
+};
+struct Bank3 {
+    uint16_t _r120;
+    int16_t  gen_input_volt, gen_input_freq, gen_power_watt, gen_power_day, gen_power_all;
+    uint16_t _r126;
+    int16_t  eps_L1_volt, eps_L2_volt, eps_L1_watt, eps_L2_watt;
+    uint8_t  _r131_159[58];
+};
+struct Bank4 {
+    uint8_t  _r160_169[20];
+    int16_t  p_load_ongrid, e_load_day, e_load_all_l;
+    uint8_t  _r173_199[54];
+};
+#pragma pack(pop)
+
+// Output order == LUX_INPUT_FIELD order
+static void decode_struct(const uint16_t *regs, float *o) {
+    Bank0 a; memcpy(&a, regs + 0, sizeof(a));
+    Bank1 b; memcpy(&b, regs + 40, sizeof(b));
+    Bank2 c; memcpy(&c, regs + 80, sizeof(c));
+    Bank3 d; memcpy(&d, regs + 120, sizeof(d));
+    Bank4 e; memcpy(&e, regs + 160, sizeof(e));
+    int i = 0;
+    o[i++] = a.status;
+    o[i++] = a.v_pv_1 / 10.0f; o[i++] = a.v_pv_2 / 10.0f; o[i++] = a.v_pv_3 / 10.0f;
+    o[i++] = a.v_bat / 10.0f;  o[i++] = a.soc; o[i++] = a.soh; o[i++] = a.internal_fault;
+    o[i++] = a.p_pv_1; o[i++] = a.p_pv_2; o[i++] = a.p_pv_3;
+    o[i++] = a.p_charge; o[i++] = a.p_discharge;
+    o[i++] = a.v_ac_r / 10.0f; o[i++] = a.v_ac_s / 10.0f; o[i++] = a.v_ac_t / 10.0f;
+    o[i++] = a.f_ac / 100.0f; o[i++] = a.p_inv; o[i++] = a.p_rec;
+    o[i++] = a.rms_current / 100.0f; o[i++] = a.pf / 1000.0f;
+    o[i++] = a.v_eps_r / 10.0f; o[i++] = a.v_eps_s / 10.0f; o[i++] = a.v_eps_t / 10.0f;
+    o[i++] = a.f_eps / 100.0f; o[i++] = a.p_to_eps; o[i++] = a.apparent_eps_power;
+    o[i++] = a.p_to_grid; o[i++] = a.p_to_user;
+    o[i++] = a.e_pv_1_day / 10.0f; o[i++] = a.e_pv_2_day / 10.0f; o[i++] = a.e_pv_3_day / 10.0f;
+    o[i++] = a.e_inv_day / 10.0f; o[i++] = a.e_rec_day / 10.0f; o[i++] = a.e_chg_day / 10.0f;
+    o[i++] = a.e_dischg_day / 10.0f; o[i++] = a.e_eps_day / 10.0f;
+    o[i++] = a.e_to_grid_day / 10.0f; o[i++] = a.e_to_user_day / 10.0f;
+    o[i++] = a.v_bus_1 / 10.0f; o[i++] = a.v_bus_2 / 10.0f;
+    o[i++] = b.e_pv_1_all / 10.0f; o[i++] = b.e_pv_2_all / 10.0f; o[i++] = b.e_pv_3_all / 10.0f;
+    o[i++] = b.e_inv_all / 10.0f; o[i++] = b.e_rec_all / 10.0f; o[i++] = b.e_chg_all / 10.0f;
+    o[i++] = b.e_dischg_all / 10.0f; o[i++] = b.e_eps_all / 10.0f;
+    o[i++] = b.e_to_grid_all / 10.0f; o[i++] = b.e_to_user_all / 10.0f;
+    o[i++] = (float)b.fault_code; o[i++] = (float)b.warning_code;
+    o[i++] = b.t_inner; o[i++] = b.t_rad_1; o[i++] = b.t_rad_2; o[i++] = b.t_bat;
+    o[i++] = (float)b.uptime;
+    o[i++] = c.max_chg_curr / 10.0f; o[i++] = c.max_dischg_curr / 10.0f;
+    o[i++] = c.charge_volt_ref / 10.0f; o[i++] = c.dischg_cut_volt / 10.0f;
+    o[i++] = c.bat_status_inv; o[i++] = c.bat_count; o[i++] = c.bat_capacity;
+    o[i++] = c.bat_current / 10.0f;
+    o[i++] = c.max_cell_volt / 1000.0f; o[i++] = c.min_cell_volt / 1000.0f;
+    o[i++] = c.max_cell_temp / 10.0f; o[i++] = c.min_cell_temp / 10.0f;
+    o[i++] = c.bat_cycle_count; o[i++] = c.p_load2;
+    o[i++] = d.gen_input_volt / 10.0f; o[i++] = d.gen_input_freq / 100.0f;
+    o[i++] = d.gen_power_watt; o[i++] = d.gen_power_day / 10.0f; o[i++] = d.gen_power_all / 10.0f;
+    o[i++] = d.eps_L1_volt / 10.0f; o[i++] = d.eps_L2_volt / 10.0f;
+    o[i++] = d.eps_L1_watt; o[i++] = d.eps_L2_watt;
+    o[i++] = e.p_load_ongrid; o[i++] = e.e_load_day / 10.0f; o[i++] = e.e_load_all_l / 10.0f;
+}
+
+static void decode_table(const uint16_t *regs, float *o) {
+    lux_fields_decode(LUX_INPUT_FIELD, LUX_IN_COUNT, regs, o);
+}
+
+static void decode_const(const uint16_t *regs, float *o) {
+    lux_input_decode_all(regs, o);
+}
+
+typedef void (*decode_fn)(const uint16_t *, float *);
+
+static volatile float g_sink;
+
+static double bench(decode_fn fn, uint16_t (*imgs)[200], int n_imgs, size_t iters) {
+    float out[LUX_IN_COUNT];
+    float acc = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iters; i++) {
+        fn(imgs[i % n_imgs], out);
+        acc += out[i % LUX_IN_COUNT];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    g_sink = acc;
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+int main() {
+    static uint16_t imgs[64][200];
+    srand(42);
+    for (auto &img : imgs)
+        for (auto &w : img) w = (uint16_t)rand();
+
+    // Correctness: bit-identical output for every field
+    for (int k = 0; k < 64; k++) {
+        float ref[LUX_IN_COUNT], tab[LUX_IN_COUNT], cst[LUX_IN_COUNT];
+        decode_struct(imgs[k], ref);
+        decode_table(imgs[k], tab);
+        decode_const(imgs[k], cst);
+        for (int i = 0; i < LUX_IN_COUNT; i++) {
+            if (memcmp(&ref[i], &tab[i], sizeof(float)) || memcmp(&ref[i], &cst[i], sizeof(float))) {
+                printf("MISMATCH image %d field %d (addr %u): struct %g table %g const %g\n",
+                       k, i, LUX_INPUT_FIELD[i].addr, ref[i], tab[i], cst[i]);
+                return 1;
+            }
+        }
+    }
+
+    const size_t iters = 2000000;
+    double s = bench(decode_struct, imgs, 64, iters);
+    double t = bench(decode_table, imgs, 64, iters);
+    double c = bench(decode_const, imgs, 64, iters);
+    printf("%d fields per snapshot (registers 0-199)\n", (int)LUX_IN_COUNT);
+    printf("%-8s %10s %10s\n", "path", "ns/snap", "vs struct");
+    printf("%-8s %10.1f %9.2fx\n", "struct", s, 1.0);
+    printf("%-8s %10.1f %9.2fx\n", "table", t, s / t);
+    printf("%-8s %10.1f %9.2fx\n", "const", c, s / c);
+    return 0;
+}
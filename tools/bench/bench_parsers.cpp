@@ -0,0 +1,365 @@
+// Host benchmark + fuzz: every A1 1A receive path on the same byte stream
+//
+// Build & run (from repo root):
+//   g++ -O2 -std=c++17 -I components/luxpower_sna -I esp32_dongle/main -I tools/bench/shim
+//       tools/bench/bench_parsers.cpp Arduino/LuxParser.cpp -o /tmp/bench_parsers
+//   /tmp/bench_parsers                              # synthetic stream
+//   /tmp/bench_parsers tools/lux_pure_proxy.log     # recorded hex dumps
+//   /tmp/bench_parsers --fuzz 20000                 # + fuzz rounds
+// For the fuzz pass build a second binary with -O1 -g -fsanitize=address,undefined.
+//
+// Targets
+//   hub      lux_next_frame() over LuxRingBuffer (the hub's try_process_packet_)
+//            + the checks process_packet_ makes before dispatch (CRC, lengths)
+//   dongle   lux_frame_feed() (lux_netloop.c reassembly) + lux_parse()
+//            + lux_resp_regs() for read replies
+//   arduino  LuxData::decode(); the sketch hands it one recv() per reply, so
+//            it gets whole frames in the timing pass and raw slices in fuzz
+//
+// The stream is cut into random TCP segment sizes (1..1460 bytes). Hub and
+// dongle must find every frame. Each fuzz round mutates a stretch of the
+// stream (bit flips, inserted / deleted bytes, rewritten length fields,
+// fake magics), follows it with clean frames and requires both framers to
+// recover the tail; the Arduino decoder gets random slices and must simply
+// stay inside its buffer (ASan).
+
+#include "lux_ring_buffer.h"
+#include "lux_proto.h"
+#include "../../Arduino/LuxParser.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using esphome::luxpower_sna::LuxFrameStep;
+using esphome::luxpower_sna::LuxRingBuffer;
+using esphome::luxpower_sna::lux_next_frame;
+
+static const size_t HUB_RING      = 1024;   // LUX_RX_RING_SIZE
+static const size_t HUB_MAX_FRAME = 320;    // LUX_MAX_FRAME
+static const size_t DONGLE_BUF    = 1024;   // NET_BUF_SIZE
+static const size_t TCP_MSS       = 1460;
+
+typedef std::vector<uint8_t> Bytes;
+
+// ---- Stream sources ----------------------------------------------------------
+// Reply traffic as the dongle sends it: input banks, hold blocks, heartbeats
+// and write acks, register values pseudo-random.
+static void gen_frames(std::mt19937 &rng, size_t n, Bytes &out, std::vector<uint16_t> *crcs) {
+    uint8_t  f[512];
+    uint16_t regs[LUX_RESP_MAX_REGS];
+    for (size_t i = 0; i < n; i++) {
+        int len;
+        unsigned kind = rng() % 100;
+        for (auto &r : regs) r = (uint16_t)rng();
+        if (kind < 70)
+            len = lux_build_read_resp(f, LUX_FN_READ_INPUT, (const uint8_t *)INVERTER_SN,
+                                      (uint16_t)(40 * (rng() % 5)), regs, 40, (uint8_t)i);
+        else if (kind < 85)
+            len = lux_build_read_resp(f, LUX_FN_READ_HOLD, (const uint8_t *)INVERTER_SN,
+                                      (uint16_t)(40 * (rng() % 3)), regs, 40 + rng() % 41, (uint8_t)i);
+        else if (kind < 95)
+            len = lux_build_heartbeat(f);
+        else
+            len = lux_build_write_single(f, (uint16_t)(rng() % 200), (uint16_t)rng(), (uint8_t)i);
+        out.insert(out.end(), f, f + len);
+        if (crcs) crcs->push_back(lux_crc16(f, len));
+    }
+}
+
+// tools/relay.py / lux_proxy.py hex dumps: "    0000  A1 1A 02 ...  ascii"
+static bool load_log(const char *path, Bytes &out) {
+    FILE *fp = std::fopen(path, "r");
+    if (!fp) { std::perror(path); return false; }
+    char line[256];
+    while (std::fgets(line, sizeof(line), fp)) {
+        unsigned off;
+        if (std::strncmp(line, "    ", 4) != 0 || std::sscanf(line + 4, "%4x", &off) != 1) continue;
+        if (std::strlen(line) < 10 || line[8] != ' ' || line[9] != ' ') continue;
+        for (int k = 0; k < 16; k++) {
+            const char *h = line + 10 + k * 3;
+            unsigned b;
+            if (h[0] == ' ' || h[0] == '\n' || h[0] == 0 || std::sscanf(h, "%2x", &b) != 1) break;
+            out.push_back((uint8_t)b);
+        }
+    }
+    std::fclose(fp);
+    return true;
+}
+
+static std::vector<size_t> segmentation(std::mt19937 &rng, size_t total) {
+    std::vector<size_t> seg;
+    while (total) {
+        // Mostly small reads like the hub sees, sometimes a full segment
+        size_t s = rng() % 4 ? 1 + rng() % 160 : 1 + rng() % TCP_MSS;
+        if (s > total) s = total;
+        seg.push_back(s);
+        total -= s;
+    }
+    return seg;
+}
+
+// ---- Targets -----------------------------------------------------------------
+struct Counts {
+    uint64_t frames = 0;     // framed
+    uint64_t valid = 0;      // passed the parser's own checks
+    uint64_t regs = 0;
+    std::vector<uint16_t> crcs;   // of every framed frame, when recording
+    bool record = false;
+
+    void frame(const uint8_t *p, size_t len) {
+        frames++;
+        if (record) crcs.push_back(lux_crc16(p, len));
+    }
+};
+
+struct HubTarget {
+    LuxRingBuffer<HUB_RING> rx;
+    uint8_t scratch[HUB_MAX_FRAME];
+    Counts  c;
+
+    // process_packet_: heartbeat, else CRC over df and a register payload
+    void process(const uint8_t *buf, size_t len) {
+        c.frame(buf, len);
+        if (len < 8) return;
+        if (buf[7] == LUX_HEARTBEAT) { c.valid++; return; }
+        if (buf[7] != LUX_TCP_FN || len < 22) return;
+        const uint8_t *df = buf + 20;
+        size_t df_len = len - 22;
+        if (lux_crc16(df, df_len) != (uint16_t)(buf[len-2] | (buf[len-1] << 8))) return;
+        if (df_len < 14) return;
+        c.valid++;
+        if ((df[1] == LUX_FN_READ_INPUT || df[1] == LUX_FN_READ_HOLD) && df_len >= 15 &&
+            df_len >= (size_t)15 + df[14])
+            c.regs += df[14] / 2;
+    }
+
+    void feed(const uint8_t *d, size_t n) {
+        while (n) {
+            uint8_t *w;
+            size_t span = rx.write_span(&w);
+            if (span > n) span = n;
+            std::memcpy(w, d, span);
+            rx.commit(span);
+            d += span;
+            n -= span;
+            const uint8_t *p;
+            size_t len;
+            LuxFrameStep st;
+            while ((st = lux_next_frame(rx, scratch, HUB_MAX_FRAME, &p, &len)) != LuxFrameStep::NEED_MORE) {
+                if (st != LuxFrameStep::FRAME) continue;
+                process(p, len);
+                rx.consume(len);
+            }
+            if (span == 0) rx.clear();   // cannot happen: a frame always fits
+        }
+    }
+};
+
+struct DongleTarget {
+    uint8_t fb[DONGLE_BUF];
+    size_t  fb_len = 0;
+    Counts  c;
+
+    static void emit(void *ctx, const uint8_t *frame, size_t len) {
+        DongleTarget *t = (DongleTarget *)ctx;
+        t->c.frame(frame, len);
+        if (len >= 8 && frame[7] == LUX_HEARTBEAT) { t->c.valid++; return; }
+        lux_parsed_t p = lux_parse(frame, len);
+        if (p.type == LUX_PKT_UNKNOWN || !p.crc_ok) return;
+        t->c.valid++;
+        uint16_t start, regs[LUX_RESP_MAX_REGS];
+        t->c.regs += lux_resp_regs(&p, &start, regs, LUX_RESP_MAX_REGS);
+    }
+
+    void feed(const uint8_t *d, size_t n) {
+        lux_frame_feed(fb, &fb_len, DONGLE_BUF, d, n, emit, this);
+    }
+};
+
+static void arduino_decode(const uint8_t *d, size_t n, Counts &c) {
+    static LuxData lux;   // big; the sketch keeps one too
+    c.frames++;
+    if (lux.decode(d, (uint16_t)n)) c.valid++;
+}
+
+// ---- Timing --------------------------------------------------------------------
+static double now_s() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<class F>
+static void report(const char *name, const Bytes &s, int iters, const Counts &c, F run) {
+    double t0 = now_s();
+    for (int i = 0; i < iters; i++) run();
+    double dt = now_s() - t0;
+    std::printf("%-8s %9.0f frames/s %8.1f MB/s   frames=%llu valid=%llu regs=%llu\n", name,
+                c.frames / dt, (double)s.size() * iters / dt / 1e6,
+                (unsigned long long)c.frames / iters, (unsigned long long)c.valid / iters,
+                (unsigned long long)c.regs / iters);
+}
+
+// ---- Fuzz ------------------------------------------------------------------------
+static void mutate(std::mt19937 &rng, Bytes &b) {
+    int ops = 1 + rng() % 8;
+    for (int k = 0; k < ops && !b.empty(); k++) {
+        size_t at = rng() % b.size();
+        switch (rng() % 6) {
+            case 0: b[at] ^= (uint8_t)(1u << (rng() % 8)); break;
+            case 1: b.insert(b.begin() + at, (uint8_t)rng()); break;
+            case 2: b.erase(b.begin() + at, b.begin() + std::min(b.size(), at + 1 + rng() % 40)); break;
+            case 3: {   // rewrite the length field of the next magic
+                for (size_t i = at; i + 5 < b.size(); i++)
+                    if (b[i] == LUX_MAGIC_0 && b[i+1] == LUX_MAGIC_1) {
+                        uint16_t v = rng() % 3 ? (uint16_t)rng() : (uint16_t)(rng() % 16);
+                        b[i+4] = v & 0xFF;
+                        b[i+5] = v >> 8;
+                        break;
+                    }
+                break;
+            }
+            case 4: {   // fake magic + header fragment
+                uint8_t fake[6] = {LUX_MAGIC_0, LUX_MAGIC_1, 0x02, 0x00, (uint8_t)rng(), (uint8_t)(rng() % 5)};
+                b.insert(b.begin() + at, fake, fake + 2 + rng() % 5);
+                break;
+            }
+            case 5: b.resize(at); break;   // truncate
+        }
+    }
+}
+
+// The last `need` frames each framer saw must be the tail's last `need`
+static bool tail_ok(const std::vector<uint16_t> &got, const std::vector<uint16_t> &tail, size_t need) {
+    if (got.size() < need) return false;
+    return std::equal(tail.end() - need, tail.end(), got.end() - need);
+}
+
+static int fuzz(std::mt19937 &rng, int rounds) {
+    const size_t TAIL = 32, NEED = 16;
+    int fails = 0;
+    for (int r = 0; r < rounds; r++) {
+        Bytes s, mid, tail;
+        std::vector<uint16_t> tail_crcs;
+        gen_frames(rng, 1 + rng() % 4, s, nullptr);
+        gen_frames(rng, 1 + rng() % 6, mid, nullptr);
+        if (rng() % 8 == 0) { mid.resize(rng() % 1500); for (auto &x : mid) x = (uint8_t)rng(); }
+        mutate(rng, mid);
+        s.insert(s.end(), mid.begin(), mid.end());
+        gen_frames(rng, TAIL, tail, &tail_crcs);
+        s.insert(s.end(), tail.begin(), tail.end());
+
+        HubTarget    hub;    hub.c.record = true;
+        DongleTarget dongle; dongle.c.record = true;
+        std::vector<size_t> seg = segmentation(rng, s.size());
+        size_t off = 0;
+        for (size_t n : seg) {
+            hub.feed(s.data() + off, n);
+            dongle.feed(s.data() + off, n);
+            off += n;
+        }
+        bool hub_ok = tail_ok(hub.c.crcs, tail_crcs, NEED);
+        bool dongle_ok = tail_ok(dongle.c.crcs, tail_crcs, NEED);
+        if (!hub_ok || !dongle_ok) {
+            if (fails++ < 5)
+                std::printf("fuzz round %d: lost the clean tail (hub %s, dongle %s)\n", r,
+                            hub_ok ? "ok" : "FAIL", dongle_ok ? "ok" : "FAIL");
+        }
+
+        // Arduino: random slices of the mutated region, plus short prefixes
+        Counts ac;
+        for (int k = 0; k < 16 && !mid.empty(); k++) {
+            size_t a = rng() % mid.size();
+            size_t n = std::min(mid.size() - a, (size_t)(rng() % 512));
+            Bytes slice(mid.begin() + a, mid.begin() + a + n);   // exact-size heap copy
+            arduino_decode(slice.data(), slice.size(), ac);
+        }
+        Bytes prefix(tail.begin(), tail.begin() + rng() % 48);
+        arduino_decode(prefix.data(), prefix.size(), ac);
+    }
+    std::printf("fuzz: %d rounds, %d failures\n", rounds, fails);
+    return fails;
+}
+
+int main(int argc, char **argv) {
+    const char *log = nullptr;
+    int fuzz_rounds = 0, iters = 20;
+    size_t nframes = 20000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--fuzz") && i + 1 < argc)        fuzz_rounds = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--iters") && i + 1 < argc)  iters = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc) nframes = (size_t)std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--seed") && i + 1 < argc)   seed = (unsigned)std::atoi(argv[++i]);
+        else log = argv[i];
+    }
+    std::mt19937 rng(seed);
+
+    Bytes s;
+    std::vector<uint16_t> ref;
+    if (log) {
+        if (!load_log(log, s)) return 1;
+    } else {
+        gen_frames(rng, nframes, s, &ref);
+    }
+    std::vector<size_t> seg = segmentation(rng, s.size());
+    std::printf("stream: %zu bytes in %zu segments (%s)\n", s.size(), seg.size(),
+                log ? log : "synthetic");
+
+    // Frame boundaries for the Arduino pass (one recv() = one reply)
+    std::vector<std::pair<size_t, size_t>> frames;
+    {
+        LuxRingBuffer<HUB_RING> rx;
+        uint8_t scratch[HUB_MAX_FRAME];
+        size_t  off = 0, pos = 0;
+        for (;;) {
+            uint8_t *w;
+            size_t span = std::min(rx.write_span(&w), s.size() - pos);
+            std::memcpy(w, s.data() + pos, span);
+            rx.commit(span);
+            pos += span;
+            const uint8_t *p;
+            size_t len;
+            LuxFrameStep st = lux_next_frame(rx, scratch, HUB_MAX_FRAME, &p, &len);
+            if (st == LuxFrameStep::NEED_MORE) {
+                if (span == 0) break;
+                continue;
+            }
+            if (st == LuxFrameStep::FRAME) {
+                frames.push_back({off, len});
+                rx.consume(len);
+            }
+            off += st == LuxFrameStep::OVERSIZE ? 2 : len;
+        }
+    }
+
+    HubTarget hub;
+    report("hub", s, iters, hub.c, [&] {
+        size_t off = 0;
+        for (size_t n : seg) { hub.feed(s.data() + off, n); off += n; }
+    });
+    DongleTarget dongle;
+    report("dongle", s, iters, dongle.c, [&] {
+        size_t off = 0;
+        for (size_t n : seg) { dongle.feed(s.data() + off, n); off += n; }
+    });
+    Counts ac;
+    report("arduino", s, iters, ac, [&] {
+        for (auto &f : frames) arduino_decode(s.data() + f.first, f.second, ac);
+    });
+
+    int rc = 0;
+    if (hub.c.frames != dongle.c.frames || hub.c.valid != dongle.c.valid) {
+        std::printf("MISMATCH: hub and dongle framed differently\n");
+        rc = 1;
+    }
+    if (!log && hub.c.frames / iters != ref.size()) {
+        std::printf("MISMATCH: %zu frames generated\n", ref.size());
+        rc = 1;
+    }
+    if (fuzz_rounds) rc |= fuzz(rng, fuzz_rounds) != 0;
+    return rc;
+}
@@ -0,0 +1,105 @@
+// Host benchmark: registermap.h lookups, linear scan vs compile-time index
+//
+// Build & run (from repo root):
+//   g++ -O2 -std=c++17 -I tools tools/bench/bench_regmap.cpp -o /tmp/bench_regmap
+//   /tmp/bench_regmap
+//
+// "snapshot" decodes a full 240-register INPUT image the way a generic
+// publisher would: look up every address, skip undefined/reserved ones,
+// scale the rest (plus the working-state name for reg 0). "validate" checks
+// a write against every HOLD address 0..261.
+
+#include "registermap.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// ---- Reference: the linear scans the header used before -------------------
+static const LuxRegDef *scan_input(uint16_t addr) {
+    for (uint16_t i = 0; i < LUX_INPUT_REG_COUNT; i++)
+        if (LUX_INPUT_REGS[i].addr == addr) return &LUX_INPUT_REGS[i];
+    return nullptr;
+}
+
+static const LuxRegDef *scan_hold(uint16_t addr) {
+    for (uint16_t i = 0; i < LUX_HOLD_REG_COUNT; i++)
+        if (LUX_HOLD_REGS[i].addr == addr) return &LUX_HOLD_REGS[i];
+    return nullptr;
+}
+
+static const char *scan_state(uint16_t code) {
+    for (uint16_t i = 0; i < LUX_STATE_COUNT; i++)
+        if (LUX_STATES[i].code == code) return LUX_STATES[i].name;
+    return "Unknown";
+}
+
+typedef const LuxRegDef *(*find_fn)(uint16_t);
+typedef const char *(*state_fn)(uint16_t);
+
+static float decode_one(const LuxRegDef *d, const uint16_t *regs) {
+    uint16_t lo = regs[d->addr];
+    switch (d->val_type) {
+        case VAL_S16: return (int16_t)lo * d->scale;
+        case VAL_U32: return lux_combine_u32(lo, regs[d->addr + 1]) * d->scale;
+        default:      return lo * d->scale;
+    }
+}
+
+static float decode_snapshot(find_fn find, state_fn state, const uint16_t *regs) {
+    float acc = 0;
+    for (uint16_t a = 0; a < 240; a++) {
+        const LuxRegDef *d = find(a);
+        if (!d || d->val_type == VAL_SKIP) continue;
+        acc += decode_one(d, regs);
+    }
+    acc += state(regs[0])[0];
+    return acc;
+}
+
+static unsigned validate_all(find_fn find, int16_t v) {
+    unsigned ok = 0;
+    for (uint16_t a = 0; a < 262; a++) ok += lux_validate_write(find(a), v);
+    return ok;
+}
+
+static volatile float g_sink;
+
+template <typename F>
+static double bench(F fn, size_t iters) {
+    float acc = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iters; i++) acc += fn(i);
+    auto t1 = std::chrono::steady_clock::now();
+    g_sink = acc;
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+int main() {
+    static uint16_t imgs[64][241];
+    srand(7);
+    for (auto &img : imgs)
+        for (auto &w : img) w = (uint16_t)rand();
+    for (auto &img : imgs) img[0] = LUX_STATES[rand() % LUX_STATE_COUNT].code;
+
+    // Correctness: same definition (pointer) for every address either way
+    for (uint16_t a = 0; a < 1024; a++) {
+        if (lux_find_input(a) != scan_input(a) || lux_find_hold(a) != scan_hold(a) ||
+            lux_state_name(a) != scan_state(a)) {
+            printf("MISMATCH addr %u\n", a);
+            return 1;
+        }
+    }
+
+    const size_t iters = 200000;
+    double ls = bench([&](size_t i) { return decode_snapshot(scan_input, scan_state, imgs[i & 63]); }, iters);
+    double is = bench([&](size_t i) { return decode_snapshot(lux_find_input, lux_state_name, imgs[i & 63]); }, iters);
+    double lv = bench([&](size_t i) { return (float)validate_all(scan_hold, (int16_t)(i & 1023)); }, iters);
+    double iv = bench([&](size_t i) { return (float)validate_all(lux_find_hold, (int16_t)(i & 1023)); }, iters);
+
+    printf("%u INPUT defs, %u HOLD defs\n", LUX_INPUT_REG_COUNT, LUX_HOLD_REG_COUNT);
+    printf("%-10s %12s %12s %9s\n", "op", "linear ns", "index ns", "speedup");
+    printf("%-10s %12.1f %12.1f %8.1fx\n", "snapshot", ls, is, ls / is);
+    printf("%-10s %12.1f %12.1f %8.1fx\n", "validate", lv, iv, lv / iv);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+// Minimal Arduino core for building Arduino/LuxParser.cpp on a PC
+// (tools/bench/bench_parsers.cpp). Only what the parser touches: String
+// built on std::string and a millis() from the steady clock.
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+class String {
+  public:
+    String() {}
+    String(const char *s) : s_(s ? s : "") {}
+    explicit String(int v) : s_(std::to_string(v)) {}
+    explicit String(unsigned v) : s_(std::to_string(v)) {}
+    explicit String(long v) : s_(std::to_string(v)) {}
+    explicit String(unsigned long v) : s_(std::to_string(v)) {}
+
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    const char *c_str() const { return s_.c_str(); }
+
+    String &operator+=(const String &o) { s_ += o.s_; return *this; }
+    friend String operator+(String a, const String &b) { return a += b; }
+    friend String operator+(String a, const char *b) { return a += String(b); }
+    friend String operator+(const char *a, const String &b) { return String(a) += b; }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+
+  private:
+    std::string s_;
+};
+
+inline unsigned long millis() {
+    using namespace std::chrono;
+    return (unsigned long)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
@@ -17,6 +17,7 @@
 //   const LuxRegDef* def = lux_find_input(5);   // find INPUT reg 5
 //   const LuxRegDef* def = lux_find_hold(105);  // find HOLD reg 105
 //   const char* s = lux_state_name(reg0_val);   // decode working state
+// Lookups go through compile-time address index tables (O(1)); C++14.
 // =============================================================================
 
 #pragma once
@@ -82,7 +83,7 @@ struct LuxRegDef {
 // Organised into bulk read blocks — see LUX_READ_BLOCKS below
 // =============================================================================
 
-static const LuxRegDef LUX_INPUT_REGS[] = {
+static constexpr LuxRegDef LUX_INPUT_REGS[] = {
 // addr  type       val_type  access  scale     unit    mqtt_name             friendly_name                    min   max   poll
 
 // ── BLOCK IN_A: 0–39 — Core real-time (5s poll) ──────────────────────────────
@@ -225,7 +226,7 @@ static const LuxRegDef LUX_INPUT_REGS[] = {
 // HOLD REGISTERS (FC03 read / FC06 write)
 // =============================================================================
 
-static const LuxRegDef LUX_HOLD_REGS[] = {
+static constexpr LuxRegDef LUX_HOLD_REGS[] = {
 // addr  type      val_type   access  scale     unit    mqtt_name              friendly_name                    min    max   poll
 
 // ── Boot: Firmware / Identity (read once) ────────────────────────────────────
@@ -668,7 +669,7 @@ struct LuxStateDef {
     const char* name;
 };
 
-static const LuxStateDef LUX_STATES[] = {
+static constexpr LuxStateDef LUX_STATES[] = {
     { 0x00, "Standby" },
     { 0x01, "Fault" },
     { 0x02, "Programming" },
@@ -690,11 +691,62 @@ static const LuxStateDef LUX_STATES[] = {
 // SIZE CONSTANTS
 // =============================================================================
 
-static const uint16_t LUX_INPUT_REG_COUNT  = sizeof(LUX_INPUT_REGS)  / sizeof(LuxRegDef);
-static const uint16_t LUX_HOLD_REG_COUNT   = sizeof(LUX_HOLD_REGS)   / sizeof(LuxRegDef);
+static constexpr uint16_t LUX_INPUT_REG_COUNT = sizeof(LUX_INPUT_REGS)  / sizeof(LuxRegDef);
+static constexpr uint16_t LUX_HOLD_REG_COUNT  = sizeof(LUX_HOLD_REGS)   / sizeof(LuxRegDef);
 static const uint16_t LUX_READ_BLOCK_COUNT = sizeof(LUX_READ_BLOCKS)  / sizeof(LuxReadBlock);
 static const uint16_t LUX_BITMAP_BIT_COUNT = sizeof(LUX_BITMAP_BITS)  / sizeof(LuxBitDef);
-static const uint16_t LUX_STATE_COUNT      = sizeof(LUX_STATES)       / sizeof(LuxStateDef);
+static constexpr uint16_t LUX_STATE_COUNT    = sizeof(LUX_STATES)       / sizeof(LuxStateDef);
+
+// =============================================================================
+// ADDRESS INDEX TABLES (built at compile time)
+// Sparse address → dense table position, so lookups are one array load
+// instead of a scan. LUX_IDX_NONE marks addresses with no definition.
+// Needs C++14 (loops in constexpr functions).
+// =============================================================================
+
+static constexpr uint8_t LUX_IDX_NONE = 0xFF;
+
+template <uint16_t N>
+struct LuxAddrIndex {
+    uint8_t pos[N];
+};
+
+template <uint16_t N>
+constexpr uint16_t lux_addr_span(const LuxRegDef (&defs)[N]) {
+    uint16_t hi = 0;
+    for (uint16_t i = 0; i < N; i++)
+        if (defs[i].addr >= hi) hi = defs[i].addr + 1;
+    return hi;
+}
+
+// First definition wins, same as the old linear scan
+template <uint16_t SPAN, uint16_t N>
+constexpr LuxAddrIndex<SPAN> lux_build_addr_index(const LuxRegDef (&defs)[N]) {
+    LuxAddrIndex<SPAN> ix{};
+    for (uint16_t a = 0; a < SPAN; a++) ix.pos[a] = LUX_IDX_NONE;
+    for (uint16_t i = N; i-- > 0;) ix.pos[defs[i].addr] = (uint8_t)i;
+    return ix;
+}
+
+static constexpr uint16_t LUX_INPUT_ADDR_SPAN = lux_addr_span(LUX_INPUT_REGS);
+static constexpr uint16_t LUX_HOLD_ADDR_SPAN  = lux_addr_span(LUX_HOLD_REGS);
+static_assert(LUX_INPUT_REG_COUNT < LUX_IDX_NONE, "INPUT table too large for uint8_t index");
+static_assert(LUX_HOLD_REG_COUNT  < LUX_IDX_NONE, "HOLD table too large for uint8_t index");
+
+static constexpr LuxAddrIndex<LUX_INPUT_ADDR_SPAN> LUX_INPUT_INDEX =
+    lux_build_addr_index<LUX_INPUT_ADDR_SPAN>(LUX_INPUT_REGS);
+static constexpr LuxAddrIndex<LUX_HOLD_ADDR_SPAN> LUX_HOLD_INDEX =
+    lux_build_addr_index<LUX_HOLD_ADDR_SPAN>(LUX_HOLD_REGS);
+
+// Working-state codes are one byte; anything above is "Unknown"
+constexpr LuxAddrIndex<256> lux_build_state_index() {
+    LuxAddrIndex<256> ix{};
+    for (uint16_t c = 0; c < 256; c++) ix.pos[c] = LUX_IDX_NONE;
+    for (uint16_t i = LUX_STATE_COUNT; i-- > 0;)
+        if (LUX_STATES[i].code < 256) ix.pos[LUX_STATES[i].code] = (uint8_t)i;
+    return ix;
+}
+static constexpr LuxAddrIndex<256> LUX_STATE_INDEX = lux_build_state_index();
 
 // =============================================================================
 // HELPER FUNCTIONS (inline, header-only)
@@ -702,23 +754,23 @@ static const uint16_t LUX_STATE_COUNT      = sizeof(LUX_STATES)       / sizeof(L
 
 // Find INPUT register definition by Modbus address
 inline const LuxRegDef* lux_find_input(uint16_t addr) {
-    for (uint16_t i = 0; i < LUX_INPUT_REG_COUNT; i++)
-        if (LUX_INPUT_REGS[i].addr == addr) return &LUX_INPUT_REGS[i];
-    return nullptr;
+    if (addr >= LUX_INPUT_ADDR_SPAN) return nullptr;
+    uint8_t i = LUX_INPUT_INDEX.pos[addr];
+    return i == LUX_IDX_NONE ? nullptr : &LUX_INPUT_REGS[i];
 }
 
 // Find HOLD register definition by Modbus address
 inline const LuxRegDef* lux_find_hold(uint16_t addr) {
-    for (uint16_t i = 0; i < LUX_HOLD_REG_COUNT; i++)
-        if (LUX_HOLD_REGS[i].addr == addr) return &LUX_HOLD_REGS[i];
-    return nullptr;
+    if (addr >= LUX_HOLD_ADDR_SPAN) return nullptr;
+    uint8_t i = LUX_HOLD_INDEX.pos[addr];
+    return i == LUX_IDX_NONE ? nullptr : &LUX_HOLD_REGS[i];
 }
 
 // Decode Working State code to string
 inline const char* lux_state_name(uint16_t code) {
-    for (uint16_t i = 0; i < LUX_STATE_COUNT; i++)
-        if (LUX_STATES[i].code == code) return LUX_STATES[i].name;
-    return "Unknown";
+    if (code >= 256) return "Unknown";
+    uint8_t i = LUX_STATE_INDEX.pos[code];
+    return i == LUX_IDX_NONE ? "Unknown" : LUX_STATES[i].name;
 }
 
 // Decode packed time register → hour and minute
@@ -873,4 +925,4 @@ inline bool lux_validate_write(const LuxRegDef* def, int16_t raw_val) {
     if (def->min_raw != -1 && raw_val < def->min_raw) return false;
     if (def->max_raw != -1 && raw_val > def->max_raw) return false;
     return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,342 @@
+// Host replayer for frame captures taken by the dongle firmware
+// (esp32_dongle/main/lux_capture.c, downloaded from http://luxdongle.local:8080/capture)
+//
+// Build & run (from repo root):
+//   g++ -O2 -std=c++17 -I components/luxpower_sna -I esp32_dongle/main tools/sim/lux_replay.cpp -o /tmp/lux_replay
+//   curl -o /tmp/luxdongle.cap http://luxdongle.local:8080/capture
+//   /tmp/lux_replay /tmp/luxdongle.cap --print          # list the records
+//   /tmp/lux_replay /tmp/luxdongle.cap --speed 10       # parse at 10x capture speed
+//   /tmp/lux_replay /tmp/luxdongle.cap --serve 8000     # play to a client (e.g. the hub)
+//
+// Replay (default)
+//   Every record goes, in capture order and with its captured spacing divided
+//   by --speed (0 = no waiting), through both receive paths, one framer per
+//   direction tag so streams don't mix:
+//     hub      lux_next_frame() over LuxRingBuffer + process_packet_'s checks
+//     dongle   lux_frame_feed() (lux_netloop.c reassembly) + lux_parse()
+//   A record is one frame as the dongle framed it, so each path must emit
+//   exactly one frame per record; differences are reported as mismatches.
+//   The summary gives per-tag frame / valid / register counts and the time
+//   spent inside the parsers.
+//
+// --serve PORT
+//   Waits for a TCP client and writes the frames of --tags (default 0,3: what
+//   the real dongle sent) to it with the captured timing, reading and
+//   discarding whatever the client sends. Loops with --loop.
+//
+// File format: "LUXCAP01", then per record u32 t_ms | u8 tag | u8 0 |
+// u16 len | frame, little-endian (lux_capture.h).
+
+#include "lux_ring_buffer.h"
+#include "lux_proto.h"
+#include "lux_capture.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using esphome::luxpower_sna::LuxFrameStep;
+using esphome::luxpower_sna::LuxRingBuffer;
+using esphome::luxpower_sna::lux_next_frame;
+
+namespace {
+
+const size_t HUB_RING      = 1024;   // LUX_RX_RING_SIZE
+const size_t HUB_MAX_FRAME = 320;    // LUX_MAX_FRAME
+const size_t DONGLE_BUF    = 1024;   // NET_BUF_SIZE
+const int    NUM_TAGS      = 4;
+
+const char *const TAG_NAMES[NUM_TAGS] = {
+    "dongle->cloud", "cloud->dongle", "client->local", "dongle->local",
+};
+
+struct Record {
+    uint32_t             t_ms;
+    uint8_t              tag;
+    std::vector<uint8_t> frame;
+};
+
+struct Options {
+    std::string file;
+    double      speed = 1.0;
+    bool        print = false;
+    int         serve = 0;
+    bool        loop  = false;
+    unsigned    tags  = (1u << LUX_CAP_DONGLE_TO_CLOUD) | (1u << LUX_CAP_DONGLE_TO_LOCAL);
+} opt;
+
+// ---- Capture file -------------------------------------------------------------
+bool load(const std::string &path, std::vector<Record> &out) {
+    FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) { std::perror(path.c_str()); return false; }
+    std::vector<uint8_t> d;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) d.insert(d.end(), buf, buf + n);
+    std::fclose(f);
+
+    if (d.size() < LUX_CAP_MAGIC_LEN || std::memcmp(d.data(), LUX_CAP_MAGIC, LUX_CAP_MAGIC_LEN) != 0) {
+        std::fprintf(stderr, "%s: not a LUXCAP01 capture\n", path.c_str());
+        return false;
+    }
+    size_t pos = LUX_CAP_MAGIC_LEN;
+    while (pos + LUX_CAP_REC_HDR <= d.size()) {
+        const uint8_t *h = &d[pos];
+        size_t len = h[6] | (h[7] << 8);
+        if (h[4] >= NUM_TAGS || pos + LUX_CAP_REC_HDR + len > d.size()) break;
+        Record r;
+        r.t_ms = h[0] | (h[1] << 8) | (h[2] << 16) | ((uint32_t)h[3] << 24);
+        r.tag  = h[4];
+        r.frame.assign(h + LUX_CAP_REC_HDR, h + LUX_CAP_REC_HDR + len);
+        out.push_back(std::move(r));
+        pos += LUX_CAP_REC_HDR + len;
+    }
+    if (pos != d.size())
+        std::fprintf(stderr, "%s: %zu trailing bytes after record %zu ignored\n",
+                     path.c_str(), d.size() - pos, out.size());
+    return true;
+}
+
+// Wait until `rel_ms` (capture time since the first record) at --speed
+void pace(std::chrono::steady_clock::time_point start, uint32_t rel_ms) {
+    if (opt.speed <= 0) return;
+    std::this_thread::sleep_until(start + std::chrono::microseconds((int64_t)(rel_ms * 1000.0 / opt.speed)));
+}
+
+// ---- --print --------------------------------------------------------------------
+void print_records(const std::vector<Record> &recs) {
+    uint32_t t0 = recs.empty() ? 0 : recs[0].t_ms;
+    for (const Record &r : recs) {
+        const uint8_t *f = r.frame.data();
+        size_t len = r.frame.size();
+        std::printf("%9.3f  %-13s %4zuB  ", (r.t_ms - t0) / 1000.0, TAG_NAMES[r.tag], len);
+        lux_parsed_t p = lux_parse(f, len);
+        if (len >= 8 && f[7] == LUX_HEARTBEAT) {
+            std::printf("heartbeat\n");
+        } else if (p.type == LUX_PKT_UNKNOWN) {
+            std::printf("unparsed\n");
+        } else {
+            uint16_t start, regs[LUX_RESP_MAX_REGS];
+            uint16_t n = lux_resp_regs(&p, &start, regs, LUX_RESP_MAX_REGS);
+            std::printf("fn=%02X act=%u reg=%u %s=%u%s\n", p.dev_fn, p.df[0], p.reg,
+                        n ? "regs" : "value", n ? n : p.value, p.crc_ok ? "" : " BAD-CRC");
+        }
+    }
+}
+
+// ---- Replay through the parsers -------------------------------------------------
+struct Counts {
+    uint64_t frames = 0, valid = 0, regs = 0;
+};
+
+// One hub receive path: LuxRingBuffer + lux_next_frame, then the checks
+// process_packet_ makes before it dispatches a frame
+struct HubPath {
+    LuxRingBuffer<HUB_RING> rx;
+    uint8_t scratch[HUB_MAX_FRAME];
+    Counts  c;
+
+    void process(const uint8_t *buf, size_t len) {
+        c.frames++;
+        if (len < 8) return;
+        if (buf[7] == LUX_HEARTBEAT) { c.valid++; return; }
+        if (buf[7] != LUX_TCP_FN || len < 22) return;
+        const uint8_t *df = buf + 20;
+        size_t df_len = len - 22;
+        if (lux_crc16(df, df_len) != (uint16_t)(buf[len-2] | (buf[len-1] << 8))) return;
+        if (df_len < 14) return;
+        c.valid++;
+        if ((df[1] == LUX_FN_READ_INPUT || df[1] == LUX_FN_READ_HOLD) && df_len >= 15 &&
+            df_len >= (size_t)15 + df[14])
+            c.regs += df[14] / 2;
+    }
+
+    void feed(const uint8_t *d, size_t n) {
+        while (n) {
+            uint8_t *w;
+            size_t span = rx.write_span(&w);
+            if (span > n) span = n;
+            std::memcpy(w, d, span);
+            rx.commit(span);
+            d += span;
+            n -= span;
+            const uint8_t *p;
+            size_t len;
+            LuxFrameStep st;
+            while ((st = lux_next_frame(rx, scratch, HUB_MAX_FRAME, &p, &len)) != LuxFrameStep::NEED_MORE) {
+                if (st != LuxFrameStep::FRAME) continue;
+                process(p, len);
+                rx.consume(len);
+            }
+            if (span == 0) rx.clear();
+        }
+    }
+};
+
+// One dongle receive path: lux_frame_feed + lux_parse / lux_resp_regs
+struct DonglePath {
+    uint8_t fb[DONGLE_BUF];
+    size_t  fb_len = 0;
+    Counts  c;
+
+    static void emit(void *ctx, const uint8_t *frame, size_t len) {
+        DonglePath *t = (DonglePath *)ctx;
+        t->c.frames++;
+        if (len >= 8 && frame[7] == LUX_HEARTBEAT) { t->c.valid++; return; }
+        lux_parsed_t p = lux_parse(frame, len);
+        if (p.type == LUX_PKT_UNKNOWN || !p.crc_ok) return;
+        t->c.valid++;
+        uint16_t start, regs[LUX_RESP_MAX_REGS];
+        t->c.regs += lux_resp_regs(&p, &start, regs, LUX_RESP_MAX_REGS);
+    }
+
+    void feed(const uint8_t *d, size_t n) {
+        lux_frame_feed(fb, &fb_len, DONGLE_BUF, d, n, emit, this);
+    }
+};
+
+int replay(const std::vector<Record> &recs) {
+    static HubPath    hub[NUM_TAGS];
+    static DonglePath dongle[NUM_TAGS];
+    uint64_t records[NUM_TAGS] = {}, mismatches = 0;
+    double   parse_s = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t t0 = recs.empty() ? 0 : recs[0].t_ms;
+    for (const Record &r : recs) {
+        pace(start, r.t_ms - t0);
+        HubPath    &h = hub[r.tag];
+        DonglePath &g = dongle[r.tag];
+        uint64_t hf = h.c.frames, gf = g.c.frames;
+
+        auto p0 = std::chrono::steady_clock::now();
+        h.feed(r.frame.data(), r.frame.size());
+        g.feed(r.frame.data(), r.frame.size());
+        parse_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - p0).count();
+
+        records[r.tag]++;
+        if (h.c.frames - hf != 1 || g.c.frames - gf != 1) mismatches++;
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-13s %8s %17s %17s\n", "", "records", "hub frames/valid", "dongle frames/valid");
+    uint64_t total = 0;
+    for (int t = 0; t < NUM_TAGS; t++) {
+        if (!records[t]) continue;
+        total += records[t];
+        std::printf("%-13s %8llu %8llu/%-8llu %8llu/%-8llu regs=%llu\n", TAG_NAMES[t],
+                    (unsigned long long)records[t],
+                    (unsigned long long)hub[t].c.frames, (unsigned long long)hub[t].c.valid,
+                    (unsigned long long)dongle[t].c.frames, (unsigned long long)dongle[t].c.valid,
+                    (unsigned long long)dongle[t].c.regs);
+    }
+    std::printf("%llu records in %.3f s (captured span %.3f s), parsers %.3f ms"
+                " (%.0f records/s), %llu mismatches\n",
+                (unsigned long long)total, wall,
+                recs.empty() ? 0.0 : (recs.back().t_ms - t0) / 1000.0, parse_s * 1000,
+                parse_s > 0 ? total / parse_s : 0.0, (unsigned long long)mismatches);
+    return mismatches ? 1 : 0;
+}
+
+// ---- --serve --------------------------------------------------------------------
+int serve(const std::vector<Record> &recs) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(opt.serve);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(ls, (sockaddr *)&a, sizeof(a)) < 0 || listen(ls, 1) < 0) {
+        std::fprintf(stderr, "listen :%d: %s\n", opt.serve, std::strerror(errno));
+        return 1;
+    }
+    std::printf("serving %s on :%d\n", opt.file.c_str(), opt.serve);
+    std::fflush(stdout);
+
+    do {
+        int fd = accept(ls, nullptr, nullptr);
+        if (fd < 0) { std::perror("accept"); return 1; }
+        std::printf("client connected\n");
+        std::fflush(stdout);
+
+        size_t sent = 0;
+        bool   up   = true;
+        auto   start = std::chrono::steady_clock::now();
+        uint32_t t0 = recs.empty() ? 0 : recs[0].t_ms;
+        for (const Record &r : recs) {
+            if (!(opt.tags & (1u << r.tag))) continue;
+            pace(start, r.t_ms - t0);
+            // Drain what the client sends so its writes never block
+            pollfd p = {fd, POLLIN, 0};
+            uint8_t sink[1024];
+            while (poll(&p, 1, 0) > 0) {
+                if (read(fd, sink, sizeof(sink)) <= 0) { up = false; break; }
+            }
+            if (!up || write(fd, r.frame.data(), r.frame.size()) != (ssize_t)r.frame.size()) {
+                up = false;
+                break;
+            }
+            sent++;
+        }
+        std::printf("%s after %zu frames\n", up ? "capture done" : "client gone", sent);
+        std::fflush(stdout);
+        close(fd);
+    } while (opt.loop);
+    close(ls);
+    return 0;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: lux_replay FILE.cap [--speed X] [--print]\n"
+        "       lux_replay FILE.cap --serve PORT [--tags 0,3] [--speed X] [--loop]\n"
+        "  --speed 1 = captured timing, 10 = ten times faster, 0 = no waiting\n"
+        "  tags: 0 dongle->cloud  1 cloud->dongle  2 client->local  3 dongle->local\n");
+    std::exit(2);
+}
+
+void parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char * { if (i + 1 >= argc) usage(); return argv[++i]; };
+        if      (a == "--speed") opt.speed = std::atof(next());
+        else if (a == "--print") opt.print = true;
+        else if (a == "--serve") opt.serve = std::atoi(next());
+        else if (a == "--loop")  opt.loop  = true;
+        else if (a == "--tags") {
+            opt.tags = 0;
+            for (const char *s = next(); *s; s++)
+                if (*s >= '0' && *s < '0' + NUM_TAGS) opt.tags |= 1u << (*s - '0');
+        }
+        else if (a[0] == '-' || !opt.file.empty()) usage();
+        else opt.file = a;
+    }
+    if (opt.file.empty()) usage();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<Record> recs;
+    if (!load(opt.file, recs)) return 1;
+    std::printf("%s: %zu records\n", opt.file.c_str(), recs.size());
+
+    if (opt.print) { print_records(recs); return 0; }
+    if (opt.serve) return serve(recs);
+    return replay(recs);
+}
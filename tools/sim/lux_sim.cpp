@@ -0,0 +1,649 @@
+// Host simulator: LuxPower inverter + WiFi dongle, for running the hub, the
+// dongle firmware paths and tools against something on a PC.
+//
+// Build & run (from repo root):
+//   g++ -O2 -std=c++17 -I components/luxpower_sna tools/sim/lux_sim.cpp -o /tmp/lux_sim
+//   /tmp/lux_sim --pty --hb 30 --latency 40 --jitter 20
+//
+// What it serves
+//   :8000  (--local-port)  the dongle's local port: A1 1A translated-data
+//          requests fn 03/04/06/10 are answered from the register image and
+//          every client gets a heartbeat each --hb seconds. Point the hub's
+//          host / DONGLE_LOCAL_IP here.
+//   :4346  (--cloud-port)  same dialect on the cloud port, for lux_cloud.c
+//          (LUX_CLOUD_HOST = this machine).
+//   --relay HOST:PORT      also act as the dongle's cloud link: connect out
+//          (e.g. to lux_relay.c), send heartbeats, answer what comes back.
+//   --pty [PATH]           Modbus RTU slave (--slave ADDR) on a pseudo
+//          terminal; its path is printed, or symlinked to PATH.
+//
+// Fault injection (all replies, every transport)
+//   --latency MS --jitter MS   reply delay = latency + uniform(0, jitter)
+//   --split N --split-gap MS   TCP replies leave in N-byte pieces
+//   --crc-err P                corrupt the CRC of a fraction P of replies
+//   --drop P                   leave a fraction P of requests unanswered
+//
+// Register image: --image FILE with lines "input|hold REG[-REG] VALUE"
+// ('#' starts a comment). Without one a plausible default is loaded;
+// --vary moves a few live input registers every second. Writes (fn 06/10)
+// update the hold image.
+//
+// Ctrl-C (or every --stats S seconds) prints per-transport request counts,
+// injected faults, heartbeat echoes and request→reply latency.
+
+#include "lux_crc.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ---- Options ----------------------------------------------------------------
+struct Options {
+    int         local_port  = 8000;
+    int         cloud_port  = 4346;
+    std::string relay;                  // HOST:PORT, empty = off
+    bool        pty         = false;
+    std::string pty_link;
+    int         slave       = 1;
+    std::string image;
+    bool        vary        = false;
+    int         hb_s        = 0;        // 0 = no heartbeats
+    int         latency_ms  = 0;
+    int         jitter_ms   = 0;
+    int         split       = 0;        // 0 = whole frames
+    int         split_gap_ms = 2;
+    double      crc_err     = 0;
+    double      drop        = 0;
+    int         stats_s     = 0;
+    unsigned    seed        = 1;
+    std::string dongle_sn   = "SIMDONGLE0";
+};
+
+Options opt;
+
+constexpr size_t   REG_COUNT    = 1024;
+constexpr size_t   MAX_FRAME    = 600;
+constexpr uint8_t  TCP_HB       = 0xC1;
+constexpr uint8_t  TCP_DATA     = 0xC2;
+constexpr int64_t  RECONNECT_US = 5000000;
+
+uint16_t     g_input[REG_COUNT];
+uint16_t     g_hold[REG_COUNT];
+std::mt19937 g_rng;
+volatile sig_atomic_t g_stop = 0;
+volatile sig_atomic_t g_dump = 0;
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool chance(double p) {
+    return p > 0 && std::uniform_real_distribution<double>(0, 1)(g_rng) < p;
+}
+
+// ---- Statistics -------------------------------------------------------------
+struct Stats {
+    uint64_t requests = 0, replies = 0, dropped = 0, corrupted = 0, bad = 0;
+    uint64_t hb_sent = 0, hb_echoed = 0, writes = 0;
+    uint64_t lat_n = 0;
+    int64_t  lat_min = 0, lat_max = 0, lat_sum = 0;
+};
+
+std::map<std::string, Stats> g_stats;   // by transport: local / cloud / relay / rtu
+int64_t g_stats_since;
+
+void stats_latency(Stats &s, int64_t us) {
+    if (s.lat_n == 0 || us < s.lat_min) s.lat_min = us;
+    if (s.lat_n == 0 || us > s.lat_max) s.lat_max = us;
+    s.lat_sum += us;
+    s.lat_n++;
+}
+
+void stats_print() {
+    double secs = (now_us() - g_stats_since) / 1e6;
+    for (auto &kv : g_stats) {
+        const Stats &s = kv.second;
+        std::printf("%-5s req=%llu (%.1f/s) replies=%llu writes=%llu dropped=%llu "
+                    "crc_err=%llu bad=%llu hb=%llu/%llu echoed",
+                    kv.first.c_str(), (unsigned long long)s.requests,
+                    secs > 0 ? s.requests / secs : 0.0,
+                    (unsigned long long)s.replies, (unsigned long long)s.writes,
+                    (unsigned long long)s.dropped, (unsigned long long)s.corrupted,
+                    (unsigned long long)s.bad, (unsigned long long)s.hb_echoed,
+                    (unsigned long long)s.hb_sent);
+        if (s.lat_n)
+            std::printf(" latency min/avg/max=%.2f/%.2f/%.2f ms", s.lat_min / 1000.0,
+                        (double)s.lat_sum / s.lat_n / 1000.0, s.lat_max / 1000.0);
+        std::printf("\n");
+    }
+    std::fflush(stdout);
+}
+
+// ---- Register image ---------------------------------------------------------
+void image_defaults() {
+    // Bank 0 input registers with plausible values (scales per lux_regdecode.h)
+    g_input[0]  = 0x0010;                  // status: normal
+    g_input[1]  = 3500;  g_input[2] = 3400; // v_pv_1/2  350.0 / 340.0 V
+    g_input[4]  = 530;                     // v_bat 53.0 V
+    g_input[5]  = (98 << 8) | 85;          // soh 98 %, soc 85 %
+    g_input[7]  = 1200;  g_input[8] = 900; // p_pv_1/2 W
+    g_input[10] = 600;                     // p_charge W
+    g_input[12] = 2300;                    // v_ac_r 230.0 V
+    g_input[15] = 5000;                    // f_ac 50.00 Hz
+    g_input[16] = 1500;                    // p_inv W
+    g_input[26] = 0;     g_input[27] = 800; // p_to_grid / p_to_user W
+    for (size_t i = 40; i < 80; i += 2) g_input[i] = (uint16_t)(i * 37);  // energy totals
+    g_input[64] = 350;                     // t_inner 35 C
+    // Hold: a few settings the hub exposes as numbers/switches
+    g_hold[21]  = 0x0001;
+    g_hold[64]  = 100;  g_hold[65] = 100;  // charge / discharge rate %
+    g_hold[105] = 20;                      // EOD SOC %
+}
+
+bool image_load(const std::string &path) {
+    FILE *f = std::fopen(path.c_str(), "r");
+    if (!f) { std::perror(path.c_str()); return false; }
+    char line[256];
+    int  lineno = 0;
+    while (std::fgets(line, sizeof(line), f)) {
+        lineno++;
+        if (char *hash = std::strchr(line, '#')) *hash = 0;
+        char     bank[16];
+        unsigned a, b, v;
+        int      n = std::sscanf(line, "%15s %u-%u %u", bank, &a, &b, &v);
+        if (n != 4) {
+            n = std::sscanf(line, "%15s %u %u", bank, &a, &v);
+            if (n <= 0) continue;   // blank / comment
+            if (n != 3) { std::fprintf(stderr, "%s:%d: bad line\n", path.c_str(), lineno); continue; }
+            b = a;
+        }
+        uint16_t *img = std::strcmp(bank, "input") == 0 ? g_input
+                      : std::strcmp(bank, "hold") == 0  ? g_hold : nullptr;
+        if (!img || b < a || b >= REG_COUNT) {
+            std::fprintf(stderr, "%s:%d: bad bank or range\n", path.c_str(), lineno);
+            continue;
+        }
+        for (unsigned r = a; r <= b; r++) img[r] = (uint16_t)v;
+    }
+    std::fclose(f);
+    return true;
+}
+
+void image_vary() {
+    std::uniform_int_distribution<int> d(-20, 20);
+    for (int r : {7, 8, 10, 16, 27}) g_input[r] = (uint16_t)std::max(0, g_input[r] + d(g_rng));
+    g_input[4] = (uint16_t)(525 + g_rng() % 10);
+}
+
+// ---- Connections and scheduled output ----------------------------------------
+enum class Kind { LISTEN, TCP, RELAY, PTY };
+
+struct Conn {
+    int                  fd = -1;
+    Kind                 kind;
+    std::string          transport;     // stats key
+    std::vector<uint8_t> rx;
+    int64_t              next_hb = 0;
+};
+
+std::map<uint64_t, Conn> g_conns;       // by id; ids are never reused
+uint64_t g_next_id = 1;
+
+struct Out {
+    int64_t              due;
+    uint64_t             order;         // FIFO among equal deadlines
+    uint64_t             conn;
+    std::vector<uint8_t> data;
+    int64_t              req_us;        // for latency; 0 = not a reply tail
+    bool operator>(const Out &o) const { return due != o.due ? due > o.due : order > o.order; }
+};
+
+std::priority_queue<Out, std::vector<Out>, std::greater<Out>> g_out;
+uint64_t g_out_order = 0;
+
+uint64_t conn_add(int fd, Kind kind, const std::string &transport) {
+    uint64_t id = g_next_id++;
+    Conn &c = g_conns[id];
+    c.fd = fd;
+    c.kind = kind;
+    c.transport = transport;
+    if (opt.hb_s && (kind == Kind::TCP || kind == Kind::RELAY))
+        c.next_hb = kind == Kind::RELAY ? now_us() : now_us() + opt.hb_s * 1000000LL;
+    return id;
+}
+
+void conn_close(uint64_t id) {
+    auto it = g_conns.find(id);
+    if (it == g_conns.end()) return;
+    if (it->second.kind != Kind::PTY) close(it->second.fd);
+    g_conns.erase(it);
+}
+
+// Queue `frame` for `id` after the injected delay, split into pieces if asked
+void reply(uint64_t id, std::vector<uint8_t> frame, int64_t req_us, bool tcp) {
+    int64_t delay = opt.latency_ms * 1000LL;
+    if (opt.jitter_ms)
+        delay += std::uniform_int_distribution<int64_t>(0, opt.jitter_ms * 1000LL)(g_rng);
+    int64_t due = req_us + delay;
+    size_t  piece = tcp && opt.split > 0 ? (size_t)opt.split : frame.size();
+    for (size_t off = 0; off < frame.size(); off += piece) {
+        size_t n = std::min(piece, frame.size() - off);
+        bool   last = off + n == frame.size();
+        g_out.push({due, g_out_order++, id,
+                    std::vector<uint8_t>(frame.begin() + off, frame.begin() + off + n),
+                    last ? req_us : 0});
+        due += opt.split_gap_ms * 1000LL;
+    }
+}
+
+void out_flush(int64_t now) {
+    while (!g_out.empty() && g_out.top().due <= now) {
+        Out o = g_out.top();
+        g_out.pop();
+        auto it = g_conns.find(o.conn);
+        if (it == g_conns.end()) continue;       // peer gone meanwhile
+        Conn &c = it->second;
+        size_t off = 0;
+        while (off < o.data.size()) {
+            ssize_t n = write(c.fd, o.data.data() + off, o.data.size() - off);
+            if (n <= 0) break;
+            off += (size_t)n;
+        }
+        if (off < o.data.size()) { conn_close(o.conn); continue; }
+        if (o.req_us) stats_latency(g_stats[c.transport], now_us() - o.req_us);
+    }
+}
+
+// ---- A1 1A translated data ----------------------------------------------------
+void put_crc(std::vector<uint8_t> &v, size_t from) {
+    uint16_t crc = lux_crc16(v.data() + from, v.size() - from);
+    v.push_back(crc & 0xFF);
+    v.push_back(crc >> 8);
+}
+
+std::vector<uint8_t> tcp_header(uint16_t dir, uint8_t seq, uint8_t tcp_fn,
+                                const uint8_t *dongle, uint16_t data_len) {
+    uint16_t fl = data_len + 14;
+    std::vector<uint8_t> v = {0xA1, 0x1A, (uint8_t)(dir & 0xFF), (uint8_t)(dir >> 8),
+                              (uint8_t)(fl & 0xFF), (uint8_t)(fl >> 8), seq, tcp_fn};
+    v.insert(v.end(), dongle, dongle + 10);
+    v.push_back(data_len & 0xFF);
+    v.push_back(data_len >> 8);
+    return v;
+}
+
+std::vector<uint8_t> tcp_heartbeat() {
+    std::vector<uint8_t> v = {0xA1, 0x1A, 0x05, 0x00, 0x0D, 0x00, 0x01, TCP_HB};
+    v.insert(v.end(), opt.dongle_sn.begin(), opt.dongle_sn.begin() + 10);
+    v.push_back(0x00);
+    return v;
+}
+
+// Reply to one request; empty = nothing to send
+std::vector<uint8_t> tcp_answer(const uint8_t *buf, size_t len, Stats &st) {
+    const uint8_t *df = buf + 20;
+    size_t   df_len = len - 20;
+    uint8_t  fn     = df[1];
+    uint16_t reg    = df[12] | (df[13] << 8);
+    uint16_t val    = df[14] | (df[15] << 8);
+
+    std::vector<uint8_t> d(df, df + 14);        // action, fn, inverter SN, start
+    switch (fn) {
+        case 0x03:
+        case 0x04: {
+            uint16_t  count = val > 127 ? 127 : val;
+            uint16_t *img   = fn == 0x04 ? g_input : g_hold;
+            d.push_back((uint8_t)(count * 2));
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t r = (size_t)reg + i < REG_COUNT ? img[reg + i] : 0;
+                d.push_back(r & 0xFF);
+                d.push_back(r >> 8);
+            }
+            break;
+        }
+        case 0x06:
+            if (reg < REG_COUNT) g_hold[reg] = val;
+            d.push_back(val & 0xFF);
+            d.push_back(val >> 8);
+            st.writes++;
+            break;
+        case 0x10: {
+            // [16]=byte_count, data big-endian (see lux_build_write_multi)
+            if (df_len < 19 || df_len < (size_t)17 + df[16] + 2) return {};
+            for (uint16_t i = 0; i < val && i < df[16] / 2; i++)
+                if ((size_t)reg + i < REG_COUNT)
+                    g_hold[reg + i] = (df[17 + i*2] << 8) | df[18 + i*2];
+            d.push_back(val & 0xFF);
+            d.push_back(val >> 8);
+            st.writes++;
+            break;
+        }
+        default:
+            return {};
+    }
+    put_crc(d, 0);
+    std::vector<uint8_t> f = tcp_header(0x0002, buf[6], TCP_DATA, buf + 8, (uint16_t)d.size());
+    f.insert(f.end(), d.begin(), d.end());
+    return f;
+}
+
+void tcp_frame(uint64_t id, Conn &c, const uint8_t *buf, size_t len, int64_t t) {
+    Stats &st = g_stats[c.transport];
+    if (buf[7] == TCP_HB) { st.hb_echoed++; return; }
+    if (buf[7] != TCP_DATA || len < 38) { st.bad++; return; }
+    uint16_t crc = lux_crc16(buf + 20, len - 22);
+    if (crc != (buf[len-2] | (buf[len-1] << 8))) { st.bad++; return; }
+
+    st.requests++;
+    if (chance(opt.drop)) { st.dropped++; return; }
+    std::vector<uint8_t> f = tcp_answer(buf, len, st);
+    if (f.empty()) { st.bad++; return; }
+    if (chance(opt.crc_err)) { f.back() ^= 0x5A; st.corrupted++; }
+    st.replies++;
+    reply(id, std::move(f), t, true);
+}
+
+void tcp_input(uint64_t id, Conn &c, int64_t t) {
+    std::vector<uint8_t> &rx = c.rx;
+    size_t pos = 0;
+    while (rx.size() - pos >= 6) {
+        if (rx[pos] != 0xA1 || rx[pos+1] != 0x1A) { pos++; continue; }
+        size_t total = (size_t)(rx[pos+4] | (rx[pos+5] << 8)) + 6;
+        if (total > MAX_FRAME || total < 8) { pos += 2; continue; }
+        if (rx.size() - pos < total) break;
+        tcp_frame(id, c, rx.data() + pos, total, t);
+        if (!g_conns.count(id)) return;
+        pos += total;
+    }
+    rx.erase(rx.begin(), rx.begin() + pos);
+}
+
+// ---- Modbus RTU (pty) -----------------------------------------------------------
+std::vector<uint8_t> rtu_answer(const uint8_t *q, Stats &st) {
+    uint8_t  fn  = q[1];
+    uint16_t reg = (q[2] << 8) | q[3];
+    uint16_t val = (q[4] << 8) | q[5];
+    std::vector<uint8_t> r = {q[0], fn};
+    switch (fn) {
+        case 0x03:
+        case 0x04: {
+            if (val == 0 || val > 125 || (size_t)reg + val > REG_COUNT) {
+                r = {q[0], (uint8_t)(fn | 0x80), 0x02};        // illegal address
+                break;
+            }
+            uint16_t *img = fn == 0x04 ? g_input : g_hold;
+            r.push_back((uint8_t)(val * 2));
+            for (uint16_t i = 0; i < val; i++) {
+                r.push_back(img[reg + i] >> 8);
+                r.push_back(img[reg + i] & 0xFF);
+            }
+            break;
+        }
+        case 0x06:
+            if (reg < REG_COUNT) g_hold[reg] = val;
+            r.assign(q, q + 6);
+            st.writes++;
+            break;
+        case 0x10:
+            for (uint16_t i = 0; i < val && i < q[6] / 2; i++)
+                if ((size_t)reg + i < REG_COUNT)
+                    g_hold[reg + i] = (q[7 + i*2] << 8) | q[8 + i*2];
+            r.assign(q, q + 6);
+            st.writes++;
+            break;
+        default:
+            r = {q[0], (uint8_t)(fn | 0x80), 0x01};            // illegal function
+            break;
+    }
+    put_crc(r, 0);
+    return r;
+}
+
+void rtu_input(uint64_t id, Conn &c, int64_t t) {
+    std::vector<uint8_t> &rx = c.rx;
+    Stats &st = g_stats[c.transport];
+    size_t pos = 0;
+    while (rx.size() - pos >= 2) {
+        const uint8_t *q = rx.data() + pos;
+        size_t have = rx.size() - pos;
+        size_t need = 8;
+        if (q[1] == 0x10) {
+            if (have < 7) break;
+            need = 9 + q[6];
+        }
+        if (have < need) break;
+        uint16_t crc = lux_crc16(q, need - 2);
+        if (crc != (q[need-2] | (q[need-1] << 8))) { st.bad++; pos++; continue; }   // resync
+        pos += need;
+        if (q[0] != opt.slave) continue;
+
+        st.requests++;
+        if (chance(opt.drop)) { st.dropped++; continue; }
+        std::vector<uint8_t> r = rtu_answer(q, st);
+        if (chance(opt.crc_err)) { r.back() ^= 0x5A; st.corrupted++; }
+        st.replies++;
+        reply(id, std::move(r), t, false);
+    }
+    rx.erase(rx.begin(), rx.begin() + pos);
+}
+
+// ---- Sockets ------------------------------------------------------------------
+int listen_on(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (sockaddr *)&a, sizeof(a)) < 0 || listen(fd, 8) < 0) {
+        std::fprintf(stderr, "listen :%d: %s\n", port, std::strerror(errno));
+        std::exit(1);
+    }
+    return fd;
+}
+
+int connect_to(const std::string &hostport) {
+    size_t colon = hostport.rfind(':');
+    if (colon == std::string::npos) return -1;
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(hostport.substr(0, colon).c_str(), hostport.substr(colon + 1).c_str(),
+                    &hints, &res) != 0 || !res)
+        return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, res->ai_addr, res->ai_addrlen) < 0) { close(fd); fd = -1; }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int pty_open() {
+    int m = posix_openpt(O_RDWR | O_NOCTTY);
+    if (m < 0 || grantpt(m) < 0 || unlockpt(m) < 0) { std::perror("pty"); std::exit(1); }
+    termios tio;
+    tcgetattr(m, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(m, TCSANOW, &tio);
+    const char *name = ptsname(m);
+    // Hold the slave side open so the master doesn't see hangups between clients
+    static int keep = open(name, O_RDWR | O_NOCTTY);
+    (void)keep;
+    if (!opt.pty_link.empty()) {
+        unlink(opt.pty_link.c_str());
+        if (symlink(name, opt.pty_link.c_str()) < 0) std::perror("symlink");
+    }
+    std::printf("rtu   slave %d on %s%s%s\n", opt.slave, name,
+                opt.pty_link.empty() ? "" : " -> ", opt.pty_link.c_str());
+    return m;
+}
+
+void on_signal(int sig) {
+    if (sig == SIGINT || sig == SIGTERM) g_stop = 1;
+    else g_dump = 1;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: lux_sim [--local-port N] [--cloud-port N] [--relay HOST:PORT]\n"
+        "               [--pty [PATH]] [--slave ADDR] [--image FILE] [--vary]\n"
+        "               [--hb S] [--latency MS] [--jitter MS] [--split N] [--split-gap MS]\n"
+        "               [--crc-err P] [--drop P] [--stats S] [--seed N] [--dongle-sn SN]\n"
+        "  port 0 disables a listener; SIGUSR1 prints statistics\n");
+    std::exit(2);
+}
+
+void parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char * { if (i + 1 >= argc) usage(); return argv[++i]; };
+        if      (a == "--local-port") opt.local_port   = std::atoi(next());
+        else if (a == "--cloud-port") opt.cloud_port   = std::atoi(next());
+        else if (a == "--relay")      opt.relay        = next();
+        else if (a == "--pty") {
+            opt.pty = true;
+            if (i + 1 < argc && argv[i+1][0] != '-') opt.pty_link = argv[++i];
+        }
+        else if (a == "--slave")      opt.slave        = std::atoi(next());
+        else if (a == "--image")      opt.image        = next();
+        else if (a == "--vary")       opt.vary         = true;
+        else if (a == "--hb")         opt.hb_s         = std::atoi(next());
+        else if (a == "--latency")    opt.latency_ms   = std::atoi(next());
+        else if (a == "--jitter")     opt.jitter_ms    = std::atoi(next());
+        else if (a == "--split")      opt.split        = std::atoi(next());
+        else if (a == "--split-gap")  opt.split_gap_ms = std::atoi(next());
+        else if (a == "--crc-err")    opt.crc_err      = std::atof(next());
+        else if (a == "--drop")       opt.drop         = std::atof(next());
+        else if (a == "--stats")      opt.stats_s      = std::atoi(next());
+        else if (a == "--seed")       opt.seed         = (unsigned)std::atoi(next());
+        else if (a == "--dongle-sn")  opt.dongle_sn    = next();
+        else usage();
+    }
+    if (opt.dongle_sn.size() != 10) {
+        std::fprintf(stderr, "--dongle-sn must be 10 characters\n");
+        std::exit(2);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
+    g_rng.seed(opt.seed);
+    image_defaults();
+    if (!opt.image.empty() && !image_load(opt.image)) return 1;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGUSR1, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (opt.local_port) {
+        conn_add(listen_on(opt.local_port), Kind::LISTEN, "local");
+        std::printf("local listening on :%d\n", opt.local_port);
+    }
+    if (opt.cloud_port) {
+        conn_add(listen_on(opt.cloud_port), Kind::LISTEN, "cloud");
+        std::printf("cloud listening on :%d\n", opt.cloud_port);
+    }
+    if (opt.pty) conn_add(pty_open(), Kind::PTY, "rtu");
+    std::fflush(stdout);
+
+    g_stats_since = now_us();
+    int64_t next_relay = opt.relay.empty() ? 0 : now_us();
+    int64_t next_vary  = now_us() + 1000000;
+    int64_t next_stats = opt.stats_s ? now_us() + opt.stats_s * 1000000LL : 0;
+
+    while (!g_stop) {
+        int64_t now = now_us();
+
+        // Timers: relay (re)connect, heartbeats, live values, stats
+        if (next_relay && now >= next_relay) {
+            bool up = false;
+            for (auto &kv : g_conns) up |= kv.second.kind == Kind::RELAY;
+            if (!up) {
+                int fd = connect_to(opt.relay);
+                if (fd >= 0) {
+                    conn_add(fd, Kind::RELAY, "relay");
+                    std::printf("relay connected to %s\n", opt.relay.c_str());
+                    std::fflush(stdout);
+                }
+            }
+            next_relay = now + RECONNECT_US;
+        }
+        for (auto &kv : g_conns) {
+            Conn &c = kv.second;
+            if (c.next_hb && now >= c.next_hb) {
+                g_out.push({now, g_out_order++, kv.first, tcp_heartbeat(), 0});
+                g_stats[c.transport].hb_sent++;
+                c.next_hb = now + opt.hb_s * 1000000LL;
+            }
+        }
+        if (opt.vary && now >= next_vary) { image_vary(); next_vary = now + 1000000; }
+        if (next_stats && now >= next_stats) { g_dump = 1; next_stats = now + opt.stats_s * 1000000LL; }
+        if (g_dump) { g_dump = 0; stats_print(); }
+        out_flush(now);
+
+        // Sleep until input or the next deadline (at most 100 ms)
+        int64_t wake = now + 100000;
+        if (!g_out.empty()) wake = std::min(wake, g_out.top().due);
+        std::vector<pollfd>   pfds;
+        std::vector<uint64_t> ids;
+        for (auto &kv : g_conns) {
+            pfds.push_back({kv.second.fd, POLLIN, 0});
+            ids.push_back(kv.first);
+        }
+        int timeout_ms = (int)std::max<int64_t>(0, (wake - now + 999) / 1000);
+        if (poll(pfds.data(), pfds.size(), timeout_ms) <= 0) continue;
+
+        int64_t t = now_us();
+        for (size_t i = 0; i < pfds.size(); i++) {
+            if (!(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            auto it = g_conns.find(ids[i]);
+            if (it == g_conns.end()) continue;
+            Conn &c = it->second;
+
+            if (c.kind == Kind::LISTEN) {
+                int fd = accept(c.fd, nullptr, nullptr);
+                if (fd < 0) continue;
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                conn_add(fd, Kind::TCP, c.transport);
+                continue;
+            }
+            uint8_t buf[1024];
+            ssize_t n = read(c.fd, buf, sizeof(buf));
+            if (n <= 0) {
+                if (c.kind != Kind::PTY) conn_close(ids[i]);
+                continue;
+            }
+            c.rx.insert(c.rx.end(), buf, buf + n);
+            if (c.kind == Kind::PTY) rtu_input(ids[i], c, t);
+            else                     tcp_input(ids[i], c, t);
+        }
+    }
+    stats_print();
+    return 0;
+}
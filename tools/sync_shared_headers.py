@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""
+Copy the shared protocol headers out of components/luxpower_sna into the
+builds that cannot include them by path (the Arduino IDE copies only the
+sketch folder, ESPHome only the component's own folder).
+
+The copies are regular files, not symlinks, so a checkout without symlink
+support still builds. Edit the originals, then run:
+    python3 tools/sync_shared_headers.py           # rewrite the copies
+    python3 tools/sync_shared_headers.py --check   # exit 1 if any is stale
+"""
+import argparse
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC = 'components/luxpower_sna'
+
+# header -> directories that get a copy
+COPIES = {
+    'lux_crc.h':       ['Arduino', 'components/luxclient'],
+    'lux_regdecode.h': ['Arduino'],
+}
+
+
+def render(name):
+    with open(os.path.join(ROOT, SRC, name), encoding='utf-8') as f:
+        body = f.read()
+    banner = ('// Generated copy of %s/%s - do not edit here.\n'
+              '// Edit the original and run tools/sync_shared_headers.py.\n' % (SRC, name))
+    return banner + body
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--check', action='store_true', help='only report stale copies')
+    args = parser.parse_args()
+
+    stale = 0
+    for name, dirs in COPIES.items():
+        want = render(name)
+        for d in dirs:
+            path = os.path.join(ROOT, d, name)
+            have = None
+            if os.path.isfile(path) and not os.path.islink(path):
+                with open(path, encoding='utf-8') as f:
+                    have = f.read()
+            if have == want:
+                continue
+            stale += 1
+            rel = os.path.join(d, name)
+            if args.check:
+                print('stale: %s' % rel)
+                continue
+            if os.path.islink(path):
+                os.remove(path)
+            with open(path, 'w', encoding='utf-8', newline='\n') as f:
+                f.write(want)
+            print('wrote: %s' % rel)
+
+    if args.check and stale:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()